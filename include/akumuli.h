@@ -63,6 +63,14 @@ extern "C" {
         aku_TimeStamp begin;
         //! End of the search range
         aku_TimeStamp end;
+        //! Smallest parameter id to search (used if n_params is 0)
+        aku_ParamId min_id;
+        //! Largest parameter id to search (used if n_params is 0)
+        aku_ParamId max_id;
+        //! Max number of worker threads used to execute query (0 or 1 - query is executed by the caller's thread)
+        uint32_t parallelism;
+        //! Results order (AKU_ORDER_BY_TIME or AKU_ORDER_BY_SERIES)
+        uint32_t order;
         //! Number of parameters to search
         uint32_t n_params;
         //! Array of parameters to search
@@ -78,6 +86,80 @@ extern "C" {
     };
 
 
+    //! Aggregate of the series values inside one time bucket
+    struct aku_AggregateRow {
+        aku_TimeStamp   bucket;     //< Beginning of the time bucket
+        aku_ParamId     param_id;   //< Series id
+        uint64_t        count;      //< Number of values
+        double          min;
+        double          max;
+        double          sum;
+        double          mean;
+        double          first;      //< Value with the smallest timestamp
+        double          last;       //< Value with the largest timestamp
+    };
+
+
+    //! Asynchronous query handle
+    struct aku_AsyncQuery {
+        int padding;
+    };
+
+
+    //! Subscription handle
+    struct aku_Subscription {
+        int padding;
+    };
+
+
+    /** Receiver of the asynchronous query results.
+      * Called by the library thread, calls for the same query are never concurrent.
+      * @param user_data pointer passed to `aku_select_async`
+      * @param status AKU_SUCCESS or error code (AKU_ECANCELED if query was canceled)
+      * @param done true if this is the last call for the query (batch is empty in this case)
+      * @param timestamps array of timestamps
+      * @param params array of parameter ids
+      * @param pointers array of pointers to data
+      * @param lengths array of data lengths
+      * @param size number of results in batch
+      * @note arrays are valid only during the call
+      */
+    typedef void (*aku_select_cb_t)( void                 *user_data
+                                   , aku_Status            status
+                                   , bool                  done
+                                   , aku_TimeStamp const  *timestamps
+                                   , aku_ParamId const    *params
+                                   , aku_PData const      *pointers
+                                   , uint32_t const       *lengths
+                                   , size_t                size );
+
+
+    /** Receiver of the batched query results.
+      * Called by the thread that executes `aku_select_batch`.
+      * @param user_data pointer passed to `aku_select_batch`
+      * @param query_ix index of the query in the batch
+      * @param timestamps array of timestamps
+      * @param params array of parameter ids
+      * @param pointers array of pointers to data
+      * @param lengths array of data lengths
+      * @param size number of results
+      * @note arrays are valid only during the call
+      */
+    typedef void (*aku_select_batch_cb_t)( void                 *user_data
+                                         , uint32_t              query_ix
+                                         , aku_TimeStamp const  *timestamps
+                                         , aku_ParamId const    *params
+                                         , aku_PData const      *pointers
+                                         , uint32_t const       *lengths
+                                         , size_t                size );
+
+
+    //! Position of the cursor (opaque for the user)
+    struct aku_CursorToken {
+        uint64_t data[8];
+    };
+
+
     //! Search stats
     struct aku_SearchStats {
         struct InterpolationStats {
@@ -96,10 +178,40 @@ extern "C" {
             uint64_t n_times;               //< How many times binary search was performed
             uint64_t n_steps;               //< How many binary search steps was performed
         } bstats;
+        struct LearnedIndex {
+            uint64_t n_times;               //< How many times learned index was used
+            uint64_t n_window_size;         //< Total size of the predicted search windows
+            uint64_t n_fallbacks;           //< Number of wrong predictions (whole segment was searched)
+        } lstats;
         struct Scan {
             uint64_t fwd_bytes;             //< Number of scanned bytes in forward direction
             uint64_t bwd_bytes;             //< Number of scanned bytes in backward direction
         } scan;
+        struct ParallelScan {
+            uint64_t n_times;               //< How many times page range was scanned in parallel
+            uint64_t n_partitions;          //< Total number of scanned partitions
+        } pscan;
+        struct ChunkCache {
+            uint64_t n_hits;                //< Number of decoded chunks found in cache
+            uint64_t n_misses;              //< Number of chunks decoded because of cache miss
+        } cache;
+        struct ResultCache {
+            uint64_t n_hits;                //< Number of closed volume searches answered from result cache
+            uint64_t n_misses;              //< Number of closed volume searches that scanned the volume
+        } rcache;
+        struct LatencyHistogram {
+            uint64_t n_times;               //< Number of measurements
+            uint64_t total_ns;              //< Total duration in nanoseconds
+            uint64_t buckets[AKU_LATENCY_HISTOGRAM_SIZE];  //< buckets[i] - number of measurements in [2^i, 2^(i+1)) ns range
+        };
+        struct Latency {
+            LatencyHistogram histogram;     //< Histogram lookup
+            LatencyHistogram learned_index; //< Learned index lookup
+            LatencyHistogram interpolation; //< Interpolation search
+            LatencyHistogram binary_search; //< Binary search
+            LatencyHistogram chunk_decode;  //< Chunk decoding (cache misses only)
+            LatencyHistogram scan;          //< Page scan and delivery of results to cursor
+        } latency;
     };
 
 
@@ -109,6 +221,10 @@ extern "C" {
         uint64_t n_volumes;       //< Total number of volumes
         uint64_t free_space;      //< Free space total
         uint64_t used_space;      //< Space in use
+        uint64_t n_runs;          //< Number of sorted runs in sequencer of the active volume
+        uint64_t n_compactions;   //< Number of run compactions in sequencer of the active volume
+        uint64_t run_sizes[AKU_RUN_SIZE_HISTOGRAM_SIZE];  //< Run size distribution, bucket i counts runs with
+                                                          //< [2^i, 2^(i+1)) values, last bucket counts all larger runs
     };
 
 
@@ -207,6 +323,13 @@ extern "C" {
      */
     AKU_EXPORT aku_SelectQuery* aku_make_select_query(aku_TimeStamp begin, aku_TimeStamp end, uint32_t n_params, aku_ParamId* params);
 
+    /**
+     * @brief Create select query with range of parameter-ids
+     * @param min_id smallest parameter id (inclusive)
+     * @param max_id largest parameter id (inclusive)
+     */
+    AKU_EXPORT aku_SelectQuery* aku_make_select_range_query(aku_TimeStamp begin, aku_TimeStamp end, aku_ParamId min_id, aku_ParamId max_id);
+
     /**
      * @brief Execute query
      * @param query data structure representing search query
@@ -243,6 +366,175 @@ extern "C" {
     //! Check cursor error state.
     AKU_EXPORT bool aku_cursor_is_error(aku_Cursor* pcursor, int* out_error_code_or_null);
 
+    /**
+     * @brief Save position of the cursor.
+     * Token can be used to resume the search later from the next result (even if
+     * cursor and database was closed).
+     * @param pcursor pointer to cursor
+     * @param token output token
+     */
+    AKU_EXPORT void aku_cursor_checkpoint(aku_Cursor* pcursor, aku_CursorToken* token);
+
+    /**
+     * @brief Resume search from the saved position
+     * @param query the same query that was used to create checkpointed cursor
+     * @param token token created by `aku_cursor_checkpoint`
+     * @return cursor that returns results that follows the last result returned
+     *         by checkpointed cursor
+     * @note search is resumed directly from the saved position if volume wasn't
+     *       changed since, otherwise search is performed as usual
+     */
+    AKU_EXPORT aku_Cursor* aku_select_resume(aku_Database* db, aku_SelectQuery* query, aku_CursorToken const* token);
+
+    /**
+     * @brief Execute aggregate query.
+     * Values of every series are aggregated inside time buckets, only aggregates
+     * are returned. Rows are ordered by bucket in the query direction and by
+     * series id inside bucket (by series id and then by bucket if query order
+     * is AKU_ORDER_BY_SERIES). Buckets without values are omitted.
+     * @param query data structure representing search query
+     * @param bucket_width width of the time bucket, bucket of the value with
+     *        timestamp `ts` starts at `ts - ts % bucket_width`
+     * @param value_type type of the values (AKU_VALUE_U64, AKU_VALUE_I64 or
+     *        AKU_VALUE_DOUBLE), values that are not 8 bytes long are ignored
+     * @return cursor, rows should be read using `aku_cursor_read_aggregates`
+     */
+    AKU_EXPORT aku_Cursor* aku_select_aggregate( aku_Database    *db
+                                               , aku_SelectQuery *query
+                                               , uint64_t         bucket_width
+                                               , int              value_type );
+
+    /**
+     * @brief Read results of the aggregate query.
+     * @param pcursor pointer to cursor created by `aku_select_aggregate`
+     * @param rows output buffer
+     * @param size size of the output buffer
+     * @return number of rows
+     */
+    AKU_EXPORT int aku_cursor_read_aggregates(aku_Cursor* pcursor, aku_AggregateRow* rows, size_t size);
+
+    /**
+     * @brief Execute batch of queries.
+     * Queries with the same direction and overlapping time ranges share one
+     * scan of the storage, every chunk is decoded once for all of them.
+     * Results of every query are delivered to the callback in time order
+     * (order field of the query is ignored), results of different queries
+     * can be interleaved.
+     * @param queries array of queries
+     * @param n_queries number of queries
+     * @param callback receiver of the results
+     * @param user_data pointer passed to callback
+     * @return AKU_SUCCESS or error code
+     */
+    AKU_EXPORT aku_Status aku_select_batch( aku_Database           *db
+                                          , aku_SelectQuery       **queries
+                                          , uint32_t                n_queries
+                                          , aku_select_batch_cb_t   callback
+                                          , void                   *user_data );
+
+    /**
+     * @brief Execute query asynchronously.
+     * Query is executed by the library threads, results are delivered to the callback
+     * in batches. Batch is delivered only if it was requested using `aku_async_request`.
+     * @param query data structure representing search query
+     * @param batch_size max number of results in batch
+     * @param callback results receiver
+     * @param user_data pointer that will be passed to callback
+     * @return query handle, must be closed before the database
+     */
+    AKU_EXPORT aku_AsyncQuery* aku_select_async( aku_Database    *db
+                                               , aku_SelectQuery *query
+                                               , size_t           batch_size
+                                               , aku_select_cb_t  callback
+                                               , void            *user_data );
+
+    /**
+     * @brief Request more results.
+     * Allows delivery of `n_batches` more batches, can be called from callback.
+     */
+    AKU_EXPORT void aku_async_request(aku_AsyncQuery* pquery, uint32_t n_batches);
+
+    /**
+     * @brief Cancel query.
+     * Query is stopped after the current batch, callback will be called with AKU_ECANCELED
+     * status (if query isn't already done). Can be called from callback.
+     */
+    AKU_EXPORT void aku_async_cancel(aku_AsyncQuery* pquery);
+
+    /**
+     * @brief Close query handle.
+     * Cancels the query and waits for the last callback call. Must not be called from callback.
+     */
+    AKU_EXPORT void aku_async_close(aku_AsyncQuery* pquery);
+
+    /**
+     * @brief Subscribe to new samples.
+     * Samples of the matching series written after this call are copied to the
+     * ring buffer of the subscription. AKU_SUBSCRIBE_ORDERED subscription receives
+     * samples in (timestamp, param id) order when they are merged from the
+     * out-of-order window to the page. AKU_SUBSCRIBE_MAY_REORDER subscription
+     * receives samples as soon as they are written, in write order. Samples are
+     * dropped if the ring buffer is full, writer is never blocked.
+     * @param query series and time range of interest (direction and order are ignored)
+     * @param mode AKU_SUBSCRIBE_ORDERED or AKU_SUBSCRIBE_MAY_REORDER
+     * @param capacity size of the ring buffer (number of samples)
+     * @return subscription handle or null if mode is invalid, must be closed before the database
+     */
+    AKU_EXPORT aku_Subscription* aku_subscribe( aku_Database    *db
+                                              , aku_SelectQuery *query
+                                              , int              mode
+                                              , size_t           capacity );
+
+    /**
+     * @brief Read samples received by subscription.
+     * Doesn't block, returns 0 if there are no new samples.
+     * @param psub subscription handle
+     * @param timestamps output buffer for timestamps (can be null)
+     * @param params output buffer for parameter ids (can be null)
+     * @param pointers output buffer for pointers to data (can be null)
+     * @param lengths output buffer for data lengths (can be null)
+     * @param size size of every output buffer
+     * @return number of samples
+     * @note pointers are valid until the next call
+     */
+    AKU_EXPORT int aku_subscription_read( aku_Subscription *psub
+                                        , aku_TimeStamp    *timestamps
+                                        , aku_ParamId      *params
+                                        , aku_PData        *pointers
+                                        , uint32_t         *lengths
+                                        , size_t            size );
+
+    /**
+     * @brief Get number of samples dropped because of the ring buffer overflow.
+     */
+    AKU_EXPORT uint64_t aku_subscription_dropped(aku_Subscription* psub);
+
+    /**
+     * @brief Close subscription handle.
+     * Subscription doesn't receive samples after this call.
+     */
+    AKU_EXPORT void aku_unsubscribe(aku_Subscription* psub);
+
+    /**
+     * @brief Read last values of the series.
+     * @param db database instance
+     * @param n_params number of series
+     * @param params array of series ids
+     * @param timestamps output buffer for storing timestamps of the last values
+     * @param pointers output buffer for storing pointers to the last values
+     * @param lengths output buffer for storing lengths of the last values
+     * @return AKU_SUCCESS or error code
+     * @note every output buffer must contain n_params elements, element `i` corresponds
+     *       to `params[i]`, pointer is null if series doesn't have values
+     * @note every output parmeter can be null if we doesn't interested in it's value
+     */
+    AKU_EXPORT aku_Status aku_select_last( aku_Database    *db
+                                         , uint32_t         n_params
+                                         , aku_ParamId const *params
+                                         , aku_TimeStamp   *timestamps
+                                         , aku_PData       *pointers
+                                         , uint32_t        *lengths );
+
 
     //--------------------
     // Stats and counters
@@ -28,6 +28,28 @@
 #define AKU_MAX_TIMESTAMP       (~0)
 #define AKU_STACK_SIZE            0x100000
 #define AKU_HISTOGRAM_SIZE        0x10000
+//! Max number of learned index segments
+#define AKU_LEARNED_INDEX_SIZE    0x1000
+//! Max error of the learned index (in entries)
+#define AKU_LEARNED_INDEX_ERROR   16
+//! Number of buckets in latency histogram
+#define AKU_LATENCY_HISTOGRAM_SIZE 32
+//! Min number of index entries scanned by one thread during parallel page scan
+#define AKU_MIN_SCAN_PARTITION_SIZE 0x4000
+//! Max number of rollups
+#define AKU_MAX_ROLLUPS           4
+//! Default max number of time buckets stored by rollup
+#define AKU_DEFAULT_ROLLUP_MAX_BUCKETS 0x10000
+//! Default max size of all rollups in bytes
+#define AKU_DEFAULT_ROLLUP_MAX_SIZE 0x10000000
+//! Max number of series returned by the query with series order
+#define AKU_MAX_SERIES_ORDER_IDS  0x100000
+//! Max number of series lists saved for resumed series order queries
+#define AKU_MAX_SAVED_SERIES_LISTS 16
+//! Max number of sorted runs in sequencer, small adjacent runs are merged when exceeded
+#define AKU_SEQUENCER_MAX_RUNS    64
+//! Number of buckets in sequencer run size histogram
+#define AKU_RUN_SIZE_HISTOGRAM_SIZE 16
 
 //! Max number of live generations in cache
 #define AKU_LIMITS_MAX_CACHES     8
@@ -56,6 +78,8 @@
 #define AKU_EGENERAL              8
 //! Late write error
 #define AKU_ELATE_WRITE           9
+//! Operation was canceled
+#define AKU_ECANCELED            10
 
 
 // Search error codes
@@ -71,6 +95,10 @@
 #define AKU_DEBUG_MODE_ON         1
 #define AKU_DEBUG_MODE_OFF        0
 
+// Page index types
+#define AKU_PAGE_INDEX_HISTOGRAM  0
+#define AKU_PAGE_INDEX_LEARNED    1
+
 // Write status
 
 //! Succesfull write
@@ -86,6 +114,28 @@
 #define AKU_CURSOR_DIR_BACKWARD   1
 
 
+// Result orders
+
+//! Results are ordered by timestamp and by param id inside timestamp group
+#define AKU_ORDER_BY_TIME         0
+//! Results are grouped by param id (in ascending order), every group is ordered by timestamp
+#define AKU_ORDER_BY_SERIES       1
+
+
+// Value types (used by aggregate queries)
+#define AKU_VALUE_U64             0
+#define AKU_VALUE_I64             1
+#define AKU_VALUE_DOUBLE          2
+
+
+// Subscription modes
+
+//! Samples are delivered in (timestamp, param id) order after they leave the out-of-order window
+#define AKU_SUBSCRIBE_ORDERED     0
+//! Samples are delivered immediately in write order, late samples can precede earlier ones
+#define AKU_SUBSCRIBE_MAY_REORDER 1
+
+
 // Different tune parameters
 #define AKU_INTERPOLATION_SEARCH_CUTOFF 0x00000100
 
@@ -22,6 +22,7 @@
 
 #pragma once
 #include <cstdint>
+#include "akumuli_def.h"
 
 extern "C" {
 
@@ -44,6 +45,28 @@ struct aku_FineTuneParams
     //! Maximum cache size in bytes
     uint32_t max_cache_size;  // TODO: move to config file
 
+    //! Maximum size of the decoded chunk cache in bytes (0 - cache disabled)
+    uint64_t max_chunk_cache_size;
+
+    //! Maximum size of the search result cache of closed volumes in bytes (0 - cache disabled)
+    uint64_t max_result_cache_size;
+
+    //! Index type of the newly opened pages (AKU_PAGE_INDEX_HISTOGRAM or AKU_PAGE_INDEX_LEARNED)
+    uint32_t page_index;
+
+    //! Resolutions of the rollups, unused elements should be set to 0 (all zeroes - rollups disabled)
+    uint64_t rollup_resolutions[AKU_MAX_ROLLUPS];
+
+    //! Type of the values stored in rollups (AKU_VALUE_U64, AKU_VALUE_I64 or AKU_VALUE_DOUBLE,
+    //! database is not opened if other value is used with rollups enabled)
+    uint32_t rollup_value_type;
+
+    //! Max number of time buckets stored by each rollup (0 - use default)
+    uint32_t rollup_max_buckets;
+
+    //! Max memory used by all rollups in bytes (0 - use default)
+    uint64_t rollup_max_size;
+
     //! Pointer to logging function, can be null
     aku_logger_cb_t logger;
 };
@@ -0,0 +1,255 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <algorithm>
+#include <cstring>
+
+#include "aggregation.h"
+
+namespace Akumuli {
+
+// AggregateState
+
+AggregateState::AggregateState()
+    : count(0u)
+    , min(0.0)
+    , max(0.0)
+    , sum(0.0)
+    , first(0.0)
+    , last(0.0)
+    , first_ts(0u)
+    , last_ts(0u)
+{
+}
+
+void AggregateState::add(aku_TimeStamp ts, double value) {
+    if (count == 0u) {
+        min = max = first = last = value;
+        first_ts = last_ts = ts;
+    } else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+        if (ts < first_ts) {
+            first = value;
+            first_ts = ts;
+        }
+        if (ts >= last_ts) {
+            last = value;
+            last_ts = ts;
+        }
+    }
+    sum += value;
+    count++;
+}
+
+void AggregateState::combine(AggregateState const& other) {
+    if (other.count == 0u) {
+        return;
+    }
+    if (count == 0u) {
+        *this = other;
+        return;
+    }
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    if (other.first_ts < first_ts) {
+        first = other.first;
+        first_ts = other.first_ts;
+    }
+    if (other.last_ts >= last_ts) {
+        last = other.last;
+        last_ts = other.last_ts;
+    }
+    sum += other.sum;
+    count += other.count;
+}
+
+void AggregateState::get(aku_TimeStamp bucket, aku_ParamId param, aku_AggregateRow* row) const {
+    row->bucket = bucket;
+    row->param_id = param;
+    row->count = count;
+    row->min = min;
+    row->max = max;
+    row->sum = sum;
+    row->mean = count ? sum / count : 0.0;
+    row->first = first;
+    row->last = last;
+}
+
+// AggregateCursor
+
+AggregateCursor::AggregateCursor(std::unique_ptr<ExternalCursor> cursor, aku_Duration bucket_width, int value_type)
+    : cursor_(std::move(cursor))
+    , bucket_width_(bucket_width)
+    , value_type_(value_type)
+    , batch_(BATCH_SIZE)
+    , bucket_(0u)
+    , last_state_(nullptr)
+    , last_param_(0u)
+    , ready_pos_(0u)
+    , done_(false)
+    , error_code_(AKU_SUCCESS)
+{
+    if (bucket_width_ == 0u || !is_valid_value_type(value_type_)) {
+        error_code_ = AKU_EBAD_ARG;
+        done_ = true;
+    }
+}
+
+AggregateCursor::AggregateCursor(std::vector<aku_AggregateRow> rows)
+    : bucket_width_(0u)
+    , value_type_(AKU_VALUE_U64)
+    , bucket_(0u)
+    , last_state_(nullptr)
+    , last_param_(0u)
+    , ready_(std::move(rows))
+    , ready_pos_(0u)
+    , done_(true)
+    , error_code_(AKU_SUCCESS)
+{
+}
+
+void AggregateCursor::hold(std::unique_ptr<SearchQuery> query) {
+    query_ = std::move(query);
+}
+
+void AggregateCursor::append(std::unique_ptr<AggregateCursor> next) {
+    if (next_) {
+        next_->append(std::move(next));
+    } else {
+        next_ = std::move(next);
+    }
+}
+
+bool AggregateCursor::is_valid_value_type(int value_type) {
+    return value_type == AKU_VALUE_U64 || value_type == AKU_VALUE_I64 || value_type == AKU_VALUE_DOUBLE;
+}
+
+bool AggregateCursor::decode_value(CursorResult const& result, int value_type, double* value) {
+    if (result.length != sizeof(uint64_t)) {
+        return false;
+    }
+    auto data = result.page->read_entry_data(result.data_offset);
+    switch (value_type) {
+    case AKU_VALUE_U64: {
+        uint64_t u;
+        memcpy(&u, data, sizeof(u));
+        *value = static_cast<double>(u);
+        return true;
+    }
+    case AKU_VALUE_I64: {
+        int64_t i;
+        memcpy(&i, data, sizeof(i));
+        *value = static_cast<double>(i);
+        return true;
+    }
+    case AKU_VALUE_DOUBLE:
+        memcpy(value, data, sizeof(double));
+        return true;
+    };
+    return false;
+}
+
+void AggregateCursor::add_(CursorResult const& result) {
+    double value;
+    if (!decode_value(result, value_type_, &value)) {
+        return;
+    }
+    aku_TimeStamp bucket = result.timestamp - result.timestamp % bucket_width_;
+    if (bucket != bucket_) {
+        // Results are ordered by time, previous bucket is complete
+        flush_();
+        bucket_ = bucket;
+    }
+    if (last_state_ == nullptr || last_param_ != result.param_id) {
+        last_state_ = &states_[result.param_id];
+        last_param_ = result.param_id;
+    }
+    last_state_->add(result.timestamp, value);
+}
+
+void AggregateCursor::flush_() {
+    for (auto const& kv: states_) {
+        aku_AggregateRow row;
+        kv.second.get(bucket_, kv.first, &row);
+        ready_.push_back(row);
+    }
+    states_.clear();
+    last_state_ = nullptr;
+}
+
+int AggregateCursor::read(aku_AggregateRow* rows, size_t size) {
+    size_t n = read_own_(rows, size);
+    if (n < size && next_ && done_ && error_code_ == AKU_SUCCESS) {
+        n += next_->read(rows + n, size - n);
+    }
+    return static_cast<int>(n);
+}
+
+size_t AggregateCursor::read_own_(aku_AggregateRow* rows, size_t size) {
+    while (ready_.size() - ready_pos_ < size && !done_) {
+        int nread = cursor_->read(batch_.data(), BATCH_SIZE);
+        for (int i = 0; i < nread; i++) {
+            add_(batch_[i]);
+        }
+        int error_code = AKU_SUCCESS;
+        if (cursor_->is_error(&error_code)) {
+            error_code_ = error_code;
+            done_ = true;
+        } else if (cursor_->is_done()) {
+            flush_();
+            done_ = true;
+        }
+    }
+    size_t n = std::min(size, ready_.size() - ready_pos_);
+    std::copy(ready_.begin() + ready_pos_, ready_.begin() + ready_pos_ + n, rows);
+    ready_pos_ += n;
+    if (ready_pos_ == ready_.size()) {
+        ready_.clear();
+        ready_pos_ = 0u;
+    }
+    return n;
+}
+
+bool AggregateCursor::is_done() const {
+    if (error_code_ != AKU_SUCCESS) {
+        return done_;
+    }
+    return done_ && ready_pos_ == ready_.size() && (!next_ || next_->is_done());
+}
+
+bool AggregateCursor::is_error(int* out_error_code_or_null) const {
+    if (error_code_ == AKU_SUCCESS && next_) {
+        return next_->is_error(out_error_code_or_null);
+    }
+    if (out_error_code_or_null) {
+        *out_error_code_or_null = error_code_;
+    }
+    return error_code_ != AKU_SUCCESS;
+}
+
+void AggregateCursor::close() {
+    if (cursor_) {
+        cursor_->close();
+    }
+    if (next_) {
+        next_->close();
+    }
+}
+
+}  // namespace
@@ -0,0 +1,134 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Time-bucketed aggregation of the search results.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "page.h"
+#include "cursor.h"
+
+namespace Akumuli {
+
+/** Aggregate of the series values inside one time bucket.
+  * Values are added in the scan direction, `first` and `last` are
+  * always ordered by time.
+  */
+struct AggregateState {
+    uint64_t        count;
+    double          min;
+    double          max;
+    double          sum;
+    double          first;
+    double          last;
+    aku_TimeStamp   first_ts;
+    aku_TimeStamp   last_ts;
+
+    AggregateState();
+
+    //! Add value
+    void add(aku_TimeStamp ts, double value);
+
+    //! Add all values of the other aggregate
+    void combine(AggregateState const& other);
+
+    //! Write aggregate to output row
+    void get(aku_TimeStamp bucket, aku_ParamId param, aku_AggregateRow* row) const;
+};
+
+
+/** Aggregating cursor.
+  * Reads results of the underlying cursor (ordered by time) and computes
+  * aggregates of the numeric values of every series inside every time bucket.
+  * Only one bucket is open at any time because results are ordered by time.
+  * Rows are ordered by bucket in the direction of the underlying cursor and
+  * by param id inside bucket. Values that are not 8 bytes long are ignored.
+  * Cursors can be chained, next cursor is read when this one is done.
+  */
+class AggregateCursor {
+public:
+    enum {
+        BATCH_SIZE = 0x1000,    //< number of results read from underlying cursor at once
+    };
+
+    /** C-tor
+      * @param cursor underlying cursor
+      * @param bucket_width width of the time bucket (should be greater than zero)
+      * @param value_type value type (one of the AKU_VALUE_* constants), cursor
+      *        fails with AKU_EBAD_ARG if width or type is invalid
+      */
+    AggregateCursor(std::unique_ptr<ExternalCursor> cursor, aku_Duration bucket_width, int value_type);
+
+    /** C-tor
+      * @param rows precomputed rows (e.g. read from rollup)
+      */
+    AggregateCursor(std::vector<aku_AggregateRow> rows);
+
+    //! Keep query alive while cursor is used
+    void hold(std::unique_ptr<SearchQuery> query);
+
+    //! Read `next` cursor after this one (`next` can have its own next cursor)
+    void append(std::unique_ptr<AggregateCursor> next);
+
+    //! Read aggregates, returns number of rows
+    int read(aku_AggregateRow* rows, size_t size);
+
+    bool is_done() const;
+
+    bool is_error(int* out_error_code_or_null) const;
+
+    void close();
+
+    //! Check that `value_type` is one of the AKU_VALUE_* constants
+    static bool is_valid_value_type(int value_type);
+
+    //! Decode numeric value, returns false if value has wrong size
+    static bool decode_value(CursorResult const& result, int value_type, double* value);
+
+private:
+    //! Read rows of this cursor only
+    size_t read_own_(aku_AggregateRow* rows, size_t size);
+
+    //! Add result to the current bucket
+    void add_(CursorResult const& result);
+
+    //! Move aggregates of the current bucket to output
+    void flush_();
+
+    std::unique_ptr<SearchQuery>            query_;     //< query of the underlying cursor (can be null)
+    std::unique_ptr<ExternalCursor>         cursor_;    //< underlying cursor (null if rows are precomputed)
+    std::unique_ptr<AggregateCursor>        next_;      //< next cursor in chain (can be null)
+    const aku_Duration                      bucket_width_;
+    const int                               value_type_;
+    std::vector<CursorResult>               batch_;
+    aku_TimeStamp                           bucket_;    //< current bucket
+    std::map<aku_ParamId, AggregateState>   states_;    //< aggregates of the current bucket
+    AggregateState*                         last_state_;  //< state of the last added series (can be null)
+    aku_ParamId                             last_param_;
+    std::vector<aku_AggregateRow>           ready_;     //< rows of the completed buckets
+    size_t                                  ready_pos_;
+    bool                                    done_;      //< underlying cursor is done
+    int                                     error_code_;
+};
+
+}  // namespace
@@ -23,6 +23,8 @@
 
 #include "akumuli.h"
 #include "storage.h"
+#include "async_query.h"
+#include "shared_scan.h"
 
 using namespace Akumuli;
 
@@ -44,14 +46,15 @@ static const char* g_error_messages[] = {
     "Invalid data",
     "Error, no details available",
     "Late write",
+    "Canceled",
     "Unknown error code"
 };
 
 const char* aku_error_message(int error_code) {
-    if (error_code >= 0 && error_code < 10) {
+    if (error_code >= 0 && error_code < 11) {
         return g_error_messages[error_code];
     }
-    return g_error_messages[10];
+    return g_error_messages[11];
 }
 
 void aku_console_logger(int tag, const char* msg) {
@@ -67,45 +70,58 @@ void aku_console_logger(int tag, const char* msg) {
 }
 
 
-struct MatchPred {
-    std::vector<aku_ParamId> params_;
-    MatchPred(aku_ParamId* begin, uint32_t n)
-        : params_(begin, begin + n)
-    {
-    }
-
-    SearchQuery::ParamMatch operator () (aku_ParamId id) const {
-        return std::binary_search(params_.begin(), params_.end(), id) ? SearchQuery::MATCH : SearchQuery::NO_MATCH;
-    }
-};
-
+static_assert(sizeof(CursorCheckpoint) <= sizeof(aku_CursorToken), "cursor checkpoint doesn't fit into token");
 
 struct CursorImpl : aku_Cursor {
-    std::unique_ptr<ExternalCursor> cursor_;
+    std::unique_ptr<StorageCursor> cursor_;
+    std::unique_ptr<AggregateCursor> aggregate_;  //< Used instead of `cursor_` by aggregate queries
     int status_;
     std::unique_ptr<SearchQuery> query_;
 
-    CursorImpl(Storage& storage, std::unique_ptr<SearchQuery> query)
+    CursorImpl(Storage& storage, std::unique_ptr<SearchQuery> query, CursorCheckpoint const* resume=nullptr)
+        : query_(std::move(query))
+    {
+        status_ = AKU_SUCCESS;
+        cursor_ = storage.search(*query_, resume);
+    }
+
+    CursorImpl(Storage& storage, std::unique_ptr<SearchQuery> query, aku_Duration bucket_width, int value_type)
         : query_(std::move(query))
     {
         status_ = AKU_SUCCESS;
-        cursor_ = CoroCursor::make(&Storage::search, &storage, *query_);
+        aggregate_ = storage.aggregate(*query_, bucket_width, value_type);
+    }
+
+    void checkpoint(aku_CursorToken* token) const {
+        CursorCheckpoint cp;
+        memset(&cp, 0, sizeof(cp));
+        if (cursor_) {
+            cursor_->checkpoint(&cp);
+        }
+        memset(token, 0, sizeof(aku_CursorToken));
+        memcpy(token, &cp, sizeof(cp));
     }
 
     ~CursorImpl() {
-        cursor_->close();
+        if (cursor_) {
+            cursor_->close();
+        } else {
+            aggregate_->close();
+        }
     }
 
     bool is_done() const {
-        return cursor_->is_done();
+        return cursor_ ? cursor_->is_done() : aggregate_->is_done();
     }
 
     bool is_error(int* out_error_code_or_null) const {
         if (status_ != AKU_SUCCESS) {
-            *out_error_code_or_null = status_;
-            return false;
+            if (out_error_code_or_null) {
+                *out_error_code_or_null = status_;
+            }
+            return true;
         }
-        return cursor_->is_error(out_error_code_or_null);
+        return cursor_ ? cursor_->is_error(out_error_code_or_null) : aggregate_->is_error(out_error_code_or_null);
     }
 
     int read_columns( aku_TimeStamp   *timestamps
@@ -114,26 +130,58 @@ struct CursorImpl : aku_Cursor {
                     , uint32_t        *lengths
                     , size_t           arrays_size )
     {
+        if (!cursor_) {
+            status_ = AKU_EBAD_ARG;
+            return 0;
+        }
         // TODO: track PageHeader::open_count here
-        std::vector<CursorResult> results;
-        results.resize(arrays_size);  // TODO: pass all pointers to storage directly
-        int n_results = cursor_->read(results.data(), results.size());
-        for (int i = 0; i < n_results; i++) {
-            const CursorResult& result = results[i];
-            if (timestamps) {
-                timestamps[i] = result.timestamp;
-            }
-            if (params) {
-                params[i] = result.param_id;
-            }
-            if (pointers) {
-                pointers[i] = result.page->read_entry_data(result.data_offset);
-            }
-            if (lengths) {
-                lengths[i] = result.length;
-            }
+        CursorColumns columns = { timestamps, params, pointers, lengths, arrays_size };
+        return cursor_->read_columns(columns);
+    }
+
+    int read_aggregates(aku_AggregateRow* rows, size_t size) {
+        if (!aggregate_) {
+            status_ = AKU_EBAD_ARG;
+            return 0;
         }
-        return n_results;
+        return aggregate_->read(rows, size);
+    }
+};
+
+
+struct AsyncQueryImpl : aku_AsyncQuery {
+    std::shared_ptr<AsyncQuery> query_;
+
+    AsyncQueryImpl(Storage& storage, std::unique_ptr<SearchQuery> query, size_t batch_size,
+                   aku_select_cb_t callback, void* user_data)
+    {
+        auto cursor = storage.search(*query);
+        auto fn = [callback, user_data](aku_Status status, bool done, CursorColumns const& batch) {
+            callback(user_data, status, done, batch.timestamps, batch.params, batch.pointers, batch.lengths, batch.size);
+        };
+        query_ = std::make_shared<AsyncQuery>(std::move(query), std::move(cursor), batch_size, fn, AsyncQuery::get_pool());
+    }
+
+    ~AsyncQueryImpl() {
+        query_->close();
+    }
+};
+
+
+struct SubscriptionImpl : aku_Subscription {
+    std::shared_ptr<Subscriptions> subscriptions_;
+    std::shared_ptr<Subscription> subscription_;
+
+    SubscriptionImpl(std::shared_ptr<Subscriptions> subscriptions, std::unique_ptr<SearchQuery> query,
+                     int mode, size_t capacity)
+        : subscriptions_(subscriptions)
+        , subscription_(std::make_shared<Subscription>(std::move(query), mode, capacity))
+    {
+        subscriptions_->add(subscription_);
+    }
+
+    ~SubscriptionImpl() {
+        subscriptions_->remove(subscription_);
     }
 };
 
@@ -156,7 +204,7 @@ struct DatabaseImpl : public aku_Database
         return storage_.get_open_error();
     }
 
-    CursorImpl* select(aku_SelectQuery* query) {
+    std::unique_ptr<SearchQuery> make_search_query(aku_SelectQuery* query) {
         uint32_t scan_dir;
         aku_TimeStamp begin, end;
         if (query->begin < query->end) {
@@ -168,11 +216,80 @@ struct DatabaseImpl : public aku_Database
             begin = query->end;
             scan_dir = AKU_CURSOR_DIR_BACKWARD;
         }
-        MatchPred pred(query->params, query->n_params);
         std::unique_ptr<SearchQuery> search_query;
-        search_query.reset(new SearchQuery(pred, {begin}, {end}, scan_dir));
-        auto pcur = new CursorImpl(storage_, std::move(search_query));
-        return pcur;
+        if (query->n_params == 0) {
+            search_query.reset(new SearchQuery(query->min_id, query->max_id, {begin}, {end}, scan_dir));
+        } else {
+            std::vector<aku_ParamId> params(query->params, query->params + query->n_params);
+            search_query.reset(new SearchQuery(params, {begin}, {end}, scan_dir));
+        }
+        search_query->parallelism = std::max(query->parallelism, 1u);
+        search_query->order = static_cast<int>(query->order);
+        return search_query;
+    }
+
+    CursorImpl* select(aku_SelectQuery* query, aku_CursorToken const* token=nullptr) {
+        auto search_query = make_search_query(query);
+        if (token == nullptr) {
+            return new CursorImpl(storage_, std::move(search_query));
+        }
+        CursorCheckpoint cp;
+        memcpy(&cp, token, sizeof(cp));
+        if ((cp.flags & CursorCheckpoint::HAS_RESULTS) && cp.direction == search_query->direction) {
+            if (search_query->order == AKU_ORDER_BY_SERIES) {
+                // Bounds of the checkpointed series are narrowed by storage
+                return new CursorImpl(storage_, std::move(search_query), &cp);
+            }
+            // Results before the last returned one are not needed
+            if (search_query->direction == AKU_CURSOR_DIR_FORWARD) {
+                search_query->lowerbound = std::max(search_query->lowerbound, cp.timestamp);
+            } else {
+                search_query->upperbound = std::min(search_query->upperbound, cp.timestamp);
+            }
+            return new CursorImpl(storage_, std::move(search_query), &cp);
+        }
+        return new CursorImpl(storage_, std::move(search_query));
+    }
+
+    CursorImpl* select_aggregate(aku_SelectQuery* query, aku_Duration bucket_width, int value_type) {
+        return new CursorImpl(storage_, make_search_query(query), bucket_width, value_type);
+    }
+
+    aku_Status select_batch(aku_SelectQuery** queries, uint32_t n_queries, aku_select_batch_cb_t callback, void* user_data) {
+        std::vector<std::unique_ptr<SearchQuery>> search_queries;
+        std::vector<SearchQuery const*> pqueries;
+        for (uint32_t i = 0; i < n_queries; i++) {
+            search_queries.push_back(make_search_query(queries[i]));
+            search_queries.back()->order = AKU_ORDER_BY_TIME;
+            pqueries.push_back(search_queries.back().get());
+        }
+        SharedScan scan(pqueries);
+        auto search = [this](SearchQuery const& query) -> std::unique_ptr<ExternalCursor> {
+            return storage_.search(query);
+        };
+        auto fn = [callback, user_data](size_t query_ix, CursorColumns const& batch) {
+            callback(user_data, static_cast<uint32_t>(query_ix), batch.timestamps, batch.params,
+                     batch.pointers, batch.lengths, batch.size);
+        };
+        return scan.run(search, fn);
+    }
+
+    AsyncQueryImpl* select_async(aku_SelectQuery* query, size_t batch_size, aku_select_cb_t callback, void* user_data) {
+        return new AsyncQueryImpl(storage_, make_search_query(query), batch_size, callback, user_data);
+    }
+
+    SubscriptionImpl* subscribe(aku_SelectQuery* query, int mode, size_t capacity) {
+        if (mode != AKU_SUBSCRIBE_ORDERED && mode != AKU_SUBSCRIBE_MAY_REORDER) {
+            return nullptr;
+        }
+        return new SubscriptionImpl(storage_.subscriptions_, make_search_query(query), mode, capacity);
+    }
+
+    aku_Status select_last(uint32_t n_params, aku_ParamId const* params, aku_TimeStamp* timestamps,
+                           aku_PData* pointers, uint32_t* lengths)
+    {
+        CursorColumns columns = { timestamps, nullptr, pointers, lengths, n_params };
+        return storage_.select_last(params, n_params, columns);
     }
 
     aku_Status add_sample(aku_ParamId param_id, aku_TimeStamp ts, aku_MemRange value) {
@@ -250,12 +367,29 @@ aku_SelectQuery* aku_make_select_query(aku_TimeStamp begin, aku_TimeStamp end, u
     auto res = reinterpret_cast<aku_SelectQuery*>(p);
     res->begin = begin;
     res->end = end;
+    res->min_id = 1u;
+    res->max_id = 0u;
+    res->parallelism = 0u;
+    res->order = AKU_ORDER_BY_TIME;
     res->n_params = n_params;
     memcpy(&res->params, params, n_params*sizeof(aku_ParamId));
     std::sort(res->params, res->params + n_params);
     return res;
 }
 
+aku_SelectQuery* aku_make_select_range_query(aku_TimeStamp begin, aku_TimeStamp end, aku_ParamId min_id, aku_ParamId max_id) {
+    auto p = malloc(sizeof(aku_SelectQuery));
+    auto res = reinterpret_cast<aku_SelectQuery*>(p);
+    res->begin = begin;
+    res->end = end;
+    res->min_id = min_id;
+    res->max_id = max_id;
+    res->parallelism = 0u;
+    res->order = AKU_ORDER_BY_TIME;
+    res->n_params = 0u;
+    return res;
+}
+
 void aku_destroy(void* any) {
     free(any);
 }
@@ -265,6 +399,11 @@ aku_Cursor* aku_select(aku_Database *db, aku_SelectQuery* query) {
     return dbi->select(query);
 }
 
+aku_Cursor* aku_select_resume(aku_Database* db, aku_SelectQuery* query, aku_CursorToken const* token) {
+    auto dbi = reinterpret_cast<DatabaseImpl*>(db);
+    return dbi->select(query, token);
+}
+
 void aku_close_cursor(aku_Cursor* pcursor) {
     CursorImpl* pimpl = reinterpret_cast<CursorImpl*>(pcursor);
     delete pimpl;
@@ -282,6 +421,102 @@ int aku_cursor_read_columns( aku_Cursor      *pcursor
     return pimpl->read_columns(timestamps, params, pointers, lengths, arrays_size);
 }
 
+aku_Status aku_select_last( aku_Database    *db
+                          , uint32_t         n_params
+                          , aku_ParamId const *params
+                          , aku_TimeStamp   *timestamps
+                          , aku_PData       *pointers
+                          , uint32_t        *lengths )
+{
+    auto dbi = reinterpret_cast<DatabaseImpl*>(db);
+    return dbi->select_last(n_params, params, timestamps, pointers, lengths);
+}
+
+aku_Cursor* aku_select_aggregate( aku_Database    *db
+                                 , aku_SelectQuery *query
+                                 , uint64_t         bucket_width
+                                 , int              value_type )
+{
+    auto dbi = reinterpret_cast<DatabaseImpl*>(db);
+    return dbi->select_aggregate(query, bucket_width, value_type);
+}
+
+int aku_cursor_read_aggregates(aku_Cursor* pcursor, aku_AggregateRow* rows, size_t size) {
+    CursorImpl* pimpl = reinterpret_cast<CursorImpl*>(pcursor);
+    return pimpl->read_aggregates(rows, size);
+}
+
+aku_Status aku_select_batch( aku_Database           *db
+                           , aku_SelectQuery       **queries
+                           , uint32_t                n_queries
+                           , aku_select_batch_cb_t   callback
+                           , void                   *user_data )
+{
+    auto dbi = reinterpret_cast<DatabaseImpl*>(db);
+    return dbi->select_batch(queries, n_queries, callback, user_data);
+}
+
+aku_AsyncQuery* aku_select_async( aku_Database    *db
+                                 , aku_SelectQuery *query
+                                 , size_t           batch_size
+                                 , aku_select_cb_t  callback
+                                 , void            *user_data )
+{
+    auto dbi = reinterpret_cast<DatabaseImpl*>(db);
+    return dbi->select_async(query, batch_size, callback, user_data);
+}
+
+void aku_async_request(aku_AsyncQuery* pquery, uint32_t n_batches) {
+    AsyncQueryImpl* pimpl = reinterpret_cast<AsyncQueryImpl*>(pquery);
+    pimpl->query_->request(n_batches);
+}
+
+void aku_async_cancel(aku_AsyncQuery* pquery) {
+    AsyncQueryImpl* pimpl = reinterpret_cast<AsyncQueryImpl*>(pquery);
+    pimpl->query_->cancel();
+}
+
+void aku_async_close(aku_AsyncQuery* pquery) {
+    AsyncQueryImpl* pimpl = reinterpret_cast<AsyncQueryImpl*>(pquery);
+    delete pimpl;
+}
+
+aku_Subscription* aku_subscribe( aku_Database    *db
+                               , aku_SelectQuery *query
+                               , int              mode
+                               , size_t           capacity )
+{
+    auto dbi = reinterpret_cast<DatabaseImpl*>(db);
+    return dbi->subscribe(query, mode, capacity);
+}
+
+int aku_subscription_read( aku_Subscription *psub
+                         , aku_TimeStamp    *timestamps
+                         , aku_ParamId      *params
+                         , aku_PData        *pointers
+                         , uint32_t         *lengths
+                         , size_t            size )
+{
+    SubscriptionImpl* pimpl = reinterpret_cast<SubscriptionImpl*>(psub);
+    CursorColumns columns = { timestamps, params, pointers, lengths, size };
+    return pimpl->subscription_->read(columns);
+}
+
+uint64_t aku_subscription_dropped(aku_Subscription* psub) {
+    SubscriptionImpl* pimpl = reinterpret_cast<SubscriptionImpl*>(psub);
+    return pimpl->subscription_->get_dropped();
+}
+
+void aku_unsubscribe(aku_Subscription* psub) {
+    SubscriptionImpl* pimpl = reinterpret_cast<SubscriptionImpl*>(psub);
+    delete pimpl;
+}
+
+void aku_cursor_checkpoint(aku_Cursor* pcursor, aku_CursorToken* token) {
+    CursorImpl* pimpl = reinterpret_cast<CursorImpl*>(pcursor);
+    pimpl->checkpoint(token);
+}
+
 bool aku_cursor_is_done(aku_Cursor* pcursor) {
     CursorImpl* pimpl = reinterpret_cast<CursorImpl*>(pcursor);
     return pimpl->is_done();
@@ -0,0 +1,127 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "async_query.h"
+
+namespace Akumuli {
+
+typedef std::unique_lock<std::mutex> Lock;
+
+AsyncQuery::AsyncQuery(std::unique_ptr<SearchQuery> query,
+                       std::unique_ptr<ExternalCursor> cursor,
+                       size_t batch_size,
+                       Callback callback,
+                       WorkerPool& pool)
+    : query_(std::move(query))
+    , cursor_(std::move(cursor))
+    , batch_size_(std::max(batch_size, size_t(1)))
+    , callback_(callback)
+    , pool_(pool)
+    , timestamps_(batch_size_)
+    , params_(batch_size_)
+    , pointers_(batch_size_)
+    , lengths_(batch_size_)
+    , credits_(0u)
+    , running_(false)
+    , canceled_(false)
+    , finished_(false)
+{
+}
+
+void AsyncQuery::request(size_t n_batches) {
+    Lock guard(mutex_);
+    credits_ += n_batches;
+    schedule_();
+}
+
+void AsyncQuery::cancel() {
+    Lock guard(mutex_);
+    canceled_ = true;
+    schedule_();
+}
+
+void AsyncQuery::close() {
+    Lock guard(mutex_);
+    canceled_ = true;
+    schedule_();
+    cond_.wait(guard, [this]() { return finished_; });
+}
+
+void AsyncQuery::schedule_() {
+    if (running_ || finished_ || (credits_ == 0 && !canceled_)) {
+        return;
+    }
+    running_ = true;
+    auto self = shared_from_this();
+    pool_.submit([self]() { self->run_(); });
+}
+
+void AsyncQuery::run_() {
+    Lock guard(mutex_);
+    if (canceled_) {
+        guard.unlock();
+        finish_(AKU_ECANCELED);
+        return;
+    }
+    guard.unlock();
+
+    CursorColumns batch = { timestamps_.data(), params_.data(), pointers_.data(), lengths_.data(), batch_size_ };
+    int nread = 0;
+    int error_code = AKU_SUCCESS;
+    bool error = false;
+    while (nread == 0 && !error && !cursor_->is_done()) {
+        nread = cursor_->read_columns(batch);
+        error = cursor_->is_error(&error_code);
+    }
+    if (nread) {
+        batch.size = static_cast<size_t>(nread);
+        callback_(AKU_SUCCESS, false, batch);
+    }
+    if (error || cursor_->is_done()) {
+        finish_(error ? error_code : AKU_SUCCESS);
+        return;
+    }
+
+    guard.lock();
+    credits_--;
+    running_ = false;
+    // Next batch is read by the next task, other queries can run in between
+    schedule_();
+}
+
+void AsyncQuery::finish_(aku_Status status) {
+    cursor_->close();
+    cursor_.reset();
+    query_.reset();
+    CursorColumns empty = { nullptr, nullptr, nullptr, nullptr, 0u };
+    callback_(status, true, empty);
+    Lock guard(mutex_);
+    finished_ = true;
+    running_ = false;
+    cond_.notify_all();
+}
+
+WorkerPool& AsyncQuery::get_pool() {
+    // Separate pool is used because query can wait for the tasks of the global pool
+    static WorkerPool pool(std::max(2u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+}  // namespace
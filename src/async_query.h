@@ -0,0 +1,102 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Asynchronous query execution.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "cursor.h"
+#include "worker_pool.h"
+
+namespace Akumuli {
+
+/** Asynchronous query.
+  * Reads results of the cursor on the worker thread and delivers them to
+  * the callback in column batches. Consumer controls the rate: every request
+  * allows delivery of one batch, cursor is not read if there are no requests.
+  * Callback is never called concurrently. The last call has `done` flag set,
+  * empty batch and final status of the query (AKU_ECANCELED if query was
+  * canceled).
+  * Should be created using std::make_shared.
+  */
+class AsyncQuery : public std::enable_shared_from_this<AsyncQuery> {
+public:
+    typedef std::function<void(aku_Status status, bool done, CursorColumns const& batch)> Callback;
+
+    /** C-tor
+      * @param query search query, kept alive while cursor is in use (can be null)
+      * @param cursor cursor that produces results
+      * @param batch_size max number of results in batch
+      * @param callback results receiver
+      * @param pool worker pool used to read cursor, tasks of this pool can
+      *        block waiting for tasks of the global pool
+      */
+    AsyncQuery(std::unique_ptr<SearchQuery> query,
+               std::unique_ptr<ExternalCursor> cursor,
+               size_t batch_size,
+               Callback callback,
+               WorkerPool& pool);
+
+    //! Allow delivery of `n_batches` more batches
+    void request(size_t n_batches);
+
+    //! Stop the query, cursor is closed and callback is called with AKU_ECANCELED status
+    void cancel();
+
+    /** Cancel query and wait for the last callback call.
+      * Must not be called from the callback.
+      */
+    void close();
+
+    //! Pool for asynchronous queries
+    static WorkerPool& get_pool();
+
+private:
+    //! Schedule read task if needed (mutex should be locked)
+    void schedule_();
+
+    //! Read and deliver one batch (executed by worker thread)
+    void run_();
+
+    //! Close cursor and deliver final status (executed by worker thread)
+    void finish_(aku_Status status);
+
+    std::unique_ptr<SearchQuery>        query_;
+    std::unique_ptr<ExternalCursor>     cursor_;
+    const size_t                        batch_size_;
+    Callback                            callback_;
+    WorkerPool&                         pool_;
+    std::vector<aku_TimeStamp>          timestamps_;
+    std::vector<aku_ParamId>            params_;
+    std::vector<aku_PData>              pointers_;
+    std::vector<uint32_t>               lengths_;
+    std::mutex                          mutex_;
+    std::condition_variable             cond_;
+    size_t                              credits_;       //< Number of batches that can be delivered
+    bool                                running_;       //< Task is scheduled or running
+    bool                                canceled_;
+    bool                                finished_;      //< Last callback call is done
+};
+
+}  // namespace
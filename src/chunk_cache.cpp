@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "chunk_cache.h"
+
+namespace Akumuli {
+
+bool ChunkKey::operator == (ChunkKey const& other) const {
+    return page_id    == other.page_id
+        && open_count == other.open_count
+        && offset     == other.offset;
+}
+
+size_t ChunkKeyHash::operator () (ChunkKey const& key) const {
+    // offsets are unique inside the page and grow down from the
+    // end of the page, page_id and open_count are small numbers
+    uint64_t hash = key.offset;
+    hash ^= static_cast<uint64_t>(key.page_id) << 32;
+    hash ^= static_cast<uint64_t>(key.open_count) << 48;
+    hash *= 0x9E3779B97F4A7C15ul;  // fibonacci hashing
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+ChunkCache::Shard::Shard()
+    : size(0u)
+{
+}
+
+ChunkCache::ChunkCache(size_t max_size)
+    : shard_max_size_(max_size / NUM_SHARDS)
+    , shards_(NUM_SHARDS)
+{
+}
+
+size_t ChunkCache::estimate_size(ChunkHeader const& chunk) {
+    return sizeof(ChunkHeader)
+         + sizeof(LRUItem)
+         + chunk.timestamps.capacity()*sizeof(aku_TimeStamp)
+         + chunk.paramids.capacity()*sizeof(aku_ParamId)
+         + chunk.offsets.capacity()*sizeof(uint32_t)
+         + chunk.lengths.capacity()*sizeof(uint32_t);
+}
+
+ChunkCache::Shard& ChunkCache::get_shard(ChunkKey const& key) {
+    ChunkKeyHash hash;
+    return shards_[hash(key) % NUM_SHARDS];
+}
+
+ChunkCache::PChunk ChunkCache::get(ChunkKey const& key) {
+    Shard& shard = get_shard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it == shard.index.end()) {
+        return PChunk();
+    }
+    // move to front
+    shard.items.splice(shard.items.begin(), shard.items, it->second);
+    return it->second->second;
+}
+
+void ChunkCache::put(ChunkKey const& key, PChunk chunk) {
+    auto chunk_size = estimate_size(*chunk);
+    if (chunk_size > shard_max_size_) {
+        // chunk is too large and will evict everything else
+        return;
+    }
+    Shard& shard = get_shard(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // other cursor decoded the same chunk concurrently
+        shard.items.splice(shard.items.begin(), shard.items, it->second);
+        return;
+    }
+    while (!shard.items.empty() && shard.size + chunk_size > shard_max_size_) {
+        auto const& last = shard.items.back();
+        shard.size -= estimate_size(*last.second);
+        shard.index.erase(last.first);
+        shard.items.pop_back();
+    }
+    shard.items.push_front(std::make_pair(key, chunk));
+    shard.index[key] = shard.items.begin();
+    shard.size += chunk_size;
+}
+
+size_t ChunkCache::get_size() const {
+    size_t result = 0u;
+    for (auto const& shard: shards_) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        result += shard.size;
+    }
+    return result;
+}
+
+}  // namespace
@@ -0,0 +1,98 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Cache of decoded chunks shared between cursors.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "page.h"
+
+namespace Akumuli {
+
+/** Decoded chunk identifier.
+  * Chunk data is immutable until the page is reused, open_count
+  * is incremented on every reuse so old entries never match.
+  */
+struct ChunkKey {
+    uint32_t        page_id;        //< page index in storage
+    uint32_t        open_count;     //< page generation
+    aku_EntryOffset offset;         //< chunk data offset
+
+    bool operator == (ChunkKey const& other) const;
+};
+
+struct ChunkKeyHash {
+    size_t operator () (ChunkKey const& key) const;
+};
+
+
+/** Bounded LRU cache of decoded chunks.
+  * Cache is split into several independent shards to reduce lock
+  * contention, memory limit is divided evenly between shards.
+  */
+class ChunkCache {
+public:
+    typedef std::shared_ptr<const ChunkHeader> PChunk;
+
+    static const int NUM_SHARDS = 16;
+
+    /** C-tor
+      * @param max_size memory limit in bytes
+      */
+    ChunkCache(size_t max_size);
+
+    //! Find chunk in cache, returns empty pointer if nothing found
+    PChunk get(ChunkKey const& key);
+
+    //! Add decoded chunk to cache, least recently used chunks will be evicted
+    void put(ChunkKey const& key, PChunk chunk);
+
+    //! Return estimated memory usage in bytes
+    size_t get_size() const;
+
+    //! Estimate memory used by decoded chunk
+    static size_t estimate_size(ChunkHeader const& chunk);
+
+private:
+    typedef std::pair<ChunkKey, PChunk>                                 LRUItem;
+    typedef std::list<LRUItem>                                          LRUList;
+    typedef std::unordered_map<ChunkKey, LRUList::iterator, ChunkKeyHash> LRUIndex;
+
+    struct Shard {
+        mutable std::mutex  mutex;
+        LRUList             items;      //< most recently used chunks first
+        LRUIndex            index;
+        size_t              size;       //< current size in bytes
+
+        Shard();
+    };
+
+    Shard& get_shard(ChunkKey const& key);
+
+    const size_t        shard_max_size_;
+    std::vector<Shard>  shards_;
+};
+
+}  // namespace
@@ -22,11 +22,57 @@
 namespace Akumuli {
 
 
+bool InternalCursor::put_batch(Caller& caller, CursorResult const* results, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (!put(caller, results[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+int ExternalCursor::read_columns(CursorColumns const& columns) {
+    const size_t BUF_LEN = 0x100;
+    CursorResult buffer[BUF_LEN];
+    int nread = read(buffer, static_cast<int>(std::min(columns.size, BUF_LEN)));
+    columns.set(0u, buffer, static_cast<size_t>(nread));
+    return nread;
+}
+
+bool ExternalCursor::get_position(PageScanPosition*) const {
+    return false;
+}
+
+//! Read results from the queue of batches using `write(index, results, size)`
+template<class Writer>
+static int read_batches(std::deque<std::vector<CursorResult>>& batches, size_t& read_pos, int buf_len, Writer const& write) {
+    int nread = 0;
+    while (nread < buf_len && !batches.empty()) {
+        auto const& batch = batches.front();
+        auto n = std::min(batch.size() - read_pos, static_cast<size_t>(buf_len - nread));
+        write(static_cast<size_t>(nread), batch.data() + read_pos, n);
+        nread += static_cast<int>(n);
+        read_pos += n;
+        if (read_pos == batch.size()) {
+            batches.pop_front();
+            read_pos = 0u;
+        }
+    }
+    return nread;
+}
+
+
 bool RecordingCursor::put(Caller &, const CursorResult &result) {
     results.push_back(result);
     return true;
 }
 
+bool RecordingCursor::put_batch(Caller&, CursorResult const* batch, size_t size) {
+    results.insert(results.end(), batch, batch + size);
+    return true;
+}
+
 void RecordingCursor::complete(Caller&) {
     completed = true;
 }
@@ -176,6 +222,25 @@ bool CoroCursor::put(Caller& caller, CursorResult const& result) {
     return true;
 }
 
+bool CoroCursor::put_batch(Caller& caller, CursorResult const* results, size_t size) {
+    while (size) {
+        if (closed_) {
+            return false;
+        }
+        if (write_index_ >= usr_buffer_len_) {
+            // yield control to client
+            caller();
+            continue;
+        }
+        auto n = std::min(size, static_cast<size_t>(usr_buffer_len_ - write_index_));
+        std::copy(results, results + n, usr_buffer_ + write_index_);
+        write_index_ += static_cast<int>(n);
+        results += n;
+        size -= n;
+    }
+    return !closed_;
+}
+
 void CoroCursor::complete(Caller& caller) {
     complete_ = true;
     caller();
@@ -209,106 +274,99 @@ struct HeapPred {
 FanInCursorCombinator::FanInCursorCombinator(ExternalCursor **cursors, int size, int direction)
     : in_cursors_(cursors, cursors + size)
     , direction_(direction)
-    , out_cursor_()
+    , buffer_(0x200)
+    , started_(false)
+    , done_(false)
+    , error_(false)
+    , error_code_(AKU_SUCCESS)
 {
-    out_cursor_.start(std::bind(&FanInCursorCombinator::read_impl_, this, std::placeholders::_1));
 }
 
-void FanInCursorCombinator::read_impl_(Caller& caller) {
-#ifdef DEBUG
-    CursorResult dbg_prev_item;
-    bool dbg_first_item = true;
-    long dbg_counter = 0;
-#endif
-    // Check preconditions
-    int error = 0;
-    for (auto cursor: in_cursors_) {
-        if (cursor->is_error(&error)) {
-            out_cursor_.set_error(caller, error);
-            return;
+bool FanInCursorCombinator::refill_(int cur_index) {
+    ExternalCursor* cursor = in_cursors_[cur_index];
+    int nwrites = cursor->read(buffer_.data(), static_cast<int>(buffer_.size()));
+    if (cursor->is_error(&error_code_)) {
+        error_ = true;
+        done_ = true;
+        return false;
+    }
+    HeapPred pred = { direction_ };
+    for (int buf_ix = 0; buf_ix < nwrites; buf_ix++) {
+        heap_.push_back(std::make_tuple(buffer_[buf_ix], cur_index, nwrites - buf_ix));
+        if (started_) {
+            std::push_heap(heap_.begin(), heap_.end(), pred);
         }
     }
+    return true;
+}
 
-    typedef std::vector<HeapItem> Heap;
-    Heap heap;
+template<class Writer>
+int FanInCursorCombinator::read_impl_(Writer const& write, int buf_len)
+{
     HeapPred pred = { direction_ };
-
-    const int BUF_LEN = 0x200;
-    CursorResult buffer[BUF_LEN];
-    for(auto cur_index = 0u; cur_index < in_cursors_.size(); cur_index++) {
-        if (!in_cursors_[cur_index]->is_done()) {
-            ExternalCursor* cursor = in_cursors_[cur_index];
-            int nwrites = cursor->read(buffer, BUF_LEN);
-            if (cursor->is_error(&error)) {
-                out_cursor_.set_error(caller, error);
-                return;
+    if (!started_) {
+        // Check preconditions
+        for (auto cursor: in_cursors_) {
+            if (cursor->is_error(&error_code_)) {
+                error_ = true;
+                done_ = true;
+                return 0;
             }
-            for (int buf_ix = 0; buf_ix < nwrites; buf_ix++) {
-                auto cur_count = nwrites - buf_ix;
-                auto key = std::make_tuple(buffer[buf_ix], cur_index, cur_count);
-                heap.push_back(key);
+        }
+        for(auto cur_index = 0u; cur_index < in_cursors_.size(); cur_index++) {
+            if (!in_cursors_[cur_index]->is_done() && !refill_(static_cast<int>(cur_index))) {
+                return 0;
             }
         }
+        std::make_heap(heap_.begin(), heap_.end(), pred);
+        started_ = true;
     }
 
-    std::make_heap(heap.begin(), heap.end(), pred);
-
-    while(!heap.empty()) {
-        std::pop_heap(heap.begin(), heap.end(), pred);
-        auto item = heap.back();
-        const CursorResult& cur_result = std::get<0>(item);
+    int nresults = 0;
+    while (!done_ && nresults < buf_len && !heap_.empty()) {
+        std::pop_heap(heap_.begin(), heap_.end(), pred);
+        auto const& item = heap_.back();
         int cur_index = std::get<1>(item);
         int cur_count = std::get<2>(item);
-#ifdef DEBUG
-        auto dbg_time_stamp = cur_result.timestamp;
-        auto dbg_param_id = cur_result.param_id;
-        AKU_UNUSED(dbg_time_stamp);
-        AKU_UNUSED(dbg_param_id);
-        if (!dbg_first_item) {
-            bool cmp_res = false;
-            if (direction_ == AKU_CURSOR_DIR_FORWARD) {
-                cmp_res = dbg_prev_item.timestamp <= std::get<0>(item).timestamp;
-            } else {
-                cmp_res = dbg_prev_item.timestamp >= std::get<0>(item).timestamp;
-            }
-            assert(cmp_res);
-        }
-        dbg_prev_item = std::get<0>(item);
-        dbg_first_item = false;
-        dbg_counter++;
-#endif
-        out_cursor_.put(caller, cur_result);
-        heap.pop_back();
+        write(static_cast<size_t>(nresults++), std::get<0>(item));
+        heap_.pop_back();
         if (cur_count == 1 && !in_cursors_[cur_index]->is_done()) {
-            ExternalCursor* cursor = in_cursors_[cur_index];
-            int nwrites = cursor->read(buffer, BUF_LEN);
-            if (cursor->is_error(&error)) {
-                out_cursor_.set_error(caller, error);
-                return;
-            }
-            for (int buf_ix = 0; buf_ix < nwrites; buf_ix++) {
-                auto key = std::make_tuple(buffer[buf_ix], cur_index, nwrites - buf_ix);
-                heap.push_back(key);
-                std::push_heap(heap.begin(), heap.end(), pred);
-            }
+            refill_(cur_index);
         }
     }
-    out_cursor_.complete(caller);
+    if (heap_.empty()) {
+        done_ = true;
+    }
+    return nresults;
 }
 
 int FanInCursorCombinator::read(CursorResult *buf, int buf_len)
 {
-    return out_cursor_.read(buf, buf_len);
+    auto write = [buf](size_t ix, CursorResult const& result) {
+        buf[ix] = result;
+    };
+    return read_impl_(write, buf_len);
+}
+
+int FanInCursorCombinator::read_columns(CursorColumns const& columns)
+{
+    auto write = [&columns](size_t ix, CursorResult const& result) {
+        columns.set(ix, result);
+    };
+    return read_impl_(write, static_cast<int>(columns.size));
 }
 
 bool FanInCursorCombinator::is_done() const
 {
-    return out_cursor_.is_done();
+    return done_;
 }
 
 bool FanInCursorCombinator::is_error(int *out_error_code_or_null) const
 {
-    return out_cursor_.is_error(out_error_code_or_null);
+    if (out_error_code_or_null) {
+        *out_error_code_or_null = error_code_;
+    }
+    return error_;
 }
 
 void FanInCursorCombinator::close()
@@ -316,7 +374,314 @@ void FanInCursorCombinator::close()
     for (auto cursor: in_cursors_) {
         cursor->close();
     }
-    return out_cursor_.close();
+    heap_.clear();
+    done_ = true;
+}
+
+
+
+// ConcatCursor implementation
+
+ConcatCursor::ConcatCursor(ExternalCursor **cursors, int size)
+    : in_cursors_(cursors, cursors + size)
+    , current_(0u)
+    , error_(false)
+    , error_code_(AKU_SUCCESS)
+{
+}
+
+template<class Reader>
+int ConcatCursor::read_impl_(Reader const& read)
+{
+    while (!error_ && current_ < in_cursors_.size()) {
+        ExternalCursor* cursor = in_cursors_[current_];
+        if (cursor->is_done()) {
+            current_++;
+            continue;
+        }
+        int nwrites = read(cursor);
+        if (cursor->is_error(&error_code_)) {
+            error_ = true;
+            return nwrites;
+        }
+        if (nwrites != 0) {
+            return nwrites;
+        }
+    }
+    return 0;
+}
+
+int ConcatCursor::read(CursorResult *buf, int buf_len)
+{
+    return read_impl_([buf, buf_len](ExternalCursor* cursor) {
+        return cursor->read(buf, buf_len);
+    });
+}
+
+int ConcatCursor::read_columns(CursorColumns const& columns)
+{
+    return read_impl_([&columns](ExternalCursor* cursor) {
+        return cursor->read_columns(columns);
+    });
+}
+
+bool ConcatCursor::is_done() const
+{
+    if (error_) {
+        return true;
+    }
+    for (auto ix = current_; ix < in_cursors_.size(); ix++) {
+        if (!in_cursors_[ix]->is_done()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ConcatCursor::is_error(int *out_error_code_or_null) const
+{
+    if (out_error_code_or_null) {
+        *out_error_code_or_null = error_code_;
+    }
+    return error_;
+}
+
+void ConcatCursor::close()
+{
+    for (auto cursor: in_cursors_) {
+        cursor->close();
+    }
+}
+
+bool ConcatCursor::get_position(PageScanPosition* position) const
+{
+    // Cursors before the current one are done, next cursors are not started
+    for (auto ix = current_; ix < in_cursors_.size(); ix++) {
+        if (!in_cursors_[ix]->is_done()) {
+            return in_cursors_[ix]->get_position(position);
+        }
+    }
+    return false;
+}
+
+
+
+// QueueCursor implementation
+
+QueueCursor::QueueCursor()
+    : read_pos_(0u)
+    , complete_(false)
+    , error_(false)
+    , error_code_(AKU_SUCCESS)
+    , closed_(false)
+{
+    current_.reserve(BATCH_SIZE);
+}
+
+bool QueueCursor::flush_() {
+    std::unique_lock<std::mutex> guard(mutex_);
+    cond_.wait(guard, [this]() { return closed_ || batches_.size() < MAX_BATCHES; });
+    if (closed_) {
+        current_.clear();
+        return false;
+    }
+    if (!current_.empty()) {
+        batches_.push_back(std::move(current_));
+        current_ = std::vector<CursorResult>();
+        current_.reserve(BATCH_SIZE);
+        cond_.notify_all();
+    }
+    return true;
+}
+
+int QueueCursor::read(CursorResult* buf, int buf_len) {
+    std::unique_lock<std::mutex> guard(mutex_);
+    cond_.wait(guard, [this]() { return !batches_.empty() || complete_; });
+    int nread = read_batches(batches_, read_pos_, buf_len, [buf](size_t ix, CursorResult const* results, size_t n) {
+        std::copy(results, results + n, buf + ix);
+    });
+    cond_.notify_all();
+    return nread;
+}
+
+int QueueCursor::read_columns(CursorColumns const& columns) {
+    std::unique_lock<std::mutex> guard(mutex_);
+    cond_.wait(guard, [this]() { return !batches_.empty() || complete_; });
+    int nread = read_batches(batches_, read_pos_, static_cast<int>(columns.size),
+                             [&columns](size_t ix, CursorResult const* results, size_t n) {
+        columns.set(ix, results, n);
+    });
+    cond_.notify_all();
+    return nread;
+}
+
+bool QueueCursor::is_done() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return complete_ && batches_.empty();
+}
+
+bool QueueCursor::is_error(int* out_error_code_or_null) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (out_error_code_or_null) {
+        *out_error_code_or_null = error_code_;
+    }
+    return error_;
+}
+
+void QueueCursor::close() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    closed_ = true;
+    cond_.notify_all();
+}
+
+bool QueueCursor::put(Caller&, CursorResult const& result) {
+    current_.push_back(result);
+    if (current_.size() == static_cast<size_t>(BATCH_SIZE)) {
+        return flush_();
+    }
+    return true;
+}
+
+bool QueueCursor::put_batch(Caller&, CursorResult const* results, size_t size) {
+    while (size) {
+        auto n = std::min(size, static_cast<size_t>(BATCH_SIZE) - current_.size());
+        current_.insert(current_.end(), results, results + n);
+        results += n;
+        size -= n;
+        if (current_.size() == static_cast<size_t>(BATCH_SIZE) && !flush_()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void QueueCursor::complete(Caller&) {
+    flush_();
+    std::lock_guard<std::mutex> guard(mutex_);
+    complete_ = true;
+    cond_.notify_all();
+}
+
+void QueueCursor::set_error(Caller&, int error_code) {
+    flush_();
+    std::lock_guard<std::mutex> guard(mutex_);
+    error_ = true;
+    error_code_ = error_code;
+    complete_ = true;
+    cond_.notify_all();
+}
+
+
+// AsyncCursor implementation
+
+AsyncCursor::AsyncCursor(ExternalCursor* cursor, std::shared_ptr<TaskGroup> group)
+    : cursor_(cursor)
+    , group_(group)
+    , read_pos_(0u)
+    , running_(false)
+    , done_(false)
+    , error_(false)
+    , error_code_(AKU_SUCCESS)
+    , closed_(false)
+{
+}
+
+AsyncCursor::~AsyncCursor() {
+    close();
+}
+
+void AsyncCursor::start() {
+    std::lock_guard<std::mutex> guard(mutex_);
+    schedule_();
+}
+
+void AsyncCursor::schedule_() {
+    if (running_ || done_ || closed_ || batches_.size() >= MAX_BATCHES) {
+        return;
+    }
+    running_ = true;
+    group_->submit(std::bind(&AsyncCursor::read_batch_, this));
+}
+
+void AsyncCursor::read_batch_() {
+    std::vector<CursorResult> batch(BATCH_SIZE);
+    int nwrites = 0;
+    int error_code = AKU_SUCCESS;
+    bool error = false;
+    bool done = cursor_->is_done();
+    if (!done) {
+        nwrites = cursor_->read(batch.data(), BATCH_SIZE);
+        error = cursor_->is_error(&error_code);
+        done = error || cursor_->is_done();
+    }
+    batch.resize(nwrites);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (nwrites) {
+        batches_.push_back(std::move(batch));
+    }
+    if (error) {
+        error_ = true;
+        error_code_ = error_code;
+    }
+    done_ = done;
+    running_ = false;
+    // Continue reading in the next task, other cursors of the group can run in between
+    schedule_();
+    cond_.notify_all();
+}
+
+int AsyncCursor::read(CursorResult *buf, int buf_len)
+{
+    std::unique_lock<std::mutex> guard(mutex_);
+    schedule_();
+    cond_.wait(guard, [this]() { return !batches_.empty() || done_; });
+    int nread = read_batches(batches_, read_pos_, buf_len, [buf](size_t ix, CursorResult const* results, size_t n) {
+        std::copy(results, results + n, buf + ix);
+    });
+    schedule_();
+    return nread;
+}
+
+int AsyncCursor::read_columns(CursorColumns const& columns)
+{
+    std::unique_lock<std::mutex> guard(mutex_);
+    schedule_();
+    cond_.wait(guard, [this]() { return !batches_.empty() || done_; });
+    int nread = read_batches(batches_, read_pos_, static_cast<int>(columns.size),
+                             [&columns](size_t ix, CursorResult const* results, size_t n) {
+        columns.set(ix, results, n);
+    });
+    schedule_();
+    return nread;
+}
+
+bool AsyncCursor::is_done() const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return done_ && batches_.empty();
+}
+
+bool AsyncCursor::is_error(int *out_error_code_or_null) const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (out_error_code_or_null) {
+        *out_error_code_or_null = error_code_;
+    }
+    return error_;
+}
+
+void AsyncCursor::close()
+{
+    std::unique_lock<std::mutex> guard(mutex_);
+    if (closed_) {
+        return;
+    }
+    closed_ = true;
+    // Wait for the read task, underlying cursor can't be used concurrently
+    cond_.wait(guard, [this]() { return !running_; });
+    guard.unlock();
+    cursor_->close();
 }
 
 }
@@ -23,11 +23,16 @@
 #pragma once
 
 #include <vector>
+#include <deque>
+#include <tuple>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include "akumuli.h"
 #include "internal_cursor.h"
 #include "page.h"
+#include "worker_pool.h"
 
 namespace Akumuli {
 
@@ -44,6 +49,7 @@ struct RecordingCursor : InternalCursor {
     int error_code = NO_ERROR;
 
     virtual bool put(Caller&, CursorResult const& result);
+    virtual bool put_batch(Caller&, CursorResult const* results, size_t size);
     virtual void complete(Caller&);
     virtual void set_error(Caller&, int error_code);
 };
@@ -81,18 +87,57 @@ struct DirectPageSyncCursor : InternalCursor {
 };
 
 
+/** Column-oriented output of the cursor.
+ *  Every column is optional, null columns are not written.
+ */
+struct CursorColumns {
+    aku_TimeStamp*  timestamps;
+    aku_ParamId*    params;
+    aku_PData*      pointers;
+    uint32_t*       lengths;
+    size_t          size;       //< Size of every column
+
+    //! Write result to the row `ix`
+    void set(size_t ix, CursorResult const& result) const {
+        if (timestamps) {
+            timestamps[ix] = result.timestamp;
+        }
+        if (params) {
+            params[ix] = result.param_id;
+        }
+        if (pointers) {
+            pointers[ix] = result.page->read_entry_data(result.data_offset);
+        }
+        if (lengths) {
+            lengths[ix] = result.length;
+        }
+    }
+
+    //! Write `n` results starting from the row `ix`
+    void set(size_t ix, CursorResult const* results, size_t n) const {
+        for (size_t i = 0; i < n; i++) {
+            set(ix + i, results[i]);
+        }
+    }
+};
+
+
 /** Data retreival interface that can be used by
  *  code that reads data from akumuli.
  */
 struct ExternalCursor {
     //! Read portion of the data to the buffer
     virtual int read(CursorResult* buf, int buf_len) = 0;
+    //! Read portion of the data directly to the output columns (uses temporary buffer by default)
+    virtual int read_columns(CursorColumns const& columns);
     //! Check is everything done
     virtual bool is_done() const = 0;
     //! Check is error occured and (optionally) get the error code
     virtual bool is_error(int* out_error_code_or_null=nullptr) const = 0;
     //! Finalizer
     virtual void close() = 0;
+    //! Get position of the page scan that produced the last results (returns false if unknown)
+    virtual bool get_position(PageScanPosition* position) const;
 
     virtual ~ExternalCursor() {}
 };
@@ -137,6 +182,8 @@ struct CoroCursor : Cursor {
 
     bool put(Caller& caller, CursorResult const& result);
 
+    bool put_batch(Caller& caller, CursorResult const* results, size_t size);
+
     void complete(Caller& caller);
 
     template<class Fn_1arg_caller>
@@ -184,12 +231,25 @@ struct CoroCursor : Cursor {
  * results from this cursors in one ordered
  * sequence of events.
  */
-class FanInCursorCombinator : ExternalCursor {
+class FanInCursorCombinator : public ExternalCursor {
+    //! Result, index of the cursor and number of buffered results of this cursor
+    typedef std::tuple<CursorResult, int, int> HeapItem;
+
     const std::vector<ExternalCursor*>  in_cursors_;
     const int                           direction_;
-    CoroCursor                          out_cursor_;
-
-    void read_impl_(Caller& caller);
+    std::vector<HeapItem>               heap_;          //< Merge heap
+    std::vector<CursorResult>           buffer_;        //< Read buffer
+    bool                                started_;       //< Heap is initialized
+    bool                                done_;          //< Is complete
+    bool                                error_;         //< Error flag
+    int                                 error_code_;    //< Error code
+
+    //! Read next portion of results from cursor to heap, returns false on error
+    bool refill_(int cur_index);
+
+    //! Write merged results using `write(index, result)`
+    template<class Writer>
+    int read_impl_(Writer const& write, int buf_len);
 public:
     /**
      * @brief C-tor
@@ -204,6 +264,149 @@ public:
     // ExternalCursor interface
 public:
     virtual int read(CursorResult *buf, int buf_len);
+    virtual int read_columns(CursorColumns const& columns);
+    virtual bool is_done() const;
+    virtual bool is_error(int *out_error_code_or_null) const;
+    virtual void close();
+};
+
+
+/**
+ * @brief Concatenating cursor.
+ * Reads cursors one after another. Cursors must
+ * be ordered and their results must not overlap,
+ * in this case output is ordered without merging.
+ */
+class ConcatCursor : public ExternalCursor {
+    const std::vector<ExternalCursor*>  in_cursors_;
+    size_t                              current_;       //< Index of the current cursor
+    bool                                error_;         //< Error flag
+    int                                 error_code_;    //< Error code
+
+    //! Read current cursor using `read(cursor)`
+    template<class Reader>
+    int read_impl_(Reader const& read);
+public:
+    /**
+     * @brief C-tor
+     * @param cursors array of pointer to cursors in output order
+     * @param size size of the cursors array
+     */
+    ConcatCursor(ExternalCursor** in_cursors, int size);
+
+    // ExternalCursor interface
+public:
+    virtual int read(CursorResult *buf, int buf_len);
+    virtual int read_columns(CursorColumns const& columns);
+    virtual bool is_done() const;
+    virtual bool is_error(int *out_error_code_or_null) const;
+    virtual void close();
+    virtual bool get_position(PageScanPosition* position) const;
+};
+
+
+/**
+ * @brief Queue cursor.
+ * Connects producer and consumer running in different threads.
+ * Results are passed through a bounded queue of batches, producer
+ * is blocked when queue is full and consumer is blocked when queue
+ * is empty. Producer thread should not be a worker pool thread.
+ */
+class QueueCursor : public Cursor {
+public:
+    enum {
+        BATCH_SIZE = 0x400,     //< max number of results in batch
+        MAX_BATCHES = 4,        //< queue capacity
+    };
+private:
+    mutable std::mutex                      mutex_;
+    std::condition_variable                 cond_;
+    std::deque<std::vector<CursorResult>>   batches_;       //< Results queue
+    std::vector<CursorResult>               current_;       //< Batch that is being filled by producer
+    size_t                                  read_pos_;      //< Read position in the first batch
+    bool                                    complete_;      //< Producer is done
+    bool                                    error_;         //< Error flag
+    int                                     error_code_;    //< Error code
+    bool                                    closed_;        //< Closed by consumer
+
+    //! Send current batch to consumer, returns false if cursor is closed
+    bool flush_();
+public:
+    QueueCursor();
+
+    // External cursor implementation
+
+    virtual int read(CursorResult* buf, int buf_len);
+
+    virtual int read_columns(CursorColumns const& columns);
+
+    virtual bool is_done() const;
+
+    virtual bool is_error(int* out_error_code_or_null=nullptr) const;
+
+    virtual void close();
+
+    // Internal cursor implementation
+
+    virtual bool put(Caller& caller, CursorResult const& result);
+
+    virtual bool put_batch(Caller& caller, CursorResult const* results, size_t size);
+
+    virtual void complete(Caller& caller);
+
+    virtual void set_error(Caller& caller, int error_code);
+};
+
+
+/**
+ * @brief Asynchronous cursor.
+ * Reads underlying cursor in worker threads ahead of the consumer.
+ * Results are stored in a bounded queue of batches, reading is
+ * suspended when queue is full and resumed by the consumer.
+ * Worker threads never block so any number of asynchronous
+ * cursors can share the same worker pool.
+ */
+class AsyncCursor : public ExternalCursor {
+public:
+    enum {
+        BATCH_SIZE = 0x400,     //< max number of results in batch
+        MAX_BATCHES = 4,        //< queue capacity
+    };
+private:
+    ExternalCursor*                         cursor_;        //< Underlying cursor (not owned)
+    std::shared_ptr<TaskGroup>              group_;
+    mutable std::mutex                      mutex_;
+    std::condition_variable                 cond_;
+    std::deque<std::vector<CursorResult>>   batches_;       //< Results queue
+    size_t                                  read_pos_;      //< Read position in the first batch
+    bool                                    running_;       //< Read task is scheduled or running
+    bool                                    done_;          //< Underlying cursor is done
+    bool                                    error_;         //< Error flag
+    int                                     error_code_;    //< Error code
+    bool                                    closed_;
+
+    //! Schedule read task if needed (mutex should be locked)
+    void schedule_();
+
+    //! Read one batch from underlying cursor (executed by worker thread)
+    void read_batch_();
+public:
+    /**
+     * @brief C-tor
+     * @param cursor underlying cursor, must outlive async cursor
+     * @param group task group used to execute reads
+     */
+    AsyncCursor(ExternalCursor* cursor, std::shared_ptr<TaskGroup> group);
+
+    ~AsyncCursor();
+
+    //! Start reading ahead
+    void start();
+
+    // ExternalCursor interface
+public:
+    virtual int read(CursorResult *buf, int buf_len);
+    virtual int read_columns(CursorColumns const& columns);
     virtual bool is_done() const;
     virtual bool is_error(int *out_error_code_or_null) const;
     virtual void close();
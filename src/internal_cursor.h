@@ -44,6 +44,8 @@ struct CursorResult;
 struct InternalCursor {
     //! Send offset to caller
     virtual bool put(Caller&, CursorResult const& offset) = 0;
+    //! Send array of offsets to caller (calls `put` for every element by default)
+    virtual bool put_batch(Caller&, CursorResult const* results, size_t size);
     virtual void complete(Caller&) = 0;
     //! Set error and stop execution
     virtual void set_error(Caller&, int error_code) = 0;
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "last_value.h"
+
+namespace Akumuli {
+
+LastValueTable::LastValueTable()
+    : shards_(NUM_SHARDS)
+{
+}
+
+LastValueTable::Shard& LastValueTable::get_shard(aku_ParamId param) {
+    // series ids are usually dense so modulo is good enough
+    return shards_[param % NUM_SHARDS];
+}
+
+LastValueTable::Shard const& LastValueTable::get_shard(aku_ParamId param) const {
+    return shards_[param % NUM_SHARDS];
+}
+
+void LastValueTable::update(aku_ParamId param, LastValue const& value) {
+    Shard& shard = get_shard(param);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.values.find(param);
+    if (it == shard.values.end()) {
+        Entry entry = { value, true, false };
+        shard.values.insert(std::make_pair(param, entry));
+    } else if (!it->second.has_value || it->second.value.timestamp <= value.timestamp) {
+        it->second.value = value;
+        it->second.has_value = true;
+    }
+}
+
+void LastValueTable::set_searched(aku_ParamId param, LastValue const* value) {
+    Shard& shard = get_shard(param);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    // Values added by the writer after the search started are already in the entry
+    Entry& entry = shard.values[param];
+    if (value && (!entry.has_value || entry.value.timestamp <= value->timestamp)) {
+        entry.value = *value;
+        entry.has_value = true;
+    }
+    entry.complete = true;
+}
+
+LastValueTable::State LastValueTable::get(aku_ParamId param, LastValue* value) const {
+    Shard const& shard = get_shard(param);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto it = shard.values.find(param);
+    if (it == shard.values.end()) {
+        return MISSING;
+    }
+    if (!it->second.has_value) {
+        return it->second.complete ? EMPTY : MISSING;
+    }
+    *value = it->second.value;
+    return it->second.complete ? COMPLETE : INCOMPLETE;
+}
+
+size_t LastValueTable::size() const {
+    size_t result = 0u;
+    for (auto const& shard: shards_) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        result += shard.values.size();
+    }
+    return result;
+}
+
+}  // namespace
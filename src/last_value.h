@@ -0,0 +1,102 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Table of the last values of the series.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "page.h"
+
+namespace Akumuli {
+
+/** Location of the last value of the series.
+  * Value is stored in the page `page_id`, location is valid only
+  * while page's open_count is the same.
+  */
+struct LastValue {
+    aku_TimeStamp   timestamp;
+    aku_EntryOffset offset;         //< value data offset
+    uint32_t        length;         //< value length
+    uint32_t        page_id;        //< page index in storage
+    uint32_t        open_count;     //< page generation
+};
+
+
+/** Last value of every series.
+  * Table is updated by the writer on every added value and can be read
+  * concurrently. Table is split into several independent shards to reduce
+  * lock contention.
+  * Table is filled lazily: value added by the writer to the series that
+  * wasn't searched yet is not necessarily the last one (storage can contain
+  * newer values written before the table was created), such entries are
+  * incomplete until the reader searches storage and calls `set_searched`.
+  */
+class LastValueTable {
+public:
+    static const int NUM_SHARDS = 16;
+
+    //! State of the table entry
+    enum State {
+        MISSING,        //< series is not in the table
+        INCOMPLETE,     //< storage can contain newer value than the one in the table
+        EMPTY,          //< storage doesn't contain values of the series
+        COMPLETE,       //< value in the table is the last one
+    };
+
+    LastValueTable();
+
+    //! Replace last value of the series if new value is not older
+    void update(aku_ParamId param, LastValue const& value);
+
+    /** Add result of the storage search, entry becomes complete.
+      * @param param series id
+      * @param value newest value of the series found in storage (null if there is no values)
+      */
+    void set_searched(aku_ParamId param, LastValue const* value);
+
+    //! Find last value of the series, value is set if the result is COMPLETE or INCOMPLETE
+    State get(aku_ParamId param, LastValue* value) const;
+
+    //! Return number of series in table
+    size_t size() const;
+
+private:
+    struct Entry {
+        LastValue   value;
+        bool        has_value;
+        bool        complete;
+    };
+
+    struct Shard {
+        mutable std::mutex                      mutex;
+        std::unordered_map<aku_ParamId, Entry>  values;
+    };
+
+    Shard& get_shard(aku_ParamId param);
+
+    Shard const& get_shard(aku_ParamId param) const;
+
+    std::vector<Shard> shards_;
+};
+
+}  // namespace
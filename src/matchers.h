@@ -0,0 +1,226 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Parameter matchers used by search algorithms.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "page.h"
+
+namespace Akumuli {
+
+/* Every matcher is a small copyable object with `operator ()` that
+ * returns true if param id matches. Matchers are passed to search
+ * algorithms as template parameters so calls can be inlined.
+ * Method `match` returns the same result as query.param_pred, including
+ * LT_ALL and GT_ALL hints.
+ */
+
+//! Matches one parameter
+struct SingleParamMatcher {
+    aku_ParamId id;
+
+    SingleParamMatcher(SearchQuery const& query)
+        : id(query.param_id)
+    {
+    }
+
+    bool operator () (aku_ParamId param) const {
+        return param == id;
+    }
+
+    SearchQuery::ParamMatch match(aku_ParamId param) const {
+        return param == id ? SearchQuery::MATCH
+             : param < id  ? SearchQuery::LT_ALL
+                           : SearchQuery::GT_ALL;
+    }
+};
+
+
+//! Matches small set of parameters, all values are compared at once
+struct SmallSetMatcher {
+    enum {
+        MAX_SIZE = 8
+    };
+    typedef aku_ParamId ParamIdVec __attribute__((vector_size(4*sizeof(aku_ParamId))));
+
+    // Ids are stored unaligned and loaded with memcpy, so matcher (and cursors
+    // that contain it) doesn't need extended alignment on the heap.
+    aku_ParamId ids[MAX_SIZE];
+    aku_ParamId min_id;
+    aku_ParamId max_id;
+
+    SmallSetMatcher(SearchQuery const& query)
+        : min_id(query.params.front())
+        , max_id(query.params.back())
+    {
+        // Unused slots are filled with copies of the first value
+        auto const& params = query.params;
+        for (int i = 0; i < MAX_SIZE; i++) {
+            ids[i] = i < (int)params.size() ? params[i] : params.front();
+        }
+    }
+
+    bool operator () (aku_ParamId param) const {
+        ParamIdVec lo, hi;
+        memcpy(&lo, ids, sizeof(lo));
+        memcpy(&hi, ids + 4, sizeof(hi));
+        ParamIdVec key = { param, param, param, param };
+        auto eq = (lo == key) | (hi == key);
+        return (eq[0] | eq[1] | eq[2] | eq[3]) != 0;
+    }
+
+    SearchQuery::ParamMatch match(aku_ParamId param) const {
+        return param < min_id ? SearchQuery::LT_ALL
+             : param > max_id ? SearchQuery::GT_ALL
+             : (*this)(param) ? SearchQuery::MATCH
+                              : SearchQuery::NO_MATCH;
+    }
+};
+
+
+//! Matches large and sparse set of parameters
+struct SortedSetMatcher {
+    aku_ParamId const* begin;
+    aku_ParamId const* end;
+
+    SortedSetMatcher(SearchQuery const& query)
+        : begin(query.params.data())
+        , end(query.params.data() + query.params.size())
+    {
+    }
+
+    bool operator () (aku_ParamId param) const {
+        return std::binary_search(begin, end, param);
+    }
+
+    SearchQuery::ParamMatch match(aku_ParamId param) const {
+        if (begin == end || param > end[-1]) {
+            return SearchQuery::GT_ALL;
+        }
+        if (param < begin[0]) {
+            return SearchQuery::LT_ALL;
+        }
+        return (*this)(param) ? SearchQuery::MATCH : SearchQuery::NO_MATCH;
+    }
+};
+
+
+//! Matches dense set of parameters
+struct BitmapMatcher {
+    aku_ParamId     min_id;
+    aku_ParamId     span;       //< max_id - min_id
+    uint64_t const* bits;
+
+    BitmapMatcher(SearchQuery const& query)
+        : min_id(query.min_id)
+        , span(query.max_id - query.min_id)
+        , bits(query.bitmap.data())
+    {
+    }
+
+    bool operator () (aku_ParamId param) const {
+        aku_ParamId ix = param - min_id;  // wraps around if param < min_id
+        return ix <= span && ((bits[ix >> 6] >> (ix & 63)) & 1u);
+    }
+
+    SearchQuery::ParamMatch match(aku_ParamId param) const {
+        return param < min_id        ? SearchQuery::LT_ALL
+             : param - min_id > span ? SearchQuery::GT_ALL
+             : (*this)(param)        ? SearchQuery::MATCH
+                                     : SearchQuery::NO_MATCH;
+    }
+};
+
+
+//! Matches range of parameters
+struct RangeMatcher {
+    aku_ParamId min_id;
+    aku_ParamId span;       //< max_id - min_id
+
+    RangeMatcher(SearchQuery const& query)
+        : min_id(query.min_id)
+        , span(query.max_id - query.min_id)
+    {
+    }
+
+    bool operator () (aku_ParamId param) const {
+        return param - min_id <= span;
+    }
+
+    SearchQuery::ParamMatch match(aku_ParamId param) const {
+        return param < min_id        ? SearchQuery::LT_ALL
+             : param - min_id > span ? SearchQuery::GT_ALL
+                                     : SearchQuery::MATCH;
+    }
+};
+
+
+//! Calls query predicate (slow path)
+struct FnMatcher {
+    SearchQuery::MatcherFn const& fn;
+
+    FnMatcher(SearchQuery const& query)
+        : fn(query.param_pred)
+    {
+    }
+
+    bool operator () (aku_ParamId param) const {
+        return fn(param) == SearchQuery::MATCH;
+    }
+
+    SearchQuery::ParamMatch match(aku_ParamId param) const {
+        return fn(param);
+    }
+};
+
+
+/** Call `visitor` with matcher that corresponds to query.
+  * Visitor should have templated `operator ()` that accepts any matcher.
+  * Matcher references query data so query should outlive it.
+  */
+template<class Visitor>
+void dispatch_matcher(SearchQuery const& query, Visitor& visitor) {
+    switch (query.kind) {
+    case SearchQuery::MATCH_SINGLE:
+        visitor(SingleParamMatcher(query));
+        break;
+    case SearchQuery::MATCH_SET:
+        if (!query.params.empty() && query.params.size() <= SmallSetMatcher::MAX_SIZE) {
+            visitor(SmallSetMatcher(query));
+        } else {
+            visitor(SortedSetMatcher(query));
+        }
+        break;
+    case SearchQuery::MATCH_BITMAP:
+        visitor(BitmapMatcher(query));
+        break;
+    case SearchQuery::MATCH_RANGE:
+        visitor(RangeMatcher(query));
+        break;
+    default:
+        visitor(FnMatcher(query));
+        break;
+    };
+}
+
+}  // namespace
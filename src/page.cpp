@@ -16,22 +16,35 @@
  */
 
 #include <cstring>
+#include <cstddef>
 #include <cassert>
 #include <algorithm>
-#include <mutex>
 #include <apr_time.h>
 #include "timsort.hpp"
 #include "page.h"
+#include "chunk_cache.h"
+#include "cursor.h"
+#include "search_stats.h"
+#include "selection.h"
+#include "matchers.h"
 #include "compression.h"
 #include "akumuli_def.h"
 
 #include <random>
 #include <iostream>
+#include <thread>
+#include <chrono>
 #include <boost/crc.hpp>
 
 
 namespace Akumuli {
 
+// Page header is stored on disk, index type uses padding of the histogram
+// so pages written before learned index was added can be opened.
+static_assert(offsetof(PageHistogram, entries) == 2*sizeof(uint32_t), "histogram layout changed");
+static_assert(offsetof(LearnedIndex, kind) == offsetof(PageHistogram, kind), "index kind must be shared");
+static_assert(offsetof(PageHeader, histogram) == 72, "page header layout changed");
+
 // Time stamps (sorted) -> Delta -> RLE -> Base128
 typedef Base128StreamWriter<aku_TimeStamp> __Base128TSWriter;
 typedef RLEStreamWriter<__Base128TSWriter, aku_TimeStamp> __RLETSWriter;
@@ -83,14 +96,34 @@ struct ChunkDesc {
     aku_EntryOffset begin_offset;     //< Data begin offset
     aku_EntryOffset end_offset;       //< Data end offset
     uint32_t checksum;                //< Checksum
+    // Fields below are missing in chunks written by older versions,
+    // entry length should be checked before use (see has_id_bounds).
+    aku_ParamId min_id;               //< Smallest param id of the chunk
+    aku_ParamId max_id;               //< Largest param id of the chunk
+    aku_EntryOffset paramids_offset;  //< Param id stream offset
 } __attribute__((packed));
 
+//! Check that chunk descriptor contains param id bounds
+static bool has_id_bounds(aku_Entry const* entry) {
+    return entry->length >= sizeof(ChunkDesc);
+}
+
 
 static SearchQuery::ParamMatch single_param_matcher(aku_ParamId a, aku_ParamId b) {
     if (a == b) {
         return SearchQuery::MATCH;
     }
-    return SearchQuery::NO_MATCH;
+    return b < a ? SearchQuery::LT_ALL : SearchQuery::GT_ALL;
+}
+
+static SearchQuery::ParamMatch range_matcher(aku_ParamId min, aku_ParamId max, aku_ParamId id) {
+    if (id < min) {
+        return SearchQuery::LT_ALL;
+    }
+    if (id > max) {
+        return SearchQuery::GT_ALL;
+    }
+    return SearchQuery::MATCH;
 }
 
 SearchQuery::SearchQuery( aku_ParamId   param_id
@@ -101,6 +134,10 @@ SearchQuery::SearchQuery( aku_ParamId   param_id
     , upperbound(upp)
     , param_pred(std::bind(&single_param_matcher, param_id, std::placeholders::_1))
     , direction(scan_dir)
+    , kind(MATCH_SINGLE)
+    , param_id(param_id)
+    , min_id(param_id)
+    , max_id(param_id)
 {
 }
 
@@ -112,7 +149,105 @@ SearchQuery::SearchQuery(MatcherFn matcher
     , upperbound(upp)
     , param_pred(matcher)
     , direction(scan_dir)
+    , kind(MATCH_FN)
+    , param_id(0u)
+    , min_id(0u)
+    , max_id(0u)
+{
+}
+
+SearchQuery::SearchQuery( std::vector<aku_ParamId> ids
+                        , aku_TimeStamp            low
+                        , aku_TimeStamp            upp
+                        , int                      scan_dir)
+    : lowerbound(low)
+    , upperbound(upp)
+    , direction(scan_dir)
+    , kind(MATCH_SET)
+    , param_id(0u)
+    , min_id(0u)
+    , max_id(0u)
+{
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    if (ids.size() == 1) {
+        kind = MATCH_SINGLE;
+        param_id = min_id = max_id = ids.front();
+        param_pred = std::bind(&single_param_matcher, param_id, std::placeholders::_1);
+        return;
+    }
+    if (!ids.empty()) {
+        min_id = ids.front();
+        max_id = ids.back();
+    }
+    const aku_ParamId span = max_id - min_id;
+    if (!ids.empty() && span == ids.size() - 1) {
+        // all ids in range are present
+        kind = MATCH_RANGE;
+        auto min = min_id, max = max_id;
+        param_pred = std::bind(&range_matcher, min, max, std::placeholders::_1);
+    } else if (ids.size() > SmallSetMatcher::MAX_SIZE && span/64 < ids.size()) {
+        // bitmap is not larger than the list of ids
+        kind = MATCH_BITMAP;
+        bitmap.resize(span/64 + 1, 0u);
+        for (auto id: ids) {
+            auto ix = id - min_id;
+            bitmap[ix >> 6] |= 1ul << (ix & 63);
+        }
+        auto min = min_id;
+        auto bits = bitmap;
+        param_pred = [min, span, bits](aku_ParamId id) {
+            if (id < min) {
+                return LT_ALL;
+            }
+            aku_ParamId ix = id - min;
+            if (ix > span) {
+                return GT_ALL;
+            }
+            return ((bits[ix >> 6] >> (ix & 63)) & 1u) ? MATCH : NO_MATCH;
+        };
+    } else {
+        kind = MATCH_SET;
+        params = ids;
+        param_pred = [ids](aku_ParamId id) {
+            if (ids.empty() || id > ids.back()) {
+                return GT_ALL;
+            }
+            if (id < ids.front()) {
+                return LT_ALL;
+            }
+            return std::binary_search(ids.begin(), ids.end(), id) ? MATCH : NO_MATCH;
+        };
+    }
+}
+
+SearchQuery::SearchQuery( aku_ParamId   min_id
+                        , aku_ParamId   max_id
+                        , aku_TimeStamp low
+                        , aku_TimeStamp upp
+                        , int           scan_dir)
+    : lowerbound(low)
+    , upperbound(upp)
+    , direction(scan_dir)
+    , kind(MATCH_RANGE)
+    , param_id(0u)
+    , min_id(min_id)
+    , max_id(max_id)
 {
+    if (min_id > max_id) {
+        // empty set of parameters doesn't match anything
+        kind = MATCH_SET;
+        this->min_id = this->max_id = 0u;
+        param_pred = [](aku_ParamId) { return GT_ALL; };
+        return;
+    }
+    if (min_id == max_id) {
+        kind = MATCH_SINGLE;
+        param_id = min_id;
+        param_pred = std::bind(&single_param_matcher, param_id, std::placeholders::_1);
+        return;
+    }
+    param_pred = std::bind(&range_matcher, min_id, max_id, std::placeholders::_1);
 }
 
 // Page
@@ -120,13 +255,63 @@ SearchQuery::SearchQuery(MatcherFn matcher
 
 PageBoundingBox::PageBoundingBox()
     : max_id(0)
-    , min_id(std::numeric_limits<uint32_t>::max())
+    , min_id(std::numeric_limits<aku_ParamId>::max())
 {
     max_timestamp = AKU_MIN_TIMESTAMP;
     min_timestamp = AKU_MAX_TIMESTAMP;
 }
 
 
+void LearnedIndex::reset() {
+    size = 0;
+    last_key = 0;
+    slope_lo = 0.0;
+    slope_hi = 0.0;
+}
+
+void LearnedIndex::add(aku_TimeStamp timestamp, uint32_t index) {
+    const double ERR = AKU_LEARNED_INDEX_ERROR;
+    if (size != 0) {
+        if (timestamp <= last_key) {
+            // Only first occurrence of the timestamp is indexed
+            return;
+        }
+        last_key = timestamp;
+        auto& seg = segments[size - 1];
+        double dx = static_cast<double>(timestamp - seg.key);
+        double dy = static_cast<double>(index - seg.index);
+        double lo = (dy - ERR) / dx;
+        double hi = (dy + ERR) / dx;
+        if (slope_hi < slope_lo) {
+            // second point of the segment, any slope is feasible
+            slope_lo = std::max(lo, 0.0);
+            slope_hi = hi;
+            seg.slope = (slope_lo + slope_hi) / 2.0;
+            return;
+        }
+        if (lo <= slope_hi && hi >= slope_lo) {
+            // Shrink the cone
+            slope_lo = std::max(slope_lo, lo);
+            slope_hi = std::min(slope_hi, hi);
+            seg.slope = (slope_lo + slope_hi) / 2.0;
+            return;
+        }
+        if (size == AKU_LEARNED_INDEX_SIZE) {
+            // Index is full, last segment will be searched entirely
+            return;
+        }
+    }
+    // Start new segment
+    last_key = timestamp;
+    auto& seg = segments[size++];
+    seg.key = timestamp;
+    seg.index = index;
+    seg.slope = 0.0;
+    // Empty cone (lo > hi) marks segment with one point
+    slope_lo = 1.0;
+    slope_hi = 0.0;
+}
+
 const char* PageHeader::cdata() const {
     return reinterpret_cast<const char*>(this);
 }
@@ -146,7 +331,7 @@ PageHeader::PageHeader(uint32_t count, uint64_t length, uint32_t page_id)
     , length(length)
     , bbox()
 {
-    // zero out histogram
+    // zero out histogram (index kind is AKU_PAGE_INDEX_HISTOGRAM)
     memset(&histogram, 0, sizeof(histogram));
 }
 
@@ -191,14 +376,29 @@ bool PageHeader::inside_bbox(aku_ParamId param, aku_TimeStamp time) const {
         && param >= bbox.min_id;
 }
 
-void PageHeader::reuse() {
+void PageHeader::reuse(uint32_t index_kind) {
     sync_count = 0;
     checkpoint = 0;
     count = 0;
     open_count++;
     last_offset = length - 1;
     bbox = PageBoundingBox();
-    histogram.size = 0;
+    init_index(index_kind);
+}
+
+void PageHeader::init_index(uint32_t kind) {
+    if (kind == AKU_PAGE_INDEX_LEARNED) {
+        learned.reset();
+        learned.kind = AKU_PAGE_INDEX_LEARNED;
+    } else {
+        histogram.size = 0;
+        histogram.kind = AKU_PAGE_INDEX_HISTOGRAM;
+    }
+}
+
+uint32_t PageHeader::get_index_kind() const {
+    // kind is in the common initial sequence of the union members
+    return histogram.kind;
 }
 
 void PageHeader::close() {
@@ -317,19 +517,29 @@ int PageHeader::complete_chunk(const ChunkHeader& data) {
             end = page_index[count-1];
         }
         checksum.process_block(cdata() + begin, cdata() + end);
+        auto minmax = std::minmax_element(data.paramids.begin(), data.paramids.end());
         ChunkDesc desc = {
             static_cast<uint32_t>(data.lengths.size()),
             begin,
             end,
-            checksum.checksum()
+            checksum.checksum(),
+            *minmax.first,
+            *minmax.second,
+            // param id stream is written right before the timestamps
+            static_cast<aku_EntryOffset>(begin + timestamp_stream.size())
         };
         aku_TimeStamp first_ts = data.timestamps.front();
         aku_TimeStamp last_ts = data.timestamps.back();
         head = {&desc, sizeof(desc)};
+        // Bounding box should contain param ids of the chunk, not the ids of the chunk entries
+        PageBoundingBox chunk_bbox = bbox;
         status = add_entry(AKU_CHUNK_BWD_ID, first_ts, head);
         sync_next_index(last_offset, rand(), false);
         status = add_entry(AKU_CHUNK_FWD_ID, last_ts, head);
         sync_next_index(last_offset, rand(), false);
+        bbox = chunk_bbox;
+        update_bounding_box(*minmax.first, first_ts);
+        update_bounding_box(*minmax.second, last_ts);
         // Sort histogram
         sync_next_index(0, 0, true);
         break;
@@ -410,20 +620,6 @@ static bool validate_query(SearchQuery const& query) {
     return true;
 }
 
-struct SearchStats {
-    aku_SearchStats stats;
-    std::mutex mutex;
-
-    SearchStats() {
-        memset(&stats, 0, sizeof(stats));
-    }
-};
-
-static SearchStats& get_global_search_stats() {
-    static SearchStats stats;
-    return stats;
-}
-
 struct SearchRange {
     uint32_t begin;
     uint32_t end;
@@ -436,18 +632,57 @@ struct SearchRange {
     }
 };
 
+//! Partitions of the parallel page scan
+struct ScanPartitions {
+    std::vector<std::unique_ptr<QueueCursor>>   queues;     //< results of every partition
+    std::vector<ExternalCursor*>                pqueues;
+    std::vector<std::thread>                    threads;
+    std::unique_ptr<ConcatCursor>               concat;     //< reads partitions in scan order
+
+    ~ScanPartitions() {
+        stop();
+    }
+
+    //! Close partitions and wait until all threads are finished
+    void stop() {
+        if (concat) {
+            concat->close();
+        }
+        for (auto& thread: threads) {
+            thread.join();
+        }
+        threads.clear();
+    }
+};
+
+/** Page search algorithm.
+  * Specialized for scan direction and param id matcher
+  * so inner loops doesn't depend on query properties.
+  */
+template<bool Backward, class Matcher>
 struct SearchAlgorithm {
     PageHeader const* page_;
     Caller& caller_;
     InternalCursor* cursor_;
-    SearchQuery query_;
+    SearchQuery const& query_;
+    Matcher const& matcher_;
+    ChunkCache* cache_;
+
+    static const bool IS_BACKWARD_ = Backward;
 
     const uint32_t MAX_INDEX_;
-    const bool IS_BACKWARD_;
     const aku_TimeStamp key_;
 
     SearchRange range_;
 
+    SelectionVector selection_;  //< selected rows of the current chunk
+
+    uint32_t scan_pos_;          //< index of the next entry to scan
+    bool scan_done_;             //< scan is finished (no need to resume it at scan_pos_)
+
+    //! Series search output, if set param ids of matching values are collected instead of values
+    std::unordered_set<aku_ParamId>* series_;
+
     //! Interpolation search state
     enum I10nState {
         NONE,
@@ -455,14 +690,23 @@ struct SearchAlgorithm {
         OVERSHOOT
     };
 
-    SearchAlgorithm(PageHeader const* page, Caller& caller, InternalCursor* cursor, SearchQuery query)
+    SearchAlgorithm( PageHeader const* page
+                   , Caller& caller
+                   , InternalCursor* cursor
+                   , SearchQuery const& query
+                   , Matcher const& matcher
+                   , ChunkCache* cache)
         : page_(page)
         , caller_(caller)
         , cursor_(cursor)
         , query_(query)
+        , matcher_(matcher)
+        , cache_(cache)
         , MAX_INDEX_(page->sync_count)
-        , IS_BACKWARD_(query.direction == AKU_CURSOR_DIR_BACKWARD)
         , key_(IS_BACKWARD_ ? query.upperbound : query.lowerbound)
+        , scan_pos_(0u)
+        , scan_done_(false)
+        , series_(nullptr)
     {
         if (MAX_INDEX_) {
             range_.begin = 0u;
@@ -511,6 +755,7 @@ struct SearchAlgorithm {
     }
 
     void histogram() {
+        LatencyTimer timer(&aku_SearchStats::Latency::histogram);
         auto const& h = page_->histogram;
         auto pred = [](PageHistogramEntry const& a, PageHistogramEntry const& b) {
             return a.timestamp < b.timestamp;
@@ -531,10 +776,88 @@ struct SearchAlgorithm {
         }
     }
 
+    //! Find index of the first entry with timestamp >= key using learned index
+    uint32_t learned_lower_bound(aku_TimeStamp key) {
+        auto const& index = page_->learned;
+        auto begin = index.segments;
+        auto end = index.segments + index.size;
+        auto it = std::upper_bound(begin, end, key, [](aku_TimeStamp k, LearnedIndexSegment const& seg) {
+            return k < seg.key;
+        });
+        if (it == begin) {
+            return 0u;
+        }
+        auto const& seg = *(it - 1);
+        // Result is always inside the segment
+        uint32_t lo = std::min(seg.index, MAX_INDEX_);
+        uint32_t hi = it == end ? MAX_INDEX_ : std::min(it->index, MAX_INDEX_);
+
+        // Predicted window
+        const uint64_t ERR = AKU_LEARNED_INDEX_ERROR + 1;
+        double fpred = seg.index + seg.slope * static_cast<double>(key - seg.key);
+        uint64_t pred = fpred < hi ? static_cast<uint64_t>(fpred) : hi;
+        uint32_t wbegin = static_cast<uint32_t>(pred > lo + ERR ? std::min<uint64_t>(pred - ERR, hi) : lo);
+        uint32_t wend = static_cast<uint32_t>(std::min<uint64_t>(pred + ERR + 1, hi));
+        if (wbegin > wend) {
+            wbegin = wend;
+        }
+
+        auto timestamp_at = [this](uint32_t ix) {
+            return page_->read_entry(page_->page_index[ix])->time;
+        };
+        uint64_t fallback = 0u;
+        uint64_t window_size = wend - wbegin;
+        if (!((wbegin == lo || timestamp_at(wbegin - 1) < key) && (wend == hi || timestamp_at(wend) >= key))) {
+            // Wrong prediction (timestamps out of order or index is full)
+            fallback = 1u;
+            wbegin = lo;
+            wend = hi;
+        }
+        while (wbegin < wend) {
+            auto probe_index = wbegin + (wend - wbegin) / 2u;
+            if (timestamp_at(probe_index) < key) {
+                wbegin = probe_index + 1u;
+            } else {
+                wend = probe_index;
+            }
+        }
+
+        auto& lst = get_thread_search_stats().lstats;
+        stats_add(lst.n_times, 1u);
+        stats_add(lst.n_window_size, window_size);
+        stats_add(lst.n_fallbacks, fallback);
+        return wbegin;
+    }
+
+    //! Find starting point using learned index (replaces histogram and interpolation search)
+    void learned_index() {
+        if (range_.begin == range_.end) {
+            return;
+        }
+        LatencyTimer timer(&aku_SearchStats::Latency::learned_index);
+        uint32_t probe_index = 0u;
+        if (IS_BACKWARD_) {
+            // last entry with timestamp <= key_
+            probe_index = key_ == static_cast<aku_TimeStamp>(AKU_MAX_TIMESTAMP)
+                        ? MAX_INDEX_
+                        : learned_lower_bound(key_ + 1u);
+            probe_index = probe_index ? probe_index - 1u : 0u;
+        } else {
+            // first entry with timestamp >= key_
+            probe_index = learned_lower_bound(key_);
+            if (probe_index == MAX_INDEX_) {
+                probe_index = MAX_INDEX_ - 1u;
+            }
+        }
+        range_.begin = probe_index;
+        range_.end = probe_index;
+    }
+
     void interpolation() {
         if (range_.begin == range_.end) {
             return;
         }
+        LatencyTimer timer(&aku_SearchStats::Latency::interpolation);
         aku_TimeStamp search_lower_bound = page_->read_entry_at(range_.begin)->time;
         aku_TimeStamp search_upper_bound = page_->read_entry_at(range_.end - 1)->time;
         uint32_t probe_index = 0u;
@@ -611,18 +934,17 @@ struct SearchAlgorithm {
                 // Continue with binary search
             }
         }
-        auto& stats = get_global_search_stats();
-        std::lock_guard<std::mutex> lock(stats.mutex);
-        stats.stats.istats.n_matches += exact_match;
-        stats.stats.istats.n_overshoots += overshoot;
-        stats.stats.istats.n_undershoots += undershoot;
-        stats.stats.istats.n_times += 1;
-        stats.stats.istats.n_steps += steps_count;
-        stats.stats.istats.n_reduced_to_one_page += small_range_finish;
-        stats.stats.istats.n_page_in_core_checks += page_scan_steps_num;
-        stats.stats.istats.n_page_in_core_errors += page_scan_errors;
-        stats.stats.istats.n_pages_in_core_found += page_scan_success;
-        stats.stats.istats.n_pages_in_core_miss += page_miss;
+        auto& ist = get_thread_search_stats().istats;
+        stats_add(ist.n_matches, exact_match);
+        stats_add(ist.n_overshoots, overshoot);
+        stats_add(ist.n_undershoots, undershoot);
+        stats_add(ist.n_times, 1u);
+        stats_add(ist.n_steps, steps_count);
+        stats_add(ist.n_reduced_to_one_page, small_range_finish);
+        stats_add(ist.n_page_in_core_checks, page_scan_steps_num);
+        stats_add(ist.n_page_in_core_errors, page_scan_errors);
+        stats_add(ist.n_pages_in_core_found, page_scan_success);
+        stats_add(ist.n_pages_in_core_miss, page_miss);
     }
 
     void binary_search() {
@@ -630,6 +952,7 @@ struct SearchAlgorithm {
         if (range_.begin == range_.end) {
             return;
         }
+        LatencyTimer timer(&aku_SearchStats::Latency::binary_search);
         uint32_t probe_index = 0u;
         while (range_.end >= range_.begin) {
             steps++;
@@ -660,129 +983,203 @@ struct SearchAlgorithm {
         range_.begin = probe_index;
         range_.end = probe_index;
 
-        auto& stats = get_global_search_stats();
-        std::lock_guard<std::mutex> guard(stats.mutex);
-        auto& bst = stats.stats.bstats;
-        bst.n_times += 1;
-        bst.n_steps += steps;
+        auto& bst = get_thread_search_stats().bstats;
+        stats_add(bst.n_times, 1u);
+        stats_add(bst.n_steps, steps);
     }
 
-    bool scan_compressed_entries(aku_Entry const* probe_entry, bool binary_search=false)
-    {
-        ChunkHeader header;
-
-        auto pdesc = reinterpret_cast<ChunkDesc const*>(&probe_entry->value[0]);
+    //! Decode chunk (checksum is verified). Returns empty pointer if chunk is damaged.
+    std::shared_ptr<ChunkHeader> decode_chunk(ChunkDesc const* pdesc) {
+        LatencyTimer timer(&aku_SearchStats::Latency::chunk_decode);
+        std::shared_ptr<ChunkHeader> header(new ChunkHeader());
         auto pbegin = (const unsigned char*)(page_->cdata() + pdesc->begin_offset);
         auto pend = (const unsigned char*)(page_->cdata() + pdesc->end_offset);
         auto probe_length = pdesc->n_elements;
 
-        // TODO:checksum!
         boost::crc_32_type checksum;
         checksum.process_block(pbegin, pend);
         if (checksum.checksum() != pdesc->checksum) {
-            AKU_PANIC("File damaged!");
-            // TODO: report error
-            return false;
+            return std::shared_ptr<ChunkHeader>();
         }
 
+        header->timestamps.reserve(probe_length);
+        header->paramids.reserve(probe_length);
+        header->lengths.reserve(probe_length);
+        header->offsets.reserve(probe_length);
+
         // read timestamps
         DeltaRLETSReader tst_reader(pbegin, pend);
         for (auto i = 0u; i < probe_length; i++) {
-            header.timestamps.push_back(tst_reader.next());
+            header->timestamps.push_back(tst_reader.next());
         }
         pbegin = tst_reader.pos();
 
-        size_t start_pos = 0;
-        if (IS_BACKWARD_) {
-            start_pos = static_cast<int>(probe_length - 1);
-        }
-        // test timestamp range
-        if (binary_search) {
-            auto it = std::lower_bound(header.timestamps.begin(), header.timestamps.end(), key_);
-            if (IS_BACKWARD_) {
-                if (!header.timestamps.empty()) {
-                    auto last = header.timestamps.begin() + start_pos;
-                    auto delta = last - it;
-                    start_pos -= delta;
-                }
-            } else {
-                start_pos += it - header.timestamps.begin();
-            }
-        }
-
         // read paramids
         Base128IdReader pid_reader(pbegin, pend);
         for (auto i = 0u; i < probe_length; i++) {
-            header.paramids.push_back(pid_reader.next());
+            header->paramids.push_back(pid_reader.next());
         }
         pbegin = pid_reader.pos();
 
         // read lengths
         RLELenReader len_reader(pbegin, pend);
         for (auto i = 0u; i < probe_length; i++) {
-            header.lengths.push_back(len_reader.next());
+            header->lengths.push_back(len_reader.next());
         }
         pbegin = len_reader.pos();
 
         // read offsets
         DeltaRLEOffReader off_reader(pbegin, pend);
         for (auto i = 0u; i < probe_length; i++) {
-            header.offsets.push_back(off_reader.next());
+            header->offsets.push_back(off_reader.next());
         }
+        return header;
+    }
 
-        bool probe_in_time_range = true;
+    //! Get decoded chunk from cache or decode it and put to cache
+    ChunkCache::PChunk read_chunk(ChunkDesc const* pdesc) {
+        if (cache_ == nullptr) {
+            return decode_chunk(pdesc);
+        }
+        ChunkKey key = { page_->page_id, page_->open_count, pdesc->begin_offset };
+        auto result = cache_->get(key);
+        auto& cst = get_thread_search_stats().cache;
+        if (result) {
+            stats_add(cst.n_hits, 1u);
+            return result;
+        }
+        stats_add(cst.n_misses, 1u);
+        result = decode_chunk(pdesc);
+        if (result) {
+            cache_->put(key, result);
+        }
+        return result;
+    }
 
-        auto cursor = cursor_;
-        auto& caller = caller_;
-        auto page = page_;
-        auto put_entry = [&header, cursor, &caller, page] (uint32_t i) {
-            CursorResult result = {
+    //! Send selected rows of the chunk to cursor in batches
+    bool emit_selection(ChunkHeader const& header) {
+        const size_t BATCH_SIZE = 0x100;
+        CursorResult batch[BATCH_SIZE];
+        size_t batch_size = 0;
+        const size_t nselected = selection_.size();
+        for (size_t k = 0; k < nselected; k++) {
+            auto i = selection_[IS_BACKWARD_ ? nselected - 1 - k : k];
+            batch[batch_size++] = {
                 header.offsets[i],
                 header.lengths[i],
                 header.timestamps[i],
                 header.paramids[i],
-                page
+                page_
             };
-            cursor->put(caller, result);
-        };
-
-        if (IS_BACKWARD_) {
-            for (int i = static_cast<int>(start_pos); i >= 0; i--) {
-                probe_in_time_range = query_.lowerbound <= header.timestamps[i] &&
-                                      query_.upperbound >= header.timestamps[i];
-                if (probe_in_time_range && query_.param_pred(header.paramids[i])) {
-                    put_entry(i);
-                } else {
-                    probe_in_time_range = query_.lowerbound <= header.timestamps[i];
-                    if (!probe_in_time_range) {
-                        break;
-                    }
+            if (batch_size == BATCH_SIZE) {
+                if (!cursor_->put_batch(caller_, batch, batch_size)) {
+                    return false;
                 }
+                batch_size = 0;
             }
-        } else {
-            for (auto i = start_pos; i != probe_length; i++) {
-                probe_in_time_range = query_.lowerbound <= header.timestamps[i] &&
-                                      query_.upperbound >= header.timestamps[i];
-                if (probe_in_time_range && query_.param_pred(header.paramids[i])) {
-                    put_entry(i);
-                } else {
-                    probe_in_time_range = query_.upperbound >= header.timestamps[i];
-                    if (!probe_in_time_range) {
-                        break;
-                    }
-                }
+        }
+        if (batch_size) {
+            return cursor_->put_batch(caller_, batch, batch_size);
+        }
+        return true;
+    }
+
+    //! Check param id bounds of the chunk, returns false if chunk can't contain param ids of interest
+    bool chunk_may_match(aku_Entry const* probe_entry) const {
+        if (query_.kind == SearchQuery::MATCH_FN || !has_id_bounds(probe_entry)) {
+            return true;
+        }
+        auto pdesc = reinterpret_cast<ChunkDesc const*>(&probe_entry->value[0]);
+        return query_.min_id <= pdesc->max_id && pdesc->min_id <= query_.max_id;
+    }
+
+    /** Collect series of the chunk decoding only the param id stream.
+      * Works only for forward scan and for chunks that lies inside the time range
+      * of the query. Returns false if chunk should be decoded entirely.
+      */
+    bool collect_chunk_series(aku_Entry const* probe_entry) {
+        if (IS_BACKWARD_ || !has_id_bounds(probe_entry) || probe_entry->time > query_.upperbound) {
+            return false;
+        }
+        auto pdesc = reinterpret_cast<ChunkDesc const*>(&probe_entry->value[0]);
+        auto pbegin = (const unsigned char*)(page_->cdata() + pdesc->begin_offset);
+        auto pend = (const unsigned char*)(page_->cdata() + pdesc->end_offset);
+        DeltaRLETSReader tst_reader(pbegin, pend);
+        if (tst_reader.next() < query_.lowerbound) {
+            return false;
+        }
+        boost::crc_32_type checksum;
+        checksum.process_block(pbegin, pend);
+        if (checksum.checksum() != pdesc->checksum) {
+            AKU_PANIC("File damaged!");
+        }
+        Base128IdReader pid_reader((const unsigned char*)(page_->cdata() + pdesc->paramids_offset), pend);
+        for (auto i = 0u; i < pdesc->n_elements; i++) {
+            auto id = pid_reader.next();
+            if (matcher_(id)) {
+                series_->insert(id);
+            }
+        }
+        return true;
+    }
+
+    bool scan_compressed_entries(aku_Entry const* probe_entry)
+    {
+        if (!chunk_may_match(probe_entry)) {
+            return IS_BACKWARD_ ? query_.lowerbound <= probe_entry->time
+                                : query_.upperbound >= probe_entry->time;
+        }
+        if (series_ && collect_chunk_series(probe_entry)) {
+            return true;
+        }
+        auto pdesc = reinterpret_cast<ChunkDesc const*>(&probe_entry->value[0]);
+        auto probe_length = pdesc->n_elements;
+
+        auto pheader = read_chunk(pdesc);
+        if (!pheader) {
+            AKU_PANIC("File damaged!");
+            // TODO: report error
+            return false;
+        }
+        ChunkHeader const& header = *pheader;
+
+        // Rows inside the time range
+        uint32_t first, last;
+        std::tie(first, last) = select_time_range(header.timestamps.data(), probe_length,
+                                                  query_.lowerbound, query_.upperbound);
+
+        // Rows with matching param ids
+        select_params(header.timestamps.data(), header.paramids.data(), first, last, matcher_, &selection_);
+
+        if (series_) {
+            for (auto i: selection_) {
+                series_->insert(header.paramids[i]);
             }
+        } else if (!emit_selection(header)) {
+            return false;
         }
-        return probe_in_time_range;
+
+        // Scan should proceed only if chunk doesn't contain values outside the time range
+        return IS_BACKWARD_ ? first == 0u : last == probe_length;
     }
 
     std::tuple<uint64_t, uint64_t> scan_impl(uint32_t probe_index) {
+        return scan_impl(probe_index, MAX_INDEX_);
+    }
+
+    /** Scan page index starting from probe_index.
+      * Scan stops at stop_index (not included) or when all values
+      * of interest are found. In the first case scan can be resumed
+      * from scan_pos_, in the second case scan_done_ is set.
+      */
+    std::tuple<uint64_t, uint64_t> scan_impl(uint32_t probe_index, uint32_t stop_index) {
 #ifdef DEBUG
         // Debug variables
         aku_TimeStamp dbg_prev_ts;
         long dbg_count = 0;
 #endif
         int index_increment = IS_BACKWARD_ ? -1 : 1;
+        scan_done_ = false;
         while (true) {
             auto current_index = probe_index;
             probe_index += index_increment;
@@ -793,7 +1190,7 @@ struct SearchAlgorithm {
             bool probe_in_time_range = query_.lowerbound <= probe_entry->time &&
                                        query_.upperbound >= probe_entry->time;
             if (probe < AKU_ID_COMPRESSED) {
-                if (query_.param_pred(probe) == SearchQuery::MATCH && probe_in_time_range) {
+                if (matcher_(probe) && probe_in_time_range) {
 #ifdef DEBUG
                     if (dbg_count) {
                         // check for backward direction
@@ -804,24 +1201,29 @@ struct SearchAlgorithm {
                     dbg_prev_ts = probe_entry->time;
                     dbg_count++;
 #endif
-                    CursorResult result = {
-                        static_cast<aku_EntryOffset>(probe_offset + sizeof(aku_Entry)),
-                        probe_entry->length,
-                        probe_entry->time,
-                        probe,//id
-                        page_
-                    };
-                    if (!cursor_->put(caller_, result)) {
-                        break;
+                    if (series_) {
+                        series_->insert(probe);
+                    } else {
+                        CursorResult result = {
+                            static_cast<aku_EntryOffset>(probe_offset + sizeof(aku_Entry)),
+                            probe_entry->length,
+                            probe_entry->time,
+                            probe,//id
+                            page_
+                        };
+                        if (!cursor_->put(caller_, result)) {
+                            scan_done_ = true;
+                            break;
+                        }
                     }
                 }
                 proceed = IS_BACKWARD_ ? query_.lowerbound <= probe_entry->time
                                        : query_.upperbound >= probe_entry->time;
             } else {
                 if (probe == AKU_CHUNK_FWD_ID && IS_BACKWARD_ == false) {
-                    proceed = scan_compressed_entries(probe_entry, true);
+                    proceed = scan_compressed_entries(probe_entry);
                 } else if (probe == AKU_CHUNK_BWD_ID && IS_BACKWARD_ == true) {
-                    proceed = scan_compressed_entries(probe_entry, true);
+                    proceed = scan_compressed_entries(probe_entry);
                 } else {
                     proceed = IS_BACKWARD_ ? query_.lowerbound <= probe_entry->time
                                            : query_.upperbound >= probe_entry->time;
@@ -831,43 +1233,544 @@ struct SearchAlgorithm {
                 // When scanning forward probe_index will be equal to MAX_INDEX_ at the end of the page
                 // When scanning backward probe_index will be equal to ~0 (probe_index > MAX_INDEX_)
                 // at the end of the page
+                scan_done_ = true;
+                break;
+            }
+            if (probe_index == stop_index) {
                 break;
             }
         }
+        scan_pos_ = probe_index;
         return std::make_tuple(0ul, 0ul);
     }
 
-    void scan() {
-        if (range_.begin != range_.end) {
-            cursor_->set_error(caller_, AKU_EGENERAL);
+    /** Find the end of the scan.
+      * Scan that starts from `start` doesn't stop before the returned index.
+      * Forward: first index after start with timestamp greater than upperbound.
+      * Backward: last index before start with timestamp less than lowerbound
+      * plus one, scan stops after this index.
+      */
+    uint32_t find_scan_end(uint32_t start) const {
+        auto begin = page_->page_index;
+        auto end = page_->page_index + MAX_INDEX_;
+        if (IS_BACKWARD_) {
+            auto lowerbound = query_.lowerbound;
+            auto it = std::partition_point(begin, begin + start, [this, lowerbound](aku_EntryOffset offset) {
+                return page_->read_entry(offset)->time < lowerbound;
+            });
+            return static_cast<uint32_t>(it - begin);
+        }
+        auto upperbound = query_.upperbound;
+        auto it = std::partition_point(begin + start, end, [this, upperbound](aku_EntryOffset offset) {
+            return page_->read_entry(offset)->time <= upperbound;
+        });
+        return static_cast<uint32_t>(it - begin);
+    }
+
+    /** Start parallel scan of the page index.
+      * Index range that should be scanned is split into contiguous partitions,
+      * every partition is scanned by its own thread and results can be read from
+      * partitions one by one so they are ordered the same way as in sequential scan.
+      * Only the last partition can stop the scan early. Returns false if range is
+      * too small and sequential scan should be used.
+      */
+    bool start_partitions(uint32_t nthreads, ScanPartitions* partitions) {
+        const uint32_t start = range_.begin;
+        const uint32_t end = find_scan_end(start);
+        // Number of index entries that will be scanned for sure
+        const uint32_t size = IS_BACKWARD_ ? start + 1 - end : end - start;
+        const uint32_t npartitions = std::min(nthreads, size / AKU_MIN_SCAN_PARTITION_SIZE);
+        if (npartitions < 2) {
+            return false;
+        }
+        // Partition i starts at bounds[i] and stops at bounds[i + 1]
+        std::vector<uint32_t> bounds;
+        for (uint32_t i = 0; i < npartitions; i++) {
+            uint32_t offset = static_cast<uint32_t>(static_cast<uint64_t>(size)*i/npartitions);
+            bounds.push_back(IS_BACKWARD_ ? start - offset : start + offset);
+        }
+        bounds.push_back(MAX_INDEX_);  // last partition is not limited
+
+        // Partitions are scanned by dedicated threads and not by the worker pool
+        // because the consumer can run in the pool worker and it blocks
+        // until partitions are scanned.
+        for (uint32_t i = 0; i < npartitions; i++) {
+            partitions->queues.emplace_back(new QueueCursor());
+            partitions->pqueues.push_back(partitions->queues.back().get());
+        }
+        for (uint32_t i = 0; i < npartitions; i++) {
+            QueueCursor* queue = partitions->queues[i].get();
+            uint32_t first = bounds[i], stop = bounds[i + 1];
+            partitions->threads.emplace_back([this, queue, first, stop]() {
+                Caller caller;
+                SearchAlgorithm partition(page_, caller, queue, query_, matcher_, cache_);
+                partition.scan_impl(first, stop);
+                queue->complete(caller);
+            });
+        }
+        partitions->concat.reset(new ConcatCursor(&partitions->pqueues[0], static_cast<int>(npartitions)));
+
+        auto& pst = get_thread_search_stats().pscan;
+        stats_add(pst.n_times, 1u);
+        stats_add(pst.n_partitions, npartitions);
+        return true;
+    }
+
+    //! Scan page index using several threads, falls back to sequential scan if range is too small
+    void parallel_scan(uint32_t nthreads) {
+        ScanPartitions partitions;
+        if (check_range() != AKU_SUCCESS || !start_partitions(nthreads, &partitions)) {
+            scan();
             return;
         }
-        if (range_.begin >= MAX_INDEX_) {
-            cursor_->set_error(caller_, AKU_EOVERFLOW);
+        int error_code = AKU_SUCCESS;
+        bool error = false;
+        {
+            LatencyTimer timer(&aku_SearchStats::Latency::scan);
+            auto concat_cursor = partitions.concat.get();
+            const int BATCH_SIZE = QueueCursor::BATCH_SIZE;
+            std::vector<CursorResult> batch(BATCH_SIZE);
+            while (!concat_cursor->is_done()) {
+                int nread = concat_cursor->read(batch.data(), BATCH_SIZE);
+                if (nread && !cursor_->put_batch(caller_, batch.data(), static_cast<size_t>(nread))) {
+                    break;
+                }
+            }
+            error = concat_cursor->is_error(&error_code);
+            partitions.stop();
+        }
+        if (error) {
+            cursor_->set_error(caller_, error_code);
             return;
         }
+        cursor_->complete(caller_);
+    }
 
-        auto sums = scan_impl(range_.begin);
+    //! Check that search range is reduced to one index entry that can be scanned
+    int check_range() const {
+        if (range_.begin != range_.end) {
+            return AKU_EGENERAL;
+        }
+        if (range_.begin >= MAX_INDEX_) {
+            return AKU_EOVERFLOW;
+        }
+        return AKU_SUCCESS;
+    }
 
-        auto& stats = get_global_search_stats();
+    /** Find the first index entry that should be scanned.
+      * Returns false if search is already finished (cursor is completed or error is set).
+      */
+    bool locate() {
+        if (fast_path()) {
+            return false;
+        }
+        if (page_->get_index_kind() == AKU_PAGE_INDEX_LEARNED) {
+            learned_index();
+        } else {
+            histogram();
+            interpolation();
+        }
+        binary_search();
+        return true;
+    }
+
+    void scan() {
+        int error_code = check_range();
+        if (error_code != AKU_SUCCESS) {
+            cursor_->set_error(caller_, error_code);
+            return;
+        }
+
+        std::tuple<uint64_t, uint64_t> sums;
         {
-            std::lock_guard<std::mutex> guard(stats.mutex);
-            stats.stats.scan.fwd_bytes += std::get<0>(sums);
-            stats.stats.scan.bwd_bytes += std::get<1>(sums);
+            LatencyTimer timer(&aku_SearchStats::Latency::scan);
+            sums = scan_impl(range_.begin);
         }
+
+        auto& sst = get_thread_search_stats().scan;
+        stats_add(sst.fwd_bytes, std::get<0>(sums));
+        stats_add(sst.bwd_bytes, std::get<1>(sums));
         cursor_->complete(caller_);
     }
 };
 
-void PageHeader::search(Caller& caller, InternalCursor* cursor, SearchQuery query) const
-{
-    SearchAlgorithm search_alg(this, caller, cursor, query);
-    if (search_alg.fast_path() == false) {
-        search_alg.histogram();
-        search_alg.interpolation();
-        search_alg.binary_search();
-        search_alg.scan();
+//! Search page using specialized search algorithm
+struct PageSearch {
+    PageHeader const* page;
+    Caller& caller;
+    InternalCursor* cursor;
+    SearchQuery const& query;
+    ChunkCache* cache;
+
+    template<bool Backward, class Matcher>
+    void run(Matcher const& matcher) {
+        SearchAlgorithm<Backward, Matcher> search_alg(page, caller, cursor, query, matcher, cache);
+        if (search_alg.locate()) {
+            if (query.parallelism > 1) {
+                search_alg.parallel_scan(query.parallelism);
+            } else {
+                search_alg.scan();
+            }
+        }
+    }
+
+    template<class Matcher>
+    void operator () (Matcher const& matcher) {
+        if (query.direction == AKU_CURSOR_DIR_BACKWARD) {
+            run<true>(matcher);
+        } else {
+            run<false>(matcher);
+        }
+    }
+};
+
+/** Output of the page search cursor.
+  * Results are written directly to the user buffer or columns, results that
+  * doesn't fit are stored in the overflow buffer until the next read.
+  */
+struct PullOutput : InternalCursor {
+    CursorResult*               buffer;         //< row-oriented output (null if columns are used)
+    CursorColumns               columns;        //< column-oriented output
+    size_t                      buffer_len;
+    size_t                      count;          //< number of results written to output
+    std::vector<CursorResult>   overflow;
+    size_t                      overflow_pos;   //< first unread result in overflow
+    size_t                      nproduced;      //< total number of results produced by search (including skipped)
+    size_t                      nskip;          //< number of results that should be skipped
+    int                         error_code;
+
+    PullOutput()
+        : buffer(nullptr)
+        , columns()
+        , buffer_len(0u)
+        , count(0u)
+        , overflow_pos(0u)
+        , nproduced(0u)
+        , nskip(0u)
+        , error_code(AKU_SUCCESS)
+    {
+    }
+
+    //! Number of produced results that wasn't returned yet
+    size_t pending() const {
+        return overflow.size() - overflow_pos;
+    }
+
+    void write(CursorResult const* results, size_t n) {
+        if (buffer) {
+            std::copy(results, results + n, buffer + count);
+        } else {
+            columns.set(count, results, n);
+        }
+        count += n;
+    }
+
+    //! Set output buffer (or columns if buf is null) and move overflowed results to it
+    void reset(CursorResult* buf, CursorColumns const& cols, size_t buf_len) {
+        buffer = buf;
+        columns = cols;
+        buffer_len = buf_len;
+        count = 0u;
+        auto n = std::min(overflow.size() - overflow_pos, buf_len);
+        write(overflow.data() + overflow_pos, n);
+        overflow_pos += n;
+        if (overflow_pos == overflow.size()) {
+            overflow.clear();
+            overflow_pos = 0u;
+        }
+    }
+
+    virtual bool put(Caller&, CursorResult const& result) {
+        nproduced++;
+        if (nskip) {
+            nskip--;
+        } else if (count < buffer_len) {
+            write(&result, 1u);
+        } else {
+            overflow.push_back(result);
+        }
+        return true;
+    }
+
+    virtual bool put_batch(Caller&, CursorResult const* results, size_t size) {
+        nproduced += size;
+        auto nskipped = std::min(size, nskip);
+        nskip -= nskipped;
+        results += nskipped;
+        size -= nskipped;
+        auto n = std::min(size, buffer_len - count);
+        write(results, n);
+        overflow.insert(overflow.end(), results + n, results + size);
+        return true;
+    }
+
+    virtual void complete(Caller&) {
+    }
+
+    virtual void set_error(Caller&, int code) {
+        error_code = code;
+    }
+};
+
+/** Page search cursor.
+  * Search is performed in small steps on demand, every step scans a part of the
+  * page index and writes results to the user buffer. Cursor doesn't need its
+  * own stack and never switches context.
+  */
+template<bool Backward, class Matcher>
+class PageCursor : public ExternalCursor {
+    enum {
+        MIN_SCAN_STEP = 0x100,  //< min number of index entries scanned at once (if entries aren't compressed)
+        FIRST_SCAN_STEP = 4,    //< number of index entries scanned by the first step
+    };
+    enum State {
+        LOCATE,     //< first index entry is not found yet
+        SCAN,       //< sequential scan
+        PARALLEL,   //< parallel scan, results are read from partitions
+        DONE,
+    };
+    const SearchQuery                   query_;
+    const Matcher                       matcher_;
+    Caller                              caller_;        //< not used, search algorithm never yields
+    PullOutput                          output_;
+    SearchAlgorithm<Backward, Matcher>  search_alg_;
+    ScanPartitions                      partitions_;
+    State                               state_;
+    bool                                error_;
+    int                                 error_code_;
+    std::chrono::nanoseconds            scan_time_;     //< total duration of all scan steps
+    bool                                scan_started_;
+    uint32_t                            step_begin_;    //< first index entry of the last scan step
+    size_t                              step_nproduced_;  //< number of results produced before the last scan step
+    size_t                              nscanned_;      //< number of scanned index entries
+
+    /** Estimate number of index entries that should be scanned to produce `n` results.
+      * Compressed chunk produces many results per index entry, estimate is based on
+      * results of the previous steps. Step size grows exponentially while previous
+      * steps produce less than one result per entry (e.g. entries are out of time range).
+      */
+    uint32_t estimate_step_(size_t n) const {
+        if (nscanned_ == 0u) {
+            return FIRST_SCAN_STEP;
+        }
+        if (output_.nproduced <= nscanned_) {
+            return static_cast<uint32_t>(std::min(std::max(n, static_cast<size_t>(MIN_SCAN_STEP)), nscanned_));
+        }
+        auto per_entry = output_.nproduced / nscanned_;
+        return static_cast<uint32_t>(std::max(n / per_entry, static_cast<size_t>(1u)));
+    }
+
+    //! Add scan duration to stats when sequential scan is finished
+    void finish_scan_() {
+        stats_add_latency(get_thread_search_stats().latency.scan, static_cast<uint64_t>(scan_time_.count()));
+        state_ = DONE;
+    }
+
+    void set_error_(int error_code) {
+        error_ = true;
+        error_code_ = error_code;
+        state_ = DONE;
+        partitions_.stop();
+    }
+
+    //! Advance search, scan at most max_entries index entries
+    void step_(uint32_t max_entries) {
+        if (state_ == LOCATE) {
+            if (!search_alg_.locate()) {
+                if (output_.error_code != AKU_SUCCESS) {
+                    set_error_(output_.error_code);
+                }
+                state_ = DONE;
+                return;
+            }
+            int error_code = search_alg_.check_range();
+            if (error_code != AKU_SUCCESS) {
+                set_error_(error_code);
+                return;
+            }
+            if (query_.parallelism > 1 && search_alg_.start_partitions(query_.parallelism, &partitions_)) {
+                state_ = PARALLEL;
+                return;
+            }
+            search_alg_.scan_pos_ = search_alg_.range_.begin;
+            state_ = SCAN;
+        } else if (state_ == SCAN) {
+            const uint32_t max_index = search_alg_.MAX_INDEX_;
+            uint32_t pos = search_alg_.scan_pos_;
+            uint32_t stop = Backward ? (pos >= max_entries ? pos - max_entries : max_index)
+                                     : std::min(pos + max_entries, max_index);
+            // All results of the previous step are returned at this point,
+            // scan can be resumed from the beginning of the current step
+            scan_started_ = true;
+            step_begin_ = pos;
+            step_nproduced_ = output_.nproduced;
+            auto start = std::chrono::steady_clock::now();
+            search_alg_.scan_impl(pos, stop);
+            scan_time_ += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+            nscanned_ += Backward ? pos - search_alg_.scan_pos_ : search_alg_.scan_pos_ - pos;
+            if (search_alg_.scan_done_) {
+                finish_scan_();
+            }
+        }
+    }
+
+    int read_partitions_(CursorResult* buf, CursorColumns const& columns, int buf_len) {
+        auto concat = partitions_.concat.get();
+        int nread = buf ? concat->read(buf, buf_len) : concat->read_columns(columns);
+        int error_code = AKU_SUCCESS;
+        if (concat->is_error(&error_code)) {
+            set_error_(error_code);
+        } else if (concat->is_done()) {
+            state_ = DONE;
+            partitions_.stop();
+        }
+        return nread;
+    }
+
+    int read_impl_(CursorResult* buf, CursorColumns const& columns, size_t len) {
+        output_.reset(buf, columns, len);
+        while (output_.count < len && state_ != DONE && state_ != PARALLEL) {
+            step_(estimate_step_(len - output_.count));
+        }
+        if (state_ == PARALLEL && output_.count == 0u) {
+            return read_partitions_(buf, columns, static_cast<int>(len));
+        }
+        return static_cast<int>(output_.count);
+    }
+
+public:
+    PageCursor(PageHeader const* page, SearchQuery const& query, ChunkCache* cache, PageScanPosition const* resume)
+        : query_(query)
+        , matcher_(query_)
+        , search_alg_(page, caller_, &output_, query_, matcher_, cache)
+        , state_(LOCATE)
+        , error_(false)
+        , error_code_(AKU_SUCCESS)
+        , scan_time_(0)
+        , scan_started_(false)
+        , step_begin_(0u)
+        , step_nproduced_(0u)
+        , nscanned_(0u)
+    {
+        if (resume && resume->index < search_alg_.MAX_INDEX_) {
+            // Skip lookup, scan is resumed from the known position
+            if (!validate_query(query_)) {
+                set_error_(AKU_SEARCH_EBAD_ARG);
+                return;
+            }
+            search_alg_.scan_pos_ = resume->index;
+            output_.nskip = resume->nskip;
+            state_ = SCAN;
+        }
     }
+
+    virtual int read(CursorResult* buf, int buf_len) {
+        return read_impl_(buf, CursorColumns(), static_cast<size_t>(buf_len));
+    }
+
+    virtual int read_columns(CursorColumns const& columns) {
+        return read_impl_(nullptr, columns, columns.size);
+    }
+
+    virtual bool is_done() const {
+        return state_ == DONE && output_.overflow.empty();
+    }
+
+    virtual bool is_error(int* out_error_code_or_null) const {
+        if (out_error_code_or_null) {
+            *out_error_code_or_null = error_code_;
+        }
+        return error_;
+    }
+
+    virtual void close() {
+        if (state_ == SCAN) {
+            finish_scan_();
+        }
+        partitions_.stop();
+        output_.overflow.clear();
+        output_.overflow_pos = 0u;
+        state_ = DONE;
+    }
+
+    virtual bool get_position(PageScanPosition* position) const {
+        if (!scan_started_ || error_ || is_done()) {
+            return false;
+        }
+        auto page = search_alg_.page_;
+        position->page_id = page->page_id;
+        position->open_count = page->open_count;
+        position->index = step_begin_;
+        position->nskip = static_cast<uint32_t>(output_.nproduced - step_nproduced_ - output_.pending());
+        return true;
+    }
+};
+
+//! Collect series of the page using specialized search algorithm
+struct PageSeriesSearch {
+    PageHeader const* page;
+    SearchQuery const& query;
+    ChunkCache* cache;
+    std::unordered_set<aku_ParamId>* ids;
+    int error_code;
+
+    template<class Matcher>
+    void operator () (Matcher const& matcher) {
+        Caller caller;
+        BufferedCursor cursor(nullptr, 0u);
+        SearchAlgorithm<false, Matcher> search_alg(page, caller, &cursor, query, matcher, cache);
+        search_alg.series_ = ids;
+        if (search_alg.locate()) {
+            search_alg.scan();
+        }
+        error_code = cursor.error_code;
+    }
+};
+
+//! Create page cursor specialized for the query
+struct PageCursorFactory {
+    PageHeader const* page;
+    SearchQuery const& query;
+    ChunkCache* cache;
+    PageScanPosition const* resume;
+    std::unique_ptr<ExternalCursor> result;
+
+    template<class Matcher>
+    void operator () (Matcher const&) {
+        if (query.direction == AKU_CURSOR_DIR_BACKWARD) {
+            result.reset(new PageCursor<true, Matcher>(page, query, cache, resume));
+        } else {
+            result.reset(new PageCursor<false, Matcher>(page, query, cache, resume));
+        }
+    }
+};
+
+void PageHeader::search(Caller& caller, InternalCursor* cursor, SearchQuery query, ChunkCache* cache) const
+{
+    PageSearch search = { this, caller, cursor, query, cache };
+    dispatch_matcher(query, search);
+}
+
+std::unique_ptr<ExternalCursor> PageHeader::search( SearchQuery const& query
+                                                  , ChunkCache* cache
+                                                  , PageScanPosition const* resume) const
+{
+    PageCursorFactory factory = { this, query, cache, resume, nullptr };
+    dispatch_matcher(query, factory);
+    return std::move(factory.result);
+}
+
+aku_Status PageHeader::get_series( SearchQuery const& query
+                                 , ChunkCache* cache
+                                 , std::unordered_set<aku_ParamId>* ids) const
+{
+    // Series are collected by forward scan, param id streams of the chunks
+    // can be decoded without timestamps only in this direction.
+    SearchQuery fwd_query = query;
+    fwd_query.direction = AKU_CURSOR_DIR_FORWARD;
+    PageSeriesSearch search = { this, fwd_query, cache, ids, AKU_SUCCESS };
+    dispatch_matcher(fwd_query, search);
+    return search.error_code;
 }
 
 void PageHeader::_sort() {
@@ -875,7 +1778,7 @@ void PageHeader::_sort() {
     // Page invariants can break here.
     auto begin = page_index + sync_count;
     auto end = page_index + count;
-    std::sort(begin, end, [&](aku_EntryOffset a, aku_EntryOffset b) {
+    std::stable_sort(begin, end, [&](aku_EntryOffset a, aku_EntryOffset b) {
         auto ea = read_entry(a);
         auto eb = read_entry(b);
         auto ta = std::tuple<aku_TimeStamp, aku_ParamId>(ea->time, ea->param_id);
@@ -883,6 +1786,12 @@ void PageHeader::_sort() {
         return ta < tb;
     });
     sync_count = count;
+    if (get_index_kind() == AKU_PAGE_INDEX_LEARNED) {
+        learned.reset();
+        for (auto i = 0u; i < count; i++) {
+            learned.add(read_entry_at(i)->time, i);
+        }
+    }
 }
 
 void PageHeader::sync_next_index(aku_EntryOffset offset, uint32_t rand_val, bool sort_histogram) {
@@ -894,7 +1803,10 @@ void PageHeader::sync_next_index(aku_EntryOffset offset, uint32_t rand_val, bool
         auto index = sync_count++;
         page_index[index] = offset;
 
-        if (histogram.size < AKU_HISTOGRAM_SIZE) {
+        if (get_index_kind() == AKU_PAGE_INDEX_LEARNED) {
+            // learned index is updated incrementally and never sorted
+            learned.add(read_entry(offset)->time, index);
+        } else if (histogram.size < AKU_HISTOGRAM_SIZE) {
             // first AKU_HISTOGRAM_SIZE samples
             auto& h = histogram.entries[histogram.size++];
             h.index = index;
@@ -908,7 +1820,7 @@ void PageHeader::sync_next_index(aku_EntryOffset offset, uint32_t rand_val, bool
                 h.timestamp = read_entry(offset)->time;
             }
         }
-    } else {
+    } else if (get_index_kind() != AKU_PAGE_INDEX_LEARNED) {
         gfx::timsort(histogram.entries, histogram.entries + histogram.size,
                   [](PageHistogramEntry const& a, PageHistogramEntry const& b) {
                         return a.timestamp < b.timestamp;
@@ -918,16 +1830,7 @@ void PageHeader::sync_next_index(aku_EntryOffset offset, uint32_t rand_val, bool
 }
 
 void PageHeader::get_search_stats(aku_SearchStats* stats, bool reset) {
-    auto& gstats = get_global_search_stats();
-    std::lock_guard<std::mutex> guard(gstats.mutex);
-
-    memcpy( reinterpret_cast<void*>(stats)
-          , reinterpret_cast<void*>(&gstats.stats)
-          , sizeof(aku_SearchStats));
-
-    if (reset) {
-        memset(reinterpret_cast<void*>(&gstats.stats), 0, sizeof(aku_SearchStats));
-    }
+    Akumuli::get_search_stats(stats, reset);
 }
 
 }  // namepsace
@@ -23,6 +23,8 @@
 #pragma once
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <unordered_set>
 #include <vector>
 #include "akumuli.h"
 #include "util.h"
@@ -45,6 +47,9 @@ struct aku_Config {
 
     //! Maximum cache size in bytes
     uint32_t max_cache_size;
+
+    //! Index type of the newly opened pages
+    uint32_t page_index;
 };
 
 struct aku_Entry {
@@ -57,6 +62,12 @@ struct aku_Entry {
 //! PageHeader forward declaration
 struct PageHeader;
 
+//! Decoded chunk cache forward declaration
+class ChunkCache;
+
+//! Pull cursor forward declaration
+struct ExternalCursor;
+
 
 //! Cursor result
 struct CursorResult {
@@ -70,6 +81,18 @@ struct CursorResult {
 std::ostream& operator << (std::ostream& st, CursorResult res);
 
 
+/** Position of the page scan.
+ *  Scan can be resumed from this position while page is not
+ *  reused (open_count is the same).
+ */
+struct PageScanPosition {
+    uint32_t page_id;       //< page index in storage
+    uint32_t open_count;    //< page generation
+    uint32_t index;         //< index of the first page index entry to scan
+    uint32_t nskip;         //< number of results (produced starting from index) that was already returned
+};
+
+
 /** Page bounding box.
  *  All data is two dimentional: param-timestamp.
  */
@@ -92,10 +115,49 @@ struct PageHistogramEntry {
 /** Page histogram for approximation search */
 struct PageHistogram {
     uint32_t size;
+    uint32_t kind;      //< page index type, common for all index types (was padding, zero in old pages)
     PageHistogramEntry entries[AKU_HISTOGRAM_SIZE];
 };
 
 
+/** Learned index segment.
+ *  Linear approximation of the timestamp -> index mapping
+ *  for timestamps in range [key, next segment key).
+ */
+struct LearnedIndexSegment {
+    aku_TimeStamp key;      //< first timestamp of the segment
+    uint32_t      index;    //< index of the first entry with this timestamp
+    double        slope;    //< number of entries per time unit
+};
+
+
+/** Learned page index.
+ *  Piecewise linear approximation of the sorted part of the page index.
+ *  Only first occurrence of each timestamp is indexed and for every indexed
+ *  timestamp predicted index differs from the real one by no more than
+ *  AKU_LEARNED_INDEX_ERROR. Segments are built incrementally (shrinking cone
+ *  algorithm) so index doesn't need to be sorted or rebuilt.
+ */
+struct LearnedIndex {
+    uint32_t      size;         //< number of segments
+    uint32_t      kind;         //< page index type (same place as PageHistogram::kind)
+    aku_TimeStamp last_key;     //< last indexed timestamp
+    double        slope_lo;     //< min feasible slope of the last segment
+    double        slope_hi;     //< max feasible slope of the last segment
+    LearnedIndexSegment segments[AKU_LEARNED_INDEX_SIZE];
+
+    //! Remove all segments
+    void reset();
+
+    /** Add next entry to index.
+      * Entries that breaks timestamp order is ignored.
+      * @param timestamp entry timestamp
+      * @param index entry index
+      */
+    void add(aku_TimeStamp timestamp, uint32_t index);
+};
+
+
 /** Search query */
 struct SearchQuery {
 
@@ -114,13 +176,34 @@ struct SearchQuery {
     // Matcher f-n can return only MATCH and NO_MATCH. Search algorithms doesn't
     // need to rely on first two values of the enumeration (LT_ALL and GT_ALL).
     // This is just a hint to the search algorithm that can speedup search.
+    // Data sorted by (timestamp, paramId) pair can be scanned faster: rest of the
+    // timestamp group can be skipped on GT_ALL.
     typedef std::function<ParamMatch(aku_ParamId)> MatcherFn;
 
+    // Matcher type. Search algorithms are specialized for every matcher type
+    // so inner loops doesn't call param_pred. param_pred is always valid and
+    // can be used instead of specialized matcher.
+    enum MatcherKind {
+        MATCH_FN,       //< arbitrary predicate (param_pred)
+        MATCH_SINGLE,   //< one parameter (param_id)
+        MATCH_SET,      //< sorted set of parameters (params)
+        MATCH_BITMAP,   //< dense set of parameters (bitmap over [min_id, max_id] range)
+        MATCH_RANGE     //< all parameters in [min_id, max_id] range
+    };
+
     // search query
     aku_TimeStamp lowerbound;     //< begining of the time interval (0 for -inf) to search
     aku_TimeStamp upperbound;     //< end of the time interval (0 for inf) to search
     MatcherFn     param_pred;     //< parmeter search predicate
     int            direction;     //< scan direction
+    MatcherKind   kind;           //< matcher type
+    aku_ParamId   param_id;       //< parameter id (MATCH_SINGLE)
+    aku_ParamId   min_id;         //< smallest parameter id (MATCH_BITMAP and MATCH_RANGE)
+    aku_ParamId   max_id;         //< largest parameter id (MATCH_BITMAP and MATCH_RANGE)
+    std::vector<aku_ParamId> params;  //< sorted parameter ids (MATCH_SET)
+    std::vector<uint64_t>    bitmap;  //< bit per parameter id starting from min_id (MATCH_BITMAP)
+    uint32_t      parallelism = 1u;   //< max number of worker threads used by query (1 - search in caller's thread)
+    int           order = AKU_ORDER_BY_TIME;  //< results order (used by storage, page search is always time ordered)
 
     /** Query c-tor for single parameter searching
      *  @param pid parameter id
@@ -144,6 +227,32 @@ struct SearchQuery {
                , aku_TimeStamp low
                , aku_TimeStamp upp
                , int           scan_dir);
+
+    /** Query c-tor for set of parameters.
+     *  Matcher type is selected using number of parameters and their density.
+     *  @param ids parameter ids (can be unsorted)
+     *  @param low time lowerbound (0 for -inf)
+     *  @param upp time upperbound (MAX_TIMESTAMP for inf)
+     *  @param scan_dir scan direction
+     */
+    SearchQuery( std::vector<aku_ParamId> ids
+               , aku_TimeStamp            low
+               , aku_TimeStamp            upp
+               , int                      scan_dir);
+
+    /** Query c-tor for range of parameters.
+     *  Empty range (min_id > max_id) doesn't match anything.
+     *  @param min_id smallest parameter id (inclusive)
+     *  @param max_id largest parameter id (inclusive)
+     *  @param low time lowerbound (0 for -inf)
+     *  @param upp time upperbound (MAX_TIMESTAMP for inf)
+     *  @param scan_dir scan direction
+     */
+    SearchQuery( aku_ParamId   min_id
+               , aku_ParamId   max_id
+               , aku_TimeStamp low
+               , aku_TimeStamp upp
+               , int           scan_dir);
 };
 
 
@@ -175,7 +284,10 @@ struct PageHeader {
     uint64_t length;            //< page size
     // NOTE: maybe it is possible to get this data from page_index?
     PageBoundingBox bbox;       //< page data limits
-    PageHistogram histogram;    //< histogram
+    union {
+        PageHistogram histogram;    //< histogram
+        LearnedIndex learned;       //< learned index (much smaller than histogram)
+    };
     aku_EntryOffset page_index[];   //< page index
 
     //! Convert entry index to entry offset
@@ -193,7 +305,13 @@ struct PageHeader {
     PageHeader(uint32_t count, uint64_t length, uint32_t page_id);
 
     //! Clear all page conent (open_count += 1)
-    void reuse();
+    void reuse(uint32_t index_kind=AKU_PAGE_INDEX_HISTOGRAM);
+
+    //! Clear page index and change its type
+    void init_index(uint32_t index_kind);
+
+    //! Get page index type (AKU_PAGE_INDEX_HISTOGRAM or AKU_PAGE_INDEX_LEARNED)
+    uint32_t get_index_kind() const;
 
     //! Close page for write (close_count += 1)
     void close();
@@ -286,8 +404,29 @@ struct PageHeader {
 
     /**
      *  Search for entry
+     *  @param cache decoded chunk cache (optional)
      */
-    void search(Caller& caller, InternalCursor* cursor, SearchQuery query) const;
+    void search(Caller& caller, InternalCursor* cursor, SearchQuery query, ChunkCache* cache=nullptr) const;
+
+    /**
+     *  Create cursor that searches page on demand
+     *  @param cache decoded chunk cache (optional)
+     *  @param resume position of the previous scan with the same query (optional),
+     *         position should be obtained from cursor of the same page generation
+     */
+    std::unique_ptr<ExternalCursor> search( SearchQuery const& query
+                                          , ChunkCache* cache=nullptr
+                                          , PageScanPosition const* resume=nullptr) const;
+
+    /** Find series (param ids) that has values matching the query.
+      * Chunks are filtered by param id bounds and only param id streams
+      * of the chunks inside the time range are decoded.
+      * @param cache decoded chunk cache (optional)
+      * @param ids param ids of the page are added to this set
+      */
+    aku_Status get_series( SearchQuery const& query
+                         , ChunkCache* cache
+                         , std::unordered_set<aku_ParamId>* ids) const;
 
     // Only for testing
     void _sort();
@@ -0,0 +1,321 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "result_cache.h"
+#include "search_stats.h"
+
+namespace Akumuli {
+
+bool ResultKey::operator == (ResultKey const& other) const {
+    return page_id    == other.page_id
+        && open_count == other.open_count
+        && query      == other.query;
+}
+
+size_t ResultKeyHash::operator () (ResultKey const& key) const {
+    uint64_t hash = std::hash<std::string>()(key.query);
+    hash ^= static_cast<uint64_t>(key.page_id) << 32;
+    hash ^= static_cast<uint64_t>(key.open_count) << 48;
+    hash *= 0x9E3779B97F4A7C15ul;  // fibonacci hashing
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+
+//! Append binary representation of the value to key
+template<class T>
+static void key_append(std::string* key, T const& value) {
+    key->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool ResultCache::make_key(SearchQuery const& query, PageHeader const* page, ResultKey* key) {
+    if (page->close_count != page->open_count || query.kind == SearchQuery::MATCH_FN) {
+        // Page can be modified or predicate can't be compared
+        return false;
+    }
+    auto const& bbox = page->bbox;
+    aku_TimeStamp lowerbound = std::max(query.lowerbound, bbox.min_timestamp);
+    aku_TimeStamp upperbound = std::min(query.upperbound, bbox.max_timestamp);
+    std::string& out = key->query;
+    out.clear();
+    key_append(&out, static_cast<int>(query.kind));
+    key_append(&out, query.direction);
+    key_append(&out, lowerbound);
+    key_append(&out, upperbound);
+    switch (query.kind) {
+    case SearchQuery::MATCH_SINGLE:
+        key_append(&out, query.param_id);
+        break;
+    case SearchQuery::MATCH_SET:
+        for (auto id: query.params) {
+            key_append(&out, id);
+        }
+        break;
+    case SearchQuery::MATCH_BITMAP:
+        key_append(&out, query.min_id);
+        key_append(&out, query.max_id);
+        for (auto word: query.bitmap) {
+            key_append(&out, word);
+        }
+        break;
+    default:
+        key_append(&out, query.min_id);
+        key_append(&out, query.max_id);
+        break;
+    };
+    key->page_id = page->page_id;
+    key->open_count = page->open_count;
+    return true;
+}
+
+ResultCache::ResultCache(size_t max_size)
+    : max_size_(max_size)
+    , size_(0u)
+{
+}
+
+size_t ResultCache::estimate_size(ResultKey const& key, size_t nresults) {
+    return sizeof(LRUItem)
+         + sizeof(Results)
+         + key.query.capacity()
+         + nresults*sizeof(CursorResult);
+}
+
+void ResultCache::erase_(LRUList::iterator it) {
+    size_ -= estimate_size(it->first, it->second->size());
+    index_.erase(it->first);
+    items_.erase(it);
+}
+
+ResultCache::PResults ResultCache::get(ResultKey const& key) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        return PResults();
+    }
+    // move to front
+    items_.splice(items_.begin(), items_, it->second);
+    return it->second->second;
+}
+
+void ResultCache::put(ResultKey const& key, PResults results) {
+    auto entry_size = estimate_size(key, results->size());
+    if (entry_size > max_size_ / MAX_ENTRY_SHARE) {
+        // entry is too large and will evict everything else
+        return;
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        // other cursor searched the same page concurrently
+        items_.splice(items_.begin(), items_, it->second);
+        return;
+    }
+    while (!items_.empty() && size_ + entry_size > max_size_) {
+        erase_(std::prev(items_.end()));
+    }
+    items_.push_front(std::make_pair(key, results));
+    index_[key] = items_.begin();
+    size_ += entry_size;
+}
+
+void ResultCache::erase_page(uint32_t page_id) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    for (auto it = items_.begin(); it != items_.end();) {
+        auto curr = it++;
+        if (curr->first.page_id == page_id) {
+            erase_(curr);
+        }
+    }
+}
+
+size_t ResultCache::get_size() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return size_;
+}
+
+
+/** Cursor that reads cached results.
+  * Results are bound to the current page mapping.
+  */
+class CachedResultCursor : public ExternalCursor {
+    ResultCache::PResults   results_;
+    PageHeader const*       page_;
+    size_t                  pos_;
+
+public:
+    CachedResultCursor(ResultCache::PResults results, PageHeader const* page)
+        : results_(results)
+        , page_(page)
+        , pos_(0u)
+    {
+    }
+
+    virtual int read(CursorResult* buf, int buf_len) {
+        size_t n = std::min(results_->size() - pos_, static_cast<size_t>(buf_len));
+        for (size_t i = 0; i < n; i++) {
+            buf[i] = (*results_)[pos_ + i];
+            buf[i].page = page_;
+        }
+        pos_ += n;
+        return static_cast<int>(n);
+    }
+
+    virtual int read_columns(CursorColumns const& columns) {
+        size_t n = std::min(results_->size() - pos_, columns.size);
+        for (size_t i = 0; i < n; i++) {
+            CursorResult result = (*results_)[pos_ + i];
+            result.page = page_;
+            columns.set(i, result);
+        }
+        pos_ += n;
+        return static_cast<int>(n);
+    }
+
+    virtual bool is_done() const {
+        return pos_ == results_->size();
+    }
+
+    virtual bool is_error(int*) const {
+        return false;
+    }
+
+    virtual void close() {
+        pos_ = results_->size();
+    }
+};
+
+
+/** Cursor that records results of the page search.
+  * Results are added to cache only if search is completed
+  * without errors and results fits into single cache entry.
+  */
+class RecordingResultCursor : public ExternalCursor {
+    std::shared_ptr<ResultCache>                cache_;
+    ResultKey                                   key_;
+    std::unique_ptr<ExternalCursor>             cursor_;
+    std::shared_ptr<ResultCache::Results>       results_;   //< recorded results (null if recording was cancelled)
+    size_t                                      max_results_;
+    PageHeader const*                           page_;
+    std::vector<aku_TimeStamp>                  timestamps_;    //< columns that are not read by the user
+    std::vector<aku_ParamId>                    params_;
+    std::vector<aku_PData>                      pointers_;
+    std::vector<uint32_t>                       lengths_;
+
+    //! Check that `nread` new results can be recorded, cancel recording if they can't
+    bool can_record_(int nread) {
+        if (results_ && results_->size() + static_cast<size_t>(nread) > max_results_) {
+            results_.reset();
+        }
+        return static_cast<bool>(results_);
+    }
+
+    //! Add recorded results to cache if search is completed
+    void complete_() {
+        if (cursor_->is_done() && !cursor_->is_error(nullptr)) {
+            results_->shrink_to_fit();
+            cache_->put(key_, results_);
+            results_.reset();
+        }
+    }
+
+    template<class T>
+    static T* column(T* user_column, std::vector<T>& scratch, size_t size) {
+        if (user_column) {
+            return user_column;
+        }
+        scratch.resize(size);
+        return scratch.data();
+    }
+
+public:
+    RecordingResultCursor(std::shared_ptr<ResultCache> cache, ResultKey const& key,
+                          std::unique_ptr<ExternalCursor> cursor, size_t max_results,
+                          PageHeader const* page)
+        : cache_(cache)
+        , key_(key)
+        , cursor_(std::move(cursor))
+        , results_(std::make_shared<ResultCache::Results>())
+        , max_results_(max_results)
+        , page_(page)
+    {
+    }
+
+    virtual int read(CursorResult* buf, int buf_len) {
+        int nread = cursor_->read(buf, buf_len);
+        if (can_record_(nread)) {
+            results_->insert(results_->end(), buf, buf + nread);
+            complete_();
+        }
+        return nread;
+    }
+
+    virtual int read_columns(CursorColumns const& columns) {
+        if (!results_) {
+            return cursor_->read_columns(columns);
+        }
+        // All columns are needed to record results
+        CursorColumns cols = columns;
+        cols.timestamps = column(columns.timestamps, timestamps_, columns.size);
+        cols.params = column(columns.params, params_, columns.size);
+        cols.pointers = column(columns.pointers, pointers_, columns.size);
+        cols.lengths = column(columns.lengths, lengths_, columns.size);
+        int nread = cursor_->read_columns(cols);
+        if (can_record_(nread)) {
+            for (int i = 0; i < nread; i++) {
+                auto offset = static_cast<const char*>(cols.pointers[i]) - page_->cdata();
+                CursorResult result = { static_cast<aku_EntryOffset>(offset), cols.lengths[i],
+                                        cols.timestamps[i], cols.params[i], page_ };
+                results_->push_back(result);
+            }
+            complete_();
+        }
+        return nread;
+    }
+
+    virtual bool is_done() const {
+        return cursor_->is_done();
+    }
+
+    virtual bool is_error(int* out_error_code_or_null) const {
+        return cursor_->is_error(out_error_code_or_null);
+    }
+
+    virtual void close() {
+        results_.reset();
+        cursor_->close();
+    }
+
+    virtual bool get_position(PageScanPosition* position) const {
+        return cursor_->get_position(position);
+    }
+};
+
+std::unique_ptr<ExternalCursor> ResultCache::search(ResultKey const& key, PageHeader const* page, SearchFn const& search) {
+    auto& rst = get_thread_search_stats().rcache;
+    auto results = get(key);
+    if (results) {
+        stats_add(rst.n_hits, 1u);
+        return std::unique_ptr<ExternalCursor>(new CachedResultCursor(results, page));
+    }
+    stats_add(rst.n_misses, 1u);
+    size_t max_results = max_size_ / MAX_ENTRY_SHARE / sizeof(CursorResult);
+    return std::unique_ptr<ExternalCursor>(new RecordingResultCursor(shared_from_this(), key, search(), max_results, page));
+}
+
+}  // namespace
@@ -0,0 +1,115 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Cache of search results of the closed volumes.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "page.h"
+#include "cursor.h"
+
+namespace Akumuli {
+
+/** Cached search identifier.
+  * Closed page is immutable until it is reused, open_count is
+  * incremented on every reuse so old entries never match.
+  */
+struct ResultKey {
+    std::string     query;          //< normalized query
+    uint32_t        page_id;        //< page index in storage
+    uint32_t        open_count;     //< page generation
+
+    bool operator == (ResultKey const& other) const;
+};
+
+struct ResultKeyHash {
+    size_t operator () (ResultKey const& key) const;
+};
+
+
+/** Bounded LRU cache of page search results.
+  * Only results of the closed pages are cached. Entries store
+  * offsets of the results so page can be remapped between searches.
+  */
+class ResultCache : public std::enable_shared_from_this<ResultCache> {
+public:
+    typedef std::vector<CursorResult>       Results;
+    typedef std::shared_ptr<const Results>  PResults;
+    typedef std::function<std::unique_ptr<ExternalCursor>()> SearchFn;
+
+    enum {
+        MAX_ENTRY_SHARE = 4,    //< one entry can't use more than 1/MAX_ENTRY_SHARE of the cache
+    };
+
+    /** C-tor
+      * @param max_size memory limit in bytes
+      */
+    ResultCache(size_t max_size);
+
+    /** Create key of the page search.
+      * Query bounds are clipped to the page bounding box so queries that
+      * covers the whole page share the same entry.
+      * @return false if page is not closed or query can't be normalized (predicate matcher)
+      */
+    static bool make_key(SearchQuery const& query, PageHeader const* page, ResultKey* key);
+
+    //! Find results in cache, returns empty pointer if nothing found
+    PResults get(ResultKey const& key);
+
+    //! Add results to cache, least recently used entries will be evicted
+    void put(ResultKey const& key, PResults results);
+
+    //! Remove all entries of the page (page is reused)
+    void erase_page(uint32_t page_id);
+
+    /** Create cursor that reads cached results of the page. On cache miss page is
+      * searched using `search` and results are added to cache when search completes.
+      */
+    std::unique_ptr<ExternalCursor> search(ResultKey const& key, PageHeader const* page, SearchFn const& search);
+
+    //! Return estimated memory usage in bytes
+    size_t get_size() const;
+
+    //! Estimate memory used by cache entry
+    static size_t estimate_size(ResultKey const& key, size_t nresults);
+
+private:
+    typedef std::pair<ResultKey, PResults>                                  LRUItem;
+    typedef std::list<LRUItem>                                              LRUList;
+    typedef std::unordered_map<ResultKey, LRUList::iterator, ResultKeyHash> LRUIndex;
+
+    //! Remove entry from the cache (lock should be held)
+    void erase_(LRUList::iterator it);
+
+    const size_t        max_size_;
+    mutable std::mutex  mutex_;
+    LRUList             items_;     //< most recently used entries first
+    LRUIndex            index_;
+    size_t              size_;      //< current size in bytes
+};
+
+}  // namespace
@@ -0,0 +1,358 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+
+#include "rollup.h"
+
+namespace Akumuli {
+
+static const uint32_t ROLLUPS_MAGIC = 0x4c4c4f52;    // "ROLL"
+static const uint32_t ROLLUPS_VERSION = 1u;
+
+template<class T>
+static void write_pod(std::ostream& stream, T const& value) {
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<class T>
+static bool read_pod(std::istream& stream, T* value) {
+    stream.read(reinterpret_cast<char*>(value), sizeof(T));
+    return static_cast<bool>(stream);
+}
+
+// RollupTable
+
+RollupTable::RollupTable(aku_Duration resolution, size_t max_buckets, size_t max_size)
+    : resolution_(resolution)
+    , max_buckets_(max_buckets)
+    , max_size_(max_size)
+    , nentries_(0u)
+    , has_values_(false)
+    , begin_(0u)
+    , watermark_(0u)
+{
+}
+
+void RollupTable::add(aku_TimeStamp ts, aku_ParamId param, double value) {
+    aku_TimeStamp bucket = ts - ts % resolution_;
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!has_values_) {
+        // Older values of the first bucket can be stored only in volumes
+        begin_ = bucket + resolution_;
+        has_values_ = true;
+    }
+    auto& entries = buckets_[bucket];
+    auto size = entries.size();
+    entries[param].add(ts, value);
+    nentries_ += entries.size() - size;
+    shrink_();
+}
+
+size_t RollupTable::size_() const {
+    return buckets_.size()*node_size<std::map<aku_TimeStamp, Bucket>>() + nentries_*node_size<Bucket>();
+}
+
+void RollupTable::shrink_() {
+    while (buckets_.size() > 1u && (buckets_.size() > max_buckets_ || size_() > max_size_)) {
+        auto oldest = buckets_.begin();
+        begin_ = std::max(begin_, oldest->first + resolution_);
+        nentries_ -= oldest->second.size();
+        buckets_.erase(oldest);
+    }
+}
+
+void RollupTable::set_watermark(aku_TimeStamp ts) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    watermark_ = std::max(watermark_, ts);
+}
+
+aku_TimeStamp RollupTable::get_watermark() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return watermark_;
+}
+
+void RollupTable::save(std::ostream& stream) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    write_pod(stream, static_cast<uint64_t>(resolution_));
+    write_pod(stream, static_cast<uint64_t>(has_values_));
+    write_pod(stream, static_cast<uint64_t>(begin_));
+    write_pod(stream, static_cast<uint64_t>(watermark_));
+    write_pod(stream, static_cast<uint64_t>(buckets_.size()));
+    for (auto const& bucket: buckets_) {
+        write_pod(stream, static_cast<uint64_t>(bucket.first));
+        write_pod(stream, static_cast<uint64_t>(bucket.second.size()));
+        for (auto const& kv: bucket.second) {
+            write_pod(stream, static_cast<uint64_t>(kv.first));
+            write_pod(stream, kv.second);
+        }
+    }
+}
+
+bool RollupTable::load(std::istream& stream) {
+    uint64_t resolution, has_values, begin, watermark, nbuckets;
+    if (!read_pod(stream, &resolution) || resolution != resolution_ ||
+        !read_pod(stream, &has_values) || !read_pod(stream, &begin) ||
+        !read_pod(stream, &watermark) || !read_pod(stream, &nbuckets))
+    {
+        return false;
+    }
+    std::map<aku_TimeStamp, Bucket> buckets;
+    size_t nentries = 0u;
+    for (uint64_t i = 0u; i < nbuckets; i++) {
+        uint64_t ts, size;
+        if (!read_pod(stream, &ts) || !read_pod(stream, &size)) {
+            return false;
+        }
+        auto& bucket = buckets[ts];
+        for (uint64_t j = 0u; j < size; j++) {
+            uint64_t param;
+            AggregateState state;
+            if (!read_pod(stream, &param) || !read_pod(stream, &state)) {
+                return false;
+            }
+            bucket[param] = state;
+        }
+        nentries += bucket.size();
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    buckets_.swap(buckets);
+    nentries_ = nentries;
+    has_values_ = has_values != 0u;
+    begin_ = begin;
+    watermark_ = watermark;
+    shrink_();
+    return true;
+}
+
+aku_Duration RollupTable::get_resolution() const {
+    return resolution_;
+}
+
+size_t RollupTable::get_size() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return size_();
+}
+
+bool RollupTable::get_range(aku_TimeStamp* begin, aku_TimeStamp* end) const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!has_values_ || watermark_ <= begin_) {
+        return false;
+    }
+    *begin = begin_;
+    *end = watermark_;
+    return true;
+}
+
+std::vector<aku_AggregateRow> RollupTable::aggregate( SearchQuery const& query
+                                                    , aku_TimeStamp      begin
+                                                    , aku_TimeStamp      end
+                                                    , aku_Duration       bucket_width ) const
+{
+    std::vector<aku_AggregateRow> rows;
+    Bucket current;
+    aku_TimeStamp current_bucket = begin;
+    auto flush = [&]() {
+        for (auto const& kv: current) {
+            aku_AggregateRow row;
+            kv.second.get(current_bucket, kv.first, &row);
+            rows.push_back(row);
+        }
+        current.clear();
+    };
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = buckets_.lower_bound(begin);
+    auto last = buckets_.lower_bound(end);
+    for (; it != last; it++) {
+        aku_TimeStamp bucket = it->first - it->first % bucket_width;
+        if (bucket != current_bucket) {
+            flush();
+            current_bucket = bucket;
+        }
+        for (auto const& kv: it->second) {
+            if (query.param_pred(kv.first) == SearchQuery::MATCH) {
+                current[kv.first].combine(kv.second);
+            }
+        }
+    }
+    flush();
+    if (query.direction == AKU_CURSOR_DIR_BACKWARD) {
+        // Buckets are ordered backward, series inside bucket are ordered by id
+        std::stable_sort(rows.begin(), rows.end(), [](aku_AggregateRow const& lhs, aku_AggregateRow const& rhs) {
+            return lhs.bucket > rhs.bucket;
+        });
+    }
+    return rows;
+}
+
+// Rollups
+
+Rollups::Rollups(std::vector<aku_Duration> const& resolutions, int value_type, size_t max_buckets, size_t max_size)
+    : value_type_(value_type)
+    , max_buckets_(max_buckets)
+    , table_size_(max_size)
+    , tasks_(std::make_shared<TaskGroup>(WorkerPool::get_global(), 1u))
+    , pending_(0u)
+{
+    std::vector<aku_Duration> sorted(resolutions);
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    sorted.erase(std::remove(sorted.begin(), sorted.end(), 0u), sorted.end());
+    if (!sorted.empty()) {
+        table_size_ = max_size / sorted.size();
+    }
+    for (auto resolution: sorted) {
+        tables_.emplace_back(new RollupTable(resolution, max_buckets_, table_size_));
+    }
+}
+
+Rollups::~Rollups() {
+    wait();
+}
+
+void Rollups::add_chunk(PageHeader const* page, ChunkHeader const& chunk, aku_TimeStamp watermark) {
+    if (tables_.empty()) {
+        return;
+    }
+    // Page can be reused before the task is executed, values are decoded by the writer
+    auto samples = std::make_shared<std::vector<Sample>>();
+    samples->reserve(chunk.timestamps.size());
+    for (size_t i = 0; i < chunk.timestamps.size(); i++) {
+        CursorResult result = { chunk.offsets[i], chunk.lengths[i], chunk.timestamps[i], chunk.paramids[i], page };
+        decode(result, samples.get());
+    }
+    {
+        // Backpressure, decoded samples of the waiting chunks are kept in memory
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return pending_ < MAX_PENDING; });
+        pending_++;
+    }
+    tasks_->submit([this, samples, watermark]() {
+        process(*samples, watermark);
+        std::lock_guard<std::mutex> guard(mutex_);
+        pending_--;
+        cond_.notify_all();
+    });
+}
+
+void Rollups::decode(CursorResult const& result, std::vector<Sample>* samples) const {
+    Sample sample = { result.timestamp, result.param_id, 0.0 };
+    if (AggregateCursor::decode_value(result, value_type_, &sample.value)) {
+        samples->push_back(sample);
+    }
+}
+
+aku_Status Rollups::fill(ExternalCursor* cursor) {
+    const int BUFFER_SIZE = 0x1000;
+    std::vector<CursorResult> results(BUFFER_SIZE);
+    std::vector<Sample> samples;
+    wait();
+    std::lock_guard<std::mutex> guard(tables_mutex_);
+    while (!cursor->is_done()) {
+        int n = cursor->read(results.data(), BUFFER_SIZE);
+        samples.clear();
+        for (int i = 0; i < n; i++) {
+            decode(results[i], &samples);
+        }
+        for (auto& table: tables_) {
+            for (auto const& sample: samples) {
+                table->add(sample.timestamp, sample.param_id, sample.value);
+            }
+        }
+    }
+    int error_code = AKU_SUCCESS;
+    if (cursor->is_error(&error_code)) {
+        return error_code;
+    }
+    return AKU_SUCCESS;
+}
+
+void Rollups::process(std::vector<Sample> const& samples, aku_TimeStamp watermark) {
+    // Saved tables should contain all values of the chunk or none of them
+    std::lock_guard<std::mutex> guard(tables_mutex_);
+    for (auto& table: tables_) {
+        for (auto const& sample: samples) {
+            table->add(sample.timestamp, sample.param_id, sample.value);
+        }
+        // Watermark is moved only when all values are added
+        table->set_watermark(watermark);
+    }
+}
+
+void Rollups::wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this]() { return pending_ == 0u; });
+}
+
+aku_TimeStamp Rollups::get_watermark() const {
+    aku_TimeStamp watermark = AKU_MAX_TIMESTAMP;
+    for (auto const& table: tables_) {
+        watermark = std::min(watermark, table->get_watermark());
+    }
+    return tables_.empty() ? AKU_MIN_TIMESTAMP : watermark;
+}
+
+aku_Status Rollups::save(std::ostream& stream) {
+    std::lock_guard<std::mutex> guard(tables_mutex_);
+    write_pod(stream, ROLLUPS_MAGIC);
+    write_pod(stream, ROLLUPS_VERSION);
+    write_pod(stream, static_cast<uint32_t>(value_type_));
+    write_pod(stream, static_cast<uint32_t>(tables_.size()));
+    for (auto const& table: tables_) {
+        table->save(stream);
+    }
+    stream.flush();
+    return stream ? AKU_SUCCESS : AKU_EGENERAL;
+}
+
+aku_Status Rollups::load(std::istream& stream) {
+    uint32_t magic, version, value_type, ntables;
+    if (!read_pod(stream, &magic) || magic != ROLLUPS_MAGIC ||
+        !read_pod(stream, &version) || version != ROLLUPS_VERSION ||
+        !read_pod(stream, &value_type) || static_cast<int>(value_type) != value_type_ ||
+        !read_pod(stream, &ntables) || ntables != tables_.size())
+    {
+        return AKU_EBAD_DATA;
+    }
+    // Tables are replaced only if all of them are loaded
+    std::vector<std::unique_ptr<RollupTable>> tables;
+    for (auto const& table: tables_) {
+        tables.emplace_back(new RollupTable(table->get_resolution(), max_buckets_, table_size_));
+        if (!tables.back()->load(stream)) {
+            return AKU_EBAD_DATA;
+        }
+    }
+    wait();
+    std::lock_guard<std::mutex> guard(tables_mutex_);
+    tables_.swap(tables);
+    return AKU_SUCCESS;
+}
+
+int Rollups::get_value_type() const {
+    return value_type_;
+}
+
+RollupTable const* Rollups::find(aku_Duration bucket_width) const {
+    for (auto it = tables_.rbegin(); it != tables_.rend(); it++) {
+        if (bucket_width % (*it)->get_resolution() == 0u) {
+            return it->get();
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace
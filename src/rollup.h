@@ -0,0 +1,201 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Rollups - downsampled copies of the series data.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "page.h"
+#include "aggregation.h"
+#include "worker_pool.h"
+
+namespace Akumuli {
+
+/** Aggregates of the series values at fixed resolution.
+  * Rollup is complete (contains all values of the series) in
+  * [begin, watermark) time range. Only `max_buckets` newest buckets
+  * that fits into `max_size` bytes are stored, older buckets are discarded
+  * (every bucket stores an entry for every series, so the number of buckets
+  * alone doesn't bound the memory use).
+  */
+class RollupTable {
+public:
+    /** C-tor
+      * @param resolution width of the time bucket
+      * @param max_buckets max number of stored buckets
+      * @param max_size max size of the stored buckets in bytes (newest bucket is always stored)
+      */
+    RollupTable(aku_Duration resolution, size_t max_buckets, size_t max_size);
+
+    //! Add value
+    void add(aku_TimeStamp ts, aku_ParamId param, double value);
+
+    //! Mark all values older than `ts` as added
+    void set_watermark(aku_TimeStamp ts);
+
+    aku_TimeStamp get_watermark() const;
+
+    //! Write content of the table to stream
+    void save(std::ostream& stream) const;
+
+    //! Replace content of the table with data read from stream, returns false on error
+    bool load(std::istream& stream);
+
+    aku_Duration get_resolution() const;
+
+    //! Get estimated size of the stored buckets in bytes
+    size_t get_size() const;
+
+    /** Get time range where rollup is complete, returns false if
+      * there is no such range.
+      */
+    bool get_range(aku_TimeStamp* begin, aku_TimeStamp* end) const;
+
+    /** Compute aggregates.
+      * Rows are ordered by bucket in query direction and by param id inside bucket.
+      * @param query query, only params and direction are used
+      * @param begin beginning of the first bucket (multiple of `bucket_width`)
+      * @param end end of the last bucket (multiple of `bucket_width`)
+      * @param bucket_width width of the result bucket (multiple of resolution)
+      */
+    std::vector<aku_AggregateRow> aggregate( SearchQuery const& query
+                                           , aku_TimeStamp      begin
+                                           , aku_TimeStamp      end
+                                           , aku_Duration       bucket_width ) const;
+
+private:
+    typedef std::map<aku_ParamId, AggregateState> Bucket;
+
+    //! Estimated memory use of the map node
+    template<class Map>
+    static constexpr size_t node_size() {
+        return sizeof(typename Map::value_type) + 4*sizeof(void*);
+    }
+
+    //! Size of the stored buckets (caller should hold the lock)
+    size_t size_() const;
+
+    //! Discard oldest buckets until limits are met (caller should hold the lock)
+    void shrink_();
+
+    const aku_Duration                  resolution_;
+    const size_t                        max_buckets_;
+    const size_t                        max_size_;
+    mutable std::mutex                  mutex_;
+    std::map<aku_TimeStamp, Bucket>     buckets_;
+    size_t                              nentries_;      //< total number of series entries in all buckets
+    bool                                has_values_;
+    aku_TimeStamp                       begin_;         //< beginning of the first complete bucket
+    aku_TimeStamp                       watermark_;
+};
+
+
+/** Set of rollups with different resolutions.
+  * Rollups are filled by the background task using values of
+  * the completed chunks. Rollups are saved by the storage to a file
+  * next to the volumes, so they outlive recycled volumes and restarts.
+  */
+class Rollups {
+public:
+    enum {
+        MAX_PENDING = 4,    //< max number of chunks waiting for the background task
+    };
+
+    /** C-tor
+      * @param resolutions resolutions of the rollups
+      * @param value_type type of the values (one of the AKU_VALUE_* constants)
+      * @param max_buckets max number of buckets stored by each rollup
+      * @param max_size max size of all rollups in bytes (split evenly between rollups)
+      */
+    Rollups(std::vector<aku_Duration> const& resolutions, int value_type, size_t max_buckets, size_t max_size);
+
+    //! D-tor, waits for all background tasks to complete
+    ~Rollups();
+
+    /** Add values of the chunk.
+      * Values are read from the page immediately and added to rollups
+      * by the background task. Caller is blocked while MAX_PENDING chunks
+      * are waiting for the background task.
+      * @param page page that contains chunk values
+      * @param chunk completed chunk
+      * @param watermark all values older than watermark are already added
+      */
+    void add_chunk(PageHeader const* page, ChunkHeader const& chunk, aku_TimeStamp watermark);
+
+    /** Add values of the cursor synchronously, watermark isn't changed.
+      * Used to add values that was merged after the rollups was saved.
+      */
+    aku_Status fill(ExternalCursor* cursor);
+
+    //! Wait until all added chunks are processed by the background task
+    void wait();
+
+    //! Get watermark of the rollups (all values older than or equal to it are added)
+    aku_TimeStamp get_watermark() const;
+
+    /** Write rollups to stream. Every processed chunk is either saved
+      * completely or not saved at all.
+      */
+    aku_Status save(std::ostream& stream);
+
+    /** Read rollups saved by `save`. Rollups should have the same resolutions
+      * and value type, otherwise AKU_EBAD_DATA is returned and rollups are not changed.
+      */
+    aku_Status load(std::istream& stream);
+
+    int get_value_type() const;
+
+    /** Find rollup that can be used to compute aggregates with `bucket_width`.
+      * Coarsest rollup with resolution that divides `bucket_width` is returned.
+      * Returns null if there is no such rollup.
+      */
+    RollupTable const* find(aku_Duration bucket_width) const;
+
+private:
+    struct Sample {
+        aku_TimeStamp   timestamp;
+        aku_ParamId     param_id;
+        double          value;
+    };
+
+    //! Decode value of the result and add it to `samples` (values of the wrong size are skipped)
+    void decode(CursorResult const& result, std::vector<Sample>* samples) const;
+
+    void process(std::vector<Sample> const& samples, aku_TimeStamp watermark);
+
+    std::vector<std::unique_ptr<RollupTable>>   tables_;    //< sorted by resolution
+    const int                                   value_type_;
+    const size_t                                max_buckets_;
+    size_t                                      table_size_; //< max size of every table
+    std::mutex                                  tables_mutex_;  //< serializes updates and saving of the tables
+    std::shared_ptr<TaskGroup>                  tasks_;     //< background tasks (executed one by one)
+    std::mutex                                  mutex_;
+    std::condition_variable                     cond_;
+    size_t                                      pending_;   //< number of not processed chunks
+};
+
+}  // namespace
@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <cstring>
+#include <mutex>
+#include <set>
+
+#include "search_stats.h"
+
+namespace Akumuli {
+
+static_assert(sizeof(aku_SearchStats) % sizeof(uint64_t) == 0,
+              "aku_SearchStats must contain only uint64_t counters");
+
+static const size_t NUM_COUNTERS = sizeof(aku_SearchStats) / sizeof(uint64_t);
+
+static uint64_t* counters(aku_SearchStats* stats) {
+    return reinterpret_cast<uint64_t*>(stats);
+}
+
+struct ThreadStats;
+
+//! Counters of all threads
+struct StatsRegistry {
+    std::mutex              mutex;
+    std::set<ThreadStats*>  threads;    //< live threads
+    aku_SearchStats         retired;    //< sum of counters of all finished threads
+    aku_SearchStats         baseline;   //< totals at the moment of the last reset
+
+    StatsRegistry() {
+        memset(&retired, 0, sizeof(retired));
+        memset(&baseline, 0, sizeof(baseline));
+    }
+};
+
+static StatsRegistry& get_registry() {
+    static StatsRegistry registry;
+    return registry;
+}
+
+//! Counters of one thread, registered on first use and retired on thread exit
+struct ThreadStats {
+    aku_SearchStats stats;
+
+    ThreadStats() {
+        memset(&stats, 0, sizeof(stats));
+        auto& registry = get_registry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        registry.threads.insert(this);
+    }
+
+    ~ThreadStats() {
+        auto& registry = get_registry();
+        std::lock_guard<std::mutex> guard(registry.mutex);
+        auto src = counters(&stats);
+        auto dst = counters(&registry.retired);
+        for (size_t i = 0; i < NUM_COUNTERS; i++) {
+            dst[i] += src[i];
+        }
+        registry.threads.erase(this);
+    }
+};
+
+aku_SearchStats& get_thread_search_stats() {
+    static thread_local ThreadStats tstats;
+    return tstats.stats;
+}
+
+void stats_add_latency(aku_SearchStats::LatencyHistogram& hist, uint64_t nanoseconds) {
+    int bucket = nanoseconds ? 63 - __builtin_clzll(nanoseconds) : 0;
+    if (bucket >= AKU_LATENCY_HISTOGRAM_SIZE) {
+        bucket = AKU_LATENCY_HISTOGRAM_SIZE - 1;
+    }
+    stats_add(hist.n_times, 1u);
+    stats_add(hist.total_ns, nanoseconds);
+    stats_add(hist.buckets[bucket], 1u);
+}
+
+void get_search_stats(aku_SearchStats* stats, bool reset) {
+    auto& registry = get_registry();
+    std::lock_guard<std::mutex> guard(registry.mutex);
+
+    aku_SearchStats total = registry.retired;
+    auto dst = counters(&total);
+    for (auto tstats: registry.threads) {
+        auto src = counters(&tstats->stats);
+        for (size_t i = 0; i < NUM_COUNTERS; i++) {
+            dst[i] += __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        }
+    }
+
+    // Counters are never modified by reader, reset only moves the baseline
+    auto base = counters(&registry.baseline);
+    auto out = counters(stats);
+    for (size_t i = 0; i < NUM_COUNTERS; i++) {
+        out[i] = dst[i] - base[i];
+    }
+    if (reset) {
+        registry.baseline = total;
+    }
+}
+
+LatencyTimer::LatencyTimer(aku_SearchStats::LatencyHistogram aku_SearchStats::Latency::* hist)
+    : hist_(hist)
+    , start_(Clock::now())
+{
+}
+
+LatencyTimer::~LatencyTimer() {
+    auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start_);
+    stats_add_latency(get_thread_search_stats().latency.*hist_, static_cast<uint64_t>(duration.count()));
+}
+
+}  // namespace
@@ -0,0 +1,66 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Search statistics.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <chrono>
+
+#include "akumuli.h"
+
+namespace Akumuli {
+
+/** Search counters of the current thread.
+  * Every thread owns its own set of counters, only owner can modify
+  * them so no locking is needed. Counters of all threads are
+  * aggregated by `get_search_stats`.
+  */
+aku_SearchStats& get_thread_search_stats();
+
+//! Increment counter that belongs to current thread
+inline void stats_add(uint64_t& counter, uint64_t value) {
+    // Single writer, relaxed store is enough for concurrent readers
+    __atomic_store_n(&counter, __atomic_load_n(&counter, __ATOMIC_RELAXED) + value, __ATOMIC_RELAXED);
+}
+
+//! Add measurement to latency histogram that belongs to current thread
+void stats_add_latency(aku_SearchStats::LatencyHistogram& hist, uint64_t nanoseconds);
+
+/** Aggregate counters of all threads.
+  * @param stats destination
+  * @param reset reset all counters if true
+  */
+void get_search_stats(aku_SearchStats* stats, bool reset);
+
+
+/** Scoped latency measurement.
+  * Duration is added to the histogram of the current thread
+  * on destruction.
+  */
+class LatencyTimer {
+    typedef std::chrono::steady_clock Clock;
+    aku_SearchStats::LatencyHistogram aku_SearchStats::Latency::* hist_;
+    Clock::time_point start_;
+public:
+    LatencyTimer(aku_SearchStats::LatencyHistogram aku_SearchStats::Latency::* hist);
+    ~LatencyTimer();
+};
+
+}  // namespace
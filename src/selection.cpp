@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "selection.h"
+
+namespace Akumuli {
+
+//! Four param ids (compiled to SSE/AVX instructions when available)
+typedef aku_ParamId ParamIdVec __attribute__((vector_size(4*sizeof(aku_ParamId))));
+
+//! Positions of the set bits for every 4-bit mask
+static const uint8_t COMPACT_TABLE[16][4] = {
+    {0, 0, 0, 0}, {0, 0, 0, 0}, {1, 0, 0, 0}, {0, 1, 0, 0},
+    {2, 0, 0, 0}, {0, 2, 0, 0}, {1, 2, 0, 0}, {0, 1, 2, 0},
+    {3, 0, 0, 0}, {0, 3, 0, 0}, {1, 3, 0, 0}, {0, 1, 3, 0},
+    {2, 3, 0, 0}, {0, 2, 3, 0}, {1, 2, 3, 0}, {0, 1, 2, 3},
+};
+
+std::pair<uint32_t, uint32_t> select_time_range( aku_TimeStamp const* timestamps
+                                               , uint32_t             size
+                                               , aku_TimeStamp        lowerbound
+                                               , aku_TimeStamp        upperbound)
+{
+    // Timestamps are sorted, no need to check every row
+    auto begin = timestamps;
+    auto end = timestamps + size;
+    auto first = std::lower_bound(begin, end, lowerbound);
+    auto last = std::upper_bound(first, end, upperbound);
+    return std::make_pair(static_cast<uint32_t>(first - begin), static_cast<uint32_t>(last - begin));
+}
+
+void select_param_eq( aku_ParamId const*  paramids
+                    , uint32_t            begin
+                    , uint32_t            end
+                    , aku_ParamId         param_id
+                    , SelectionVector*    out)
+{
+    // Each step writes four indexes but advances only by the number of matches
+    out->resize(end - begin + 4);
+    uint32_t* dest = out->data();
+    uint32_t n = 0u;
+    uint32_t i = begin;
+    const ParamIdVec key = { param_id, param_id, param_id, param_id };
+    for (; i + 4 <= end; i += 4) {
+        ParamIdVec ids;
+        memcpy(&ids, paramids + i, sizeof(ids));
+        auto eq = ids == key;
+        unsigned mask = (eq[0] & 1) | (eq[1] & 2) | (eq[2] & 4) | (eq[3] & 8);
+        auto const& positions = COMPACT_TABLE[mask];
+        dest[n + 0] = i + positions[0];
+        dest[n + 1] = i + positions[1];
+        dest[n + 2] = i + positions[2];
+        dest[n + 3] = i + positions[3];
+        n += __builtin_popcount(mask);
+    }
+    for (; i < end; i++) {
+        dest[n] = i;
+        n += paramids[i] == param_id;
+    }
+    out->resize(n);
+}
+
+uint32_t skip_timestamp_group( aku_TimeStamp const* timestamps
+                             , uint32_t             begin
+                             , uint32_t             end)
+{
+    // Galloping search, groups are usually small
+    const aku_TimeStamp ts = timestamps[begin];
+    uint32_t lo = begin + 1;
+    uint32_t step = 1;
+    while (lo < end && timestamps[lo] == ts) {
+        begin = lo;
+        lo = end - lo > step ? lo + step : end;
+        step *= 2;
+    }
+    // timestamps[begin] == ts, timestamps[lo] != ts or lo == end
+    auto it = std::upper_bound(timestamps + begin, timestamps + lo, ts);
+    return static_cast<uint32_t>(it - timestamps);
+}
+
+void select_param_fn( aku_ParamId const*              paramids
+                    , uint32_t                        begin
+                    , uint32_t                        end
+                    , SearchQuery::MatcherFn const&   matcher
+                    , SelectionVector*                out)
+{
+    out->resize(end - begin);
+    uint32_t* dest = out->data();
+    uint32_t n = 0u;
+    // Neighbour rows often has the same id, matcher is called only when id changes
+    aku_ParamId last_id = 0u;
+    bool last_match = false;
+    bool first = true;
+    for (uint32_t i = begin; i < end; i++) {
+        auto id = paramids[i];
+        if (first || id != last_id) {
+            last_match = matcher(id) == SearchQuery::MATCH;
+            last_id = id;
+            first = false;
+        }
+        dest[n] = i;
+        n += last_match;
+    }
+    out->resize(n);
+}
+
+}  // namespace
@@ -0,0 +1,206 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Selection vector kernels for decoded chunk columns.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "page.h"
+#include "matchers.h"
+
+namespace Akumuli {
+
+//! Selection vector - ordered list of row indexes
+typedef std::vector<uint32_t> SelectionVector;
+
+/** Find rows inside time range.
+  * @param timestamps sorted timestamps column
+  * @param size number of rows
+  * @param lowerbound time range begining (inclusive)
+  * @param upperbound time range end (inclusive)
+  * @returns range of rows [first, last)
+  */
+std::pair<uint32_t, uint32_t> select_time_range( aku_TimeStamp const* timestamps
+                                               , uint32_t             size
+                                               , aku_TimeStamp        lowerbound
+                                               , aku_TimeStamp        upperbound);
+
+/** Select rows with specific param id (SIMD).
+  * @param paramids param ids column
+  * @param begin first row
+  * @param end last row (not included)
+  * @param param_id param id to find
+  * @param out result, previous content is replaced
+  */
+void select_param_eq( aku_ParamId const*  paramids
+                    , uint32_t            begin
+                    , uint32_t            end
+                    , aku_ParamId         param_id
+                    , SelectionVector*    out);
+
+/** Select rows that matches predicate.
+  * @param paramids param ids column
+  * @param begin first row
+  * @param end last row (not included)
+  * @param matcher param id predicate
+  * @param out result, previous content is replaced
+  */
+void select_param_fn( aku_ParamId const*              paramids
+                    , uint32_t                        begin
+                    , uint32_t                        end
+                    , SearchQuery::MatcherFn const&   matcher
+                    , SelectionVector*                out);
+
+/** Select rows that matches param id matcher.
+  * @param paramids param ids column
+  * @param begin first row
+  * @param end last row (not included)
+  * @param matcher one of the matchers from matchers.h
+  * @param out result, previous content is replaced
+  */
+/** Find end of the timestamp group.
+  * @param timestamps sorted timestamps column
+  * @param begin first row of the group
+  * @param end last row (not included)
+  * @returns index of the first row after `begin` with different timestamp or `end`
+  */
+uint32_t skip_timestamp_group( aku_TimeStamp const* timestamps
+                             , uint32_t             begin
+                             , uint32_t             end);
+
+/** Select rows that matches param id matcher using LT_ALL/GT_ALL hints.
+  * Rows must be sorted by (timestamp, param id) pair. On GT_ALL rest of
+  * the timestamp group is skipped without calling matcher.
+  * @param timestamps timestamps column
+  * @param paramids param ids column
+  * @param begin first row
+  * @param end last row (not included)
+  * @param matcher one of the matchers from matchers.h
+  * @param out result, previous content is replaced
+  */
+template<class Matcher>
+void select_params_sorted( aku_TimeStamp const* timestamps
+                         , aku_ParamId const*   paramids
+                         , uint32_t             begin
+                         , uint32_t             end
+                         , Matcher const&       matcher
+                         , SelectionVector*     out)
+{
+    out->resize(end - begin);
+    uint32_t* dest = out->data();
+    uint32_t n = 0u;
+    uint32_t i = begin;
+    while (i < end) {
+        switch (matcher.match(paramids[i])) {
+        case SearchQuery::MATCH:
+            dest[n++] = i;
+            i++;
+            break;
+        case SearchQuery::GT_ALL:
+            i = skip_timestamp_group(timestamps, i, end);
+            break;
+        default:
+            i++;
+            break;
+        };
+    }
+    out->resize(n);
+}
+
+template<class Matcher>
+void select_params( aku_ParamId const*  paramids
+                  , uint32_t            begin
+                  , uint32_t            end
+                  , Matcher const&      matcher
+                  , SelectionVector*    out)
+{
+    out->resize(end - begin);
+    uint32_t* dest = out->data();
+    uint32_t n = 0u;
+    for (uint32_t i = begin; i < end; i++) {
+        dest[n] = i;
+        n += matcher(paramids[i]);
+    }
+    out->resize(n);
+}
+
+inline void select_params( aku_ParamId const*          paramids
+                         , uint32_t                    begin
+                         , uint32_t                    end
+                         , SingleParamMatcher const&   matcher
+                         , SelectionVector*            out)
+{
+    select_param_eq(paramids, begin, end, matcher.id, out);
+}
+
+inline void select_params( aku_ParamId const*  paramids
+                         , uint32_t            begin
+                         , uint32_t            end
+                         , FnMatcher const&    matcher
+                         , SelectionVector*    out)
+{
+    select_param_fn(paramids, begin, end, matcher.fn, out);
+}
+
+/** Select rows that matches param id matcher.
+  * Rows must be sorted by (timestamp, param id) pair. Uses LT_ALL/GT_ALL hints
+  * for matchers that evaluate rows one by one and vectorized kernel otherwise.
+  * @param timestamps timestamps column
+  * @param paramids param ids column
+  * @param begin first row
+  * @param end last row (not included)
+  * @param matcher one of the matchers from matchers.h
+  * @param out result, previous content is replaced
+  */
+template<class Matcher>
+void select_params( aku_TimeStamp const* timestamps
+                  , aku_ParamId const*   paramids
+                  , uint32_t             begin
+                  , uint32_t             end
+                  , Matcher const&       matcher
+                  , SelectionVector*     out)
+{
+    (void)timestamps;
+    select_params(paramids, begin, end, matcher, out);
+}
+
+inline void select_params( aku_TimeStamp const*      timestamps
+                         , aku_ParamId const*        paramids
+                         , uint32_t                  begin
+                         , uint32_t                  end
+                         , SortedSetMatcher const&   matcher
+                         , SelectionVector*          out)
+{
+    select_params_sorted(timestamps, paramids, begin, end, matcher, out);
+}
+
+inline void select_params( aku_TimeStamp const* timestamps
+                         , aku_ParamId const*   paramids
+                         , uint32_t             begin
+                         , uint32_t             end
+                         , FnMatcher const&     matcher
+                         , SelectionVector*     out)
+{
+    select_params_sorted(timestamps, paramids, begin, end, matcher, out);
+}
+
+}  // namespace
@@ -71,15 +71,21 @@ bool operator < (TimeSeriesValue const& lhs, TimeSeriesValue const& rhs) {
 
 // Sequencer
 
-Sequencer::Sequencer(PageHeader const* page, aku_Config config)
+Sequencer::Sequencer(PageHeader const* page, aku_Config config, LastValueTable* last_values, Rollups* rollups,
+                     Subscriptions* subscriptions)
     : window_size_(config.window_size)
     , page_(page)
     , top_timestamp_()
     , checkpoint_(0u)
     , sequence_number_ {0}
-    , run_locks_(RUN_LOCK_FLAGS_SIZE)
     , space_estimate_(0u)
     , c_threshold_(config.compression_threshold)
+    , last_values_(last_values)
+    , rollups_(rollups)
+    , ready_top_(AKU_MIN_TIMESTAMP)
+    , runs_min_(AKU_MAX_TIMESTAMP)
+    , n_compactions_(0u)
+    , subscriptions_(subscriptions)
 {
     key_.reset(new SortedRun());
     key_->push_back(TimeSeriesValue());
@@ -102,32 +108,45 @@ int Sequencer::make_checkpoint_(uint32_t new_checkpoint) {
     if (flag % 2 != 0) {
         auto old_top = get_timestamp_(checkpoint_);
         checkpoint_ = new_checkpoint;
+        // New values can't be older than old_top because of the late write limit
+        ready_top_ = old_top;
+        // Runs are shared with snapshots and never modified here, split runs are copied.
+        // New runs become visible to readers together with the ready runs.
         vector<PSortedRun> new_runs;
-        for (auto& sorted_run: runs_) {
+        vector<PSortedRun> new_ready;
+        for (auto const& sorted_run: runs_) {
             auto it = lower_bound(sorted_run->begin(), sorted_run->end(), TimeSeriesValue(old_top, AKU_LIMITS_MAX_ID, 0u, 0u));
             if (it == sorted_run->begin()) {
                 // all timestamps are newer than old_top, do nothing
-                new_runs.push_back(move(sorted_run));
+                new_runs.push_back(sorted_run);
                 continue;
             } else if (it == sorted_run->end()) {
                 // all timestamps are older than old_top, move them
-                ready_.push_back(move(sorted_run));
+                new_ready.push_back(sorted_run);
             } else {
                 // it is in between of the sorted run - split
                 PSortedRun run(new SortedRun());
                 copy(sorted_run->begin(), it, back_inserter(*run));  // copy old
-                ready_.push_back(move(run));
+                new_ready.push_back(move(run));
                 run.reset(new SortedRun());
                 copy(it, sorted_run->end(), back_inserter(*run));  // copy new
                 new_runs.push_back(move(run));
             }
         }
+        // Only writer modifies runs so fronts of the new runs can be read without lock
+        aku_TimeStamp new_min = AKU_MAX_TIMESTAMP;
+        for (auto const& sorted_run: new_runs) {
+            new_min = min(new_min, sorted_run->front().get_timestamp());
+        }
         Lock guard(runs_resize_lock_);
         space_estimate_ = 0u;
         for (auto& sorted_run: new_runs) {
             space_estimate_ += sorted_run->size() * SPACE_PER_ELEMENT;
         }
         swap(runs_, new_runs);
+        runs_min_ = new_min;
+        ready_.insert(ready_.end(), new_ready.begin(), new_ready.end());
+        guard.unlock();
 
         size_t ready_size = 0u;
         for (auto& sorted_run: ready_) {
@@ -182,56 +201,49 @@ std::tuple<int, int> Sequencer::add(TimeSeriesValue const& value) {
 
     Lock guard(runs_resize_lock_);
     space_estimate_ += SPACE_PER_ELEMENT;
-    auto begin = runs_.begin();
-    auto end = runs_.end();
-    auto insert_it = lower_bound(begin, end, key_, top_element_more<PSortedRun>);
-    int run_ix = distance(begin, insert_it);
-    bool new_run_needed = insert_it == runs_.end();
-    SortedRun* run = nullptr;
-    if (!new_run_needed) {
-        run = insert_it->get();
-    }
-    guard.unlock();
-
-    if (!new_run_needed) {
-        auto ix = run_ix & RUN_LOCK_FLAGS_MASK;
-        auto& rwlock = run_locks_.at(ix);
-        rwlock.wrlock();
-        run->push_back(value);
-        rwlock.unlock();
-    } else {
-        guard.lock();
+    runs_min_ = min(runs_min_, get<0>(value.key_));
+    auto insert_it = lower_bound(runs_.begin(), runs_.end(), key_, top_element_more<PSortedRun>);
+    bool new_run_added = insert_it == runs_.end();
+    if (new_run_added) {
         PSortedRun new_pile(new SortedRun());
         new_pile->push_back(value);
         runs_.push_back(move(new_pile));
-        guard.unlock();
+    } else {
+        auto& run = *insert_it;
+        if (run->size() == run->capacity() && run.use_count() > 1) {
+            // Run is shared with snapshot, reallocation would invalidate views of the
+            // run so values are copied to the new run (snapshot keeps the old one).
+            PSortedRun grown(new SortedRun());
+            grown->reserve(run->size()*2);
+            grown->assign(run->begin(), run->end());
+            run = move(grown);
+        }
+        run->push_back(value);
     }
-    return make_tuple(AKU_SUCCESS, lock);
-}
+    guard.unlock();
 
-template<class Cont>
-void wrlock_all(Cont& cont) {
-    for (auto& rwlock: cont) {
-        rwlock.wrlock();
+    if (new_run_added && runs_.size() > AKU_SEQUENCER_MAX_RUNS) {
+        // Out of order values produce many small runs
+        compact_runs_();
     }
-}
 
-template<class Cont>
-void unlock_all(Cont& cont) {
-    for (auto& rwlock: cont) {
-        rwlock.unlock();
+    if (last_values_ && page_) {
+        LastValue last = { get<0>(value.key_), value.value, value.value_length, page_->page_id, page_->open_count };
+        last_values_->update(get<1>(value.key_), last);
+    }
+    if (subscriptions_ && page_) {
+        subscriptions_->publish(page_, get<0>(value.key_), get<1>(value.key_), value.value, value.value_length);
     }
+    return make_tuple(AKU_SUCCESS, lock);
 }
 
 int Sequencer::reset() {
-    wrlock_all(run_locks_);
+    runs_resize_lock_.lock();
     for (auto& sorted_run: runs_) {
         ready_.push_back(move(sorted_run));
     }
-    unlock_all(run_locks_);
-
-    runs_resize_lock_.lock();
     runs_.clear();
+    runs_min_ = AKU_MAX_TIMESTAMP;
     runs_resize_lock_.unlock();
     sequence_number_.store(1);
     return 1;
@@ -256,70 +268,270 @@ struct MergePred<TKey, AKU_CURSOR_DIR_BACKWARD> {
     }
 };
 
-template<class TRun, int dir>
+template<int dir>
 struct RunIter;
 
-template<class TRun>
-struct RunIter<std::shared_ptr<TRun>, AKU_CURSOR_DIR_FORWARD> {
-    typedef boost::iterator_range<typename TRun::const_iterator> range_type;
-    typedef typename TRun::value_type value_type;
-    static range_type make_range(std::shared_ptr<TRun> const& run) {
-        return boost::make_iterator_range(run->begin(), run->end());
+template<>
+struct RunIter<AKU_CURSOR_DIR_FORWARD> {
+    typedef Sequencer::SortedRun::const_iterator iterator;
+    typedef boost::iterator_range<iterator> range_type;
+    static range_type make_range(Sequencer::SortedRun::const_iterator begin, Sequencer::SortedRun::const_iterator end) {
+        return boost::make_iterator_range(begin, end);
     }
 };
 
-template<class TRun>
-struct RunIter<std::shared_ptr<TRun>, AKU_CURSOR_DIR_BACKWARD> {
-    typedef boost::iterator_range<typename TRun::const_reverse_iterator> range_type;
-    typedef typename TRun::value_type value_type;
-    static range_type make_range(std::shared_ptr<TRun> const& run) {
-        return boost::make_iterator_range(run->rbegin(), run->rend());
+template<>
+struct RunIter<AKU_CURSOR_DIR_BACKWARD> {
+    typedef Sequencer::SortedRun::const_reverse_iterator iterator;
+    typedef boost::iterator_range<iterator> range_type;
+    static range_type make_range(Sequencer::SortedRun::const_iterator begin, Sequencer::SortedRun::const_iterator end) {
+        return boost::make_iterator_range(iterator(end), iterator(begin));
     }
 };
 
-/** Merge sequences and push it to consumer */
-template <int dir, class Consumer>
-void kway_merge(vector<Sequencer::PSortedRun> const& runs, Consumer& cons) {
-    typedef RunIter<Sequencer::PSortedRun, dir> RIter;
-    typedef typename RIter::range_type range_t;
-    typedef typename RIter::value_type KeyType;
-    std::vector<range_t> ranges;
-    for(auto i = runs.begin(); i != runs.end(); i++) {
-        ranges.push_back(RIter::make_range(*i));
+/** Find first element that doesn't satisfy `pred` (elements that satisfy
+  * `pred` must precede all other elements). Result is expected to be close
+  * to `begin` so galloping search is used instead of plain binary search.
+  */
+template<class It, class Pred>
+static It gallop_partition_point(It begin, It end, Pred const& pred) {
+    ptrdiff_t step = 1;
+    It lo = begin;
+    while (end - lo > step && pred(*(lo + step))) {
+        lo += step;
+        step *= 2;
+    }
+    // partition point is in [lo, hi]
+    It hi = end - lo > step ? lo + step : end;
+    while (lo < hi) {
+        It mid = lo + (hi - lo) / 2;
+        if (pred(*mid)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//! Merge filter that accepts all values
+struct MatchAll {
+    template<class It>
+    It find(It begin, It) const {
+        return begin;
+    }
+};
+
+/** Merge filter that accepts values of the query series.
+  * Runs are sorted by (timestamp, paramid), matcher hints are used to skip
+  * parts of the timestamp groups that can't match.
+  */
+template<int dir>
+struct MatchSeries {
+    SearchQuery::MatcherFn  pred;
+    bool                    has_bounds; //< min_id and max_id are valid
+    aku_ParamId             min_id;
+    aku_ParamId             max_id;
+
+    MatchSeries(SearchQuery const& query)
+        : pred(query.param_pred)
+        , has_bounds(query.kind != SearchQuery::MATCH_FN)
+        , min_id(query.min_id)
+        , max_id(query.max_id)
+    {
+    }
+
+    //! Find first matching value in [begin, end)
+    template<class It>
+    It find(It begin, It end) const {
+        // Ids are decreasing inside of the timestamp group in backward direction
+        const bool forward = dir == AKU_CURSOR_DIR_FORWARD;
+        const auto skip_group = forward ? SearchQuery::GT_ALL : SearchQuery::LT_ALL;
+        const auto skip_ids   = forward ? SearchQuery::LT_ALL : SearchQuery::GT_ALL;
+        const auto min_id = this->min_id;
+        const auto max_id = this->max_id;
+        auto it = begin;
+        while (it != end) {
+            auto ts = it->get_timestamp();
+            auto match = pred(it->get_paramid());
+            if (match == SearchQuery::MATCH) {
+                break;
+            } else if (match == skip_group) {
+                // skip to the next timestamp
+                it = gallop_partition_point(it + 1, end, [ts](TimeSeriesValue const& val) {
+                    return val.get_timestamp() == ts;
+                });
+            } else if (match == skip_ids && has_bounds) {
+                // skip to the first param id of interest
+                it = gallop_partition_point(it + 1, end, [=](TimeSeriesValue const& val) {
+                    return val.get_timestamp() == ts && (forward ? val.get_paramid() < min_id
+                                                                 : val.get_paramid() > max_id);
+                });
+            } else {
+                ++it;
+            }
+        }
+        return it;
     }
+};
 
+/** Resumable k-way merge of sorted runs.
+  * Runs are referenced by the merge and should outlive it. Values rejected
+  * by the filter are skipped lazily when the next value of the run is taken.
+  */
+template <int dir, class Filter = MatchAll>
+struct KWayMerge {
+    typedef RunIter<dir> RIter;
+    typedef typename RIter::range_type range_t;
+    typedef TimeSeriesValue KeyType;
     typedef tuple<KeyType, int> HeapItem;
     typedef MergePred<HeapItem, dir> Comp;
     typedef boost::heap::skew_heap<HeapItem, boost::heap::compare<Comp>> Heap;
-    Heap heap;
 
-    int index = 0;
-    for(auto& range: ranges) {
+    std::vector<range_t> ranges_;
+    Heap heap_;
+    Filter filter_;
+
+    //! Merge whole runs
+    KWayMerge(vector<Sequencer::PSortedRun> const& runs, Filter filter = Filter())
+        : filter_(filter)
+    {
+        for(auto const& run: runs) {
+            ranges_.push_back(RIter::make_range(run->begin(), run->end()));
+        }
+        init_();
+    }
+
+    //! Merge parts of the runs
+    KWayMerge(vector<Sequencer::RunView> const& views, Filter filter = Filter())
+        : filter_(filter)
+    {
+        for(auto const& view: views) {
+            ranges_.push_back(RIter::make_range(view.begin, view.end));
+        }
+        init_();
+    }
+
+    void init_() {
+        for(int index = 0; index < static_cast<int>(ranges_.size()); index++) {
+            push_next_(index);
+        }
+    }
+
+    //! Move next accepted value of the range to heap
+    void push_next_(int index) {
+        auto& range = ranges_[index];
+        range = boost::make_iterator_range(filter_.find(range.begin(), range.end()), range.end());
         if (!range.empty()) {
-            KeyType value = range.front();
+            KeyType point = range.front();
             range.advance_begin(1);
-            heap.push(make_tuple(value, index));
+            heap_.push(make_tuple(point, index));
         }
-        index++;
     }
 
-    while(!heap.empty()) {
-        HeapItem item = heap.top();
-        KeyType point = get<0>(item);
-        int index = get<1>(item);
-        if (!cons(point)) {
-            // Interrupted
-            return;
-        }
-        heap.pop();
-        if (!ranges[index].empty()) {
-            KeyType point = ranges[index].front();
-            ranges[index].advance_begin(1);
-            heap.push(make_tuple(point, index));
+    /** Push merged values to consumer until consumer returns false.
+      * Value rejected by consumer is not removed, merge can be resumed
+      * from this value. Returns true if all values are merged.
+      */
+    template<class Consumer>
+    bool run(Consumer& cons) {
+        while(!heap_.empty()) {
+            HeapItem item = heap_.top();
+            KeyType point = get<0>(item);
+            int index = get<1>(item);
+            if (!cons(point)) {
+                // Interrupted
+                return false;
+            }
+            heap_.pop();
+            push_next_(index);
         }
+        return true;
     }
+};
+
+/** Merge sequences and push it to consumer */
+template <int dir, class Consumer>
+void kway_merge(vector<Sequencer::PSortedRun> const& runs, Consumer& cons) {
+    KWayMerge<dir> merge(runs);
+    merge.run(cons);
 }
 
+/** Sequencer search cursor.
+  * Owns views of the sorted runs (runs are shared with sequencer)
+  * and merges them on demand.
+  */
+template <int dir>
+class SequencerCursor : public ExternalCursor {
+    const vector<Sequencer::RunView>        views_;
+    KWayMerge<dir, MatchSeries<dir>>        merge_;
+    PageHeader const*                       page_;
+    bool                                    done_;
+    int                                     error_code_;
+public:
+    SequencerCursor(vector<Sequencer::RunView>&& views, SearchQuery const& query, PageHeader const* page, int error_code)
+        : views_(std::move(views))
+        , merge_(views_, MatchSeries<dir>(query))
+        , page_(page)
+        , done_(error_code != AKU_SUCCESS)
+        , error_code_(error_code)
+    {
+    }
+
+    //! Merge at most `buf_len` values and write them using `write(index, result)`
+    template<class Writer>
+    int read_impl_(Writer const& write, int buf_len) {
+        if (done_) {
+            return 0;
+        }
+        int nread = 0;
+        auto page = page_;
+        auto consumer = [&write, buf_len, &nread, page](TimeSeriesValue const& val) {
+            if (nread == buf_len) {
+                return false;
+            }
+            CursorResult result = {
+                val.value,
+                val.value_length,
+                val.get_timestamp(),
+                val.get_paramid(),
+                page
+            };
+            write(static_cast<size_t>(nread++), result);
+            return true;
+        };
+        done_ = merge_.run(consumer);
+        return nread;
+    }
+
+    virtual int read(CursorResult* buf, int buf_len) {
+        return read_impl_([buf](size_t ix, CursorResult const& result) {
+            buf[ix] = result;
+        }, buf_len);
+    }
+
+    virtual int read_columns(CursorColumns const& columns) {
+        return read_impl_([&columns](size_t ix, CursorResult const& result) {
+            columns.set(ix, result);
+        }, static_cast<int>(columns.size));
+    }
+
+    virtual bool is_done() const {
+        return done_;
+    }
+
+    virtual bool is_error(int* out_error_code_or_null) const {
+        if (out_error_code_or_null) {
+            *out_error_code_or_null = error_code_;
+        }
+        return error_code_ != AKU_SUCCESS;
+    }
+
+    virtual void close() {
+        done_ = true;
+    }
+};
+
 void Sequencer::merge(Caller& caller, InternalCursor* cur) {
     bool owns_lock = sequence_number_.load() % 2;  // progress_flag_ must be odd to start
     if (!owns_lock) {
@@ -348,7 +560,7 @@ void Sequencer::merge(Caller& caller, InternalCursor* cur) {
 
     kway_merge<AKU_CURSOR_DIR_FORWARD>(ready_, consumer);
 
-    ready_.clear();
+    clear_ready_();
     cur->complete(caller);
 
     sequence_number_.fetch_add(1);  // progress_flag_ is even again
@@ -378,19 +590,27 @@ void Sequencer::merge_and_compress(Caller& caller, InternalCursor* cur, PageHead
     };
 
     kway_merge<AKU_CURSOR_DIR_FORWARD>(ready_, consumer);
-    ready_.clear();
 
+    // Ready runs are visible to readers until merged values are in the page
     auto status = target->complete_chunk(chunk_header);
+    clear_ready_();
     if (status != AKU_SUCCESS) {
         cur->set_error(caller, status);
         return;
     }
+    if (rollups_) {
+        rollups_->add_chunk(target, chunk_header, ready_top_);
+    }
+    if (subscriptions_) {
+        subscriptions_->publish(target, chunk_header);
+    }
 
     sequence_number_.fetch_add(1);  // progress_flag_ is even again
 }
 
 std::tuple<aku_TimeStamp, int> Sequencer::get_window() const {
-    return std::make_tuple(top_timestamp_ - window_size_, sequence_number_.load());
+    aku_TimeStamp window = top_timestamp_ > window_size_ ? top_timestamp_ - window_size_ : AKU_MIN_TIMESTAMP;
+    return std::make_tuple(window, sequence_number_.load());
 }
 
 uint32_t Sequencer::get_space_estimate() const {
@@ -398,56 +618,95 @@ uint32_t Sequencer::get_space_estimate() const {
     return space_estimate_ + SPACE_PER_ELEMENT;
 }
 
-struct SearchPredicate {
-    SearchQuery const& query;
-    SearchPredicate(SearchQuery const& q) : query(q) {}
+void Sequencer::clear_ready_() {
+    Lock guard(runs_resize_lock_);
+    ready_.clear();
+}
 
-    bool operator () (TimeSeriesValue const& value) const {
-        if (query.lowerbound <= get<TIMESTMP>(value.key_) &&
-            query.upperbound >= get<TIMESTMP>(value.key_))
-        {
-            if (query.param_pred(get<PARAM_ID>(value.key_)) == SearchQuery::MATCH) {
-                return true;
+void Sequencer::compact_runs_() {
+    // Only writer modifies runs so they can be read without lock. Merged runs
+    // are new objects because old runs can be shared with snapshots. Merged run
+    // replaces adjacent runs and has the largest tail of them so runs stay
+    // sorted by tail.
+    vector<PSortedRun> runs(runs_);
+    while (runs.size() > AKU_SEQUENCER_MAX_RUNS/2) {
+        size_t min_ix = 0u;
+        size_t min_size = ~0ul;
+        for (size_t ix = 0; ix + 1 < runs.size(); ix++) {
+            size_t size = runs[ix]->size() + runs[ix + 1]->size();
+            if (size < min_size) {
+                min_size = size;
+                min_ix = ix;
             }
         }
-        return false;
+        PSortedRun merged(new SortedRun());
+        merged->reserve(min_size);
+        std::merge(runs[min_ix]->begin(), runs[min_ix]->end(),
+                   runs[min_ix + 1]->begin(), runs[min_ix + 1]->end(),
+                   back_inserter(*merged));
+        runs[min_ix] = move(merged);
+        runs.erase(runs.begin() + min_ix + 1);
     }
-};
+    Lock guard(runs_resize_lock_);
+    swap(runs_, runs);
+    n_compactions_++;
+}
 
-void Sequencer::filter(PSortedRun run, SearchQuery const& q, std::vector<PSortedRun>* results) const {
-    if (run->empty()) {
-        return;
+void Sequencer::get_stats(aku_StorageStats* stats) const {
+    stats->n_runs = 0u;
+    std::fill(stats->run_sizes, stats->run_sizes + AKU_RUN_SIZE_HISTOGRAM_SIZE, 0u);
+    Lock guard(runs_resize_lock_);
+    stats->n_compactions = n_compactions_;
+    stats->n_runs = runs_.size();
+    for (auto const& run: runs_) {
+        int bucket = 0;
+        for (size_t size = run->size(); size > 1u && bucket < AKU_RUN_SIZE_HISTOGRAM_SIZE - 1; size >>= 1) {
+            bucket++;
+        }
+        stats->run_sizes[bucket]++;
     }
-    SearchPredicate search_pred(q);
-    PSortedRun result(new SortedRun);
-    auto lkey = TimeSeriesValue(q.lowerbound, 0u, 0u, 0u);
-    auto rkey = TimeSeriesValue(q.upperbound, ~0u, 0u, 0u);
-    auto begin = std::lower_bound(run->begin(), run->end(), lkey);
-    auto end = std::upper_bound(run->begin(), run->end(), rkey);
-    copy_if(begin, end, std::back_inserter(*result), search_pred);
-    results->push_back(move(result));
 }
 
-void Sequencer::search(Caller& caller, InternalCursor* cur, SearchQuery query, int sequence_number) const {
-    int seq_id = sequence_number_.load();
-    if (seq_id % 2 != 0 || sequence_number != seq_id) {
-        cur->set_error(caller, AKU_EBUSY);
-        return;
+Sequencer::Snapshot Sequencer::get_snapshot() const {
+    Snapshot snapshot;
+    Lock guard(runs_resize_lock_);
+    snapshot.page_limit = runs_min_;
+    snapshot.runs = runs_;
+    snapshot.nready = ready_.size();
+    for (auto const& run: ready_) {
+        if (!run->empty()) {
+            snapshot.page_limit = min(snapshot.page_limit, run->front().get_timestamp());
+        }
+        snapshot.runs.push_back(run);
+    }
+    for (auto const& run: snapshot.runs) {
+        snapshot.sizes.push_back(run->size());
     }
-    std::vector<PSortedRun> filtered;
-    std::vector<PSortedRun> pruns;
-    Lock runs_guard(runs_resize_lock_);
-    pruns = runs_;
-    runs_guard.unlock();
-    int run_ix = 0;
-    for (auto const& run: pruns) {
-        auto ix = run_ix & RUN_LOCK_FLAGS_MASK;
-        auto& rwlock = run_locks_.at(ix);
-        rwlock.rdlock();
-        filter(run, query, &filtered);
-        rwlock.unlock();
-        run_ix++;
+    return snapshot;
+}
+
+void Sequencer::filter_runs_(SearchQuery const& query, Snapshot const& snapshot, std::vector<RunView>* results) const {
+    // Values of the snapshot are never moved or modified, runs can be read without locking
+    auto lkey = TimeSeriesValue(query.lowerbound, 0u, 0u, 0u);
+    auto rkey = TimeSeriesValue(query.upperbound, ~0ul, 0u, 0u);
+    for (size_t run_ix = 0; run_ix < snapshot.runs.size(); run_ix++) {
+        auto const& run = snapshot.runs[run_ix];
+        auto run_end = run->begin() + snapshot.sizes[run_ix];
+        auto begin = std::lower_bound(run->begin(), run_end, lkey);
+        auto end = std::upper_bound(begin, run_end, rkey);
+        if (begin != end) {
+            results->push_back({ run, begin, end });
+        }
     }
+}
+
+void Sequencer::search(Caller& caller, InternalCursor* cur, SearchQuery query) const {
+    search(caller, cur, query, get_snapshot());
+}
+
+void Sequencer::search(Caller& caller, InternalCursor* cur, SearchQuery query, Snapshot const& snapshot) const {
+    std::vector<RunView> views;
+    filter_runs_(query, snapshot, &views);
 
     auto page = page_;
     auto consumer = [&caller, cur, page](TimeSeriesValue const& val) {
@@ -462,16 +721,28 @@ void Sequencer::search(Caller& caller, InternalCursor* cur, SearchQuery query, i
     };
 
     if (query.direction == AKU_CURSOR_DIR_FORWARD) {
-        kway_merge<AKU_CURSOR_DIR_FORWARD>(filtered, consumer);
+        KWayMerge<AKU_CURSOR_DIR_FORWARD, MatchSeries<AKU_CURSOR_DIR_FORWARD>> merge(views, query);
+        merge.run(consumer);
     } else {
-        kway_merge<AKU_CURSOR_DIR_BACKWARD>(filtered, consumer);
+        KWayMerge<AKU_CURSOR_DIR_BACKWARD, MatchSeries<AKU_CURSOR_DIR_BACKWARD>> merge(views, query);
+        merge.run(consumer);
     }
+    cur->complete(caller);
+}
 
-    if (seq_id != sequence_number_.load()) {
-        cur->set_error(caller, AKU_EBUSY);
-        return;
+std::unique_ptr<ExternalCursor> Sequencer::search(SearchQuery const& query) const {
+    return search(query, get_snapshot());
+}
+
+std::unique_ptr<ExternalCursor> Sequencer::search(SearchQuery const& query, Snapshot const& snapshot) const {
+    std::vector<RunView> views;
+    filter_runs_(query, snapshot, &views);
+    std::unique_ptr<ExternalCursor> result;
+    if (query.direction == AKU_CURSOR_DIR_FORWARD) {
+        result.reset(new SequencerCursor<AKU_CURSOR_DIR_FORWARD>(std::move(views), query, page_, AKU_SUCCESS));
     } else {
-        cur->complete(caller);
+        result.reset(new SequencerCursor<AKU_CURSOR_DIR_BACKWARD>(std::move(views), query, page_, AKU_SUCCESS));
     }
+    return result;
 }
 }  // namespace Akumuli
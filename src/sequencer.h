@@ -23,6 +23,9 @@
 #pragma once
 #include "page.h"
 #include "cursor.h"
+#include "last_value.h"
+#include "rollup.h"
+#include "subscription.h"
 
 #include <tuple>
 #include <vector>
@@ -61,31 +64,57 @@ struct Sequencer {
     typedef std::mutex                   Mutex;
     typedef std::unique_lock<Mutex>      Lock;
 
-    static const int RUN_LOCK_MAX_BACKOFF = 0x100;
-    static const int RUN_LOCK_BUSY_COUNT = 0xFFF;
-    static const int RUN_LOCK_FLAGS_MASK = 0x0FF;
-    static const int RUN_LOCK_FLAGS_SIZE = 0x100;
+    /** Consistent view of the sequencer data.
+      * Sorted runs are never modified after they leave the list of active runs
+      * (they are split by copying), so snapshot shares them with sequencer and
+      * keeps them alive until the last reader is done. Active runs can only
+      * grow, snapshot contains values that was added before it. Writer never
+      * moves values of the run shared with snapshot (run is copied instead of
+      * reallocation), so snapshot can be searched without locking.
+      */
+    struct Snapshot {
+        std::vector<PSortedRun> runs;       //< Active runs followed by ready runs
+        std::vector<size_t>     sizes;      //< Number of values of every run that belongs to snapshot
+        size_t                  nready;     //< Number of ready runs
+        aku_TimeStamp           page_limit; //< Snapshot values are not older than this, page values with this or
+                                            //< larger timestamp can be not merged yet (AKU_MAX_TIMESTAMP - no limit)
+    };
+
+    //! Part of the sorted run, shares ownership of the run
+    struct RunView {
+        PSortedRun                  run;
+        SortedRun::const_iterator   begin;
+        SortedRun::const_iterator   end;
+    };
 
     std::vector<PSortedRun>      runs_;           //< Active sorted runs
-    std::vector<PSortedRun>      ready_;          //< Ready to merge
+    std::vector<PSortedRun>      ready_;          //< Ready to merge (searchable until merged)
     PSortedRun                   key_;
     const aku_Duration           window_size_;
     const PageHeader* const      page_;
     aku_TimeStamp                top_timestamp_;  //< Largest timestamp ever seen
     uint32_t                     checkpoint_;     //< Last checkpoint timestamp
-    mutable std::atomic_int      sequence_number_;   //< Flag indicates that merge operation is in progress and
-                                                  //< search will return inaccurate results.
+    mutable std::atomic_int      sequence_number_;   //< Flag indicates that merge operation is in progress.
                                                   //< If progress_flag_ is odd - merge is in progress if it is
-                                                  //< even - there is no merge and search will work correctly.
-    mutable Mutex                runs_resize_lock_;
-    mutable std::vector<RWLock>  run_locks_;
+                                                  //< even - there is no merge. Changed on every merge so it
+                                                  //< also identifies state of the page.
+    mutable Mutex                runs_resize_lock_;  //< Protects runs_ and ready_ lists and active runs
     uint32_t                     space_estimate_; //< Space estimate for storing all data
     const size_t                 c_threshold_;    //< Compression threshold
+    LastValueTable* const        last_values_;    //< Last values of the series (can be null)
+    Rollups* const               rollups_;        //< Rollups filled by merge_and_compress (can be null)
+    aku_TimeStamp                ready_top_;      //< All values older than this are in ready_ or merged
+    aku_TimeStamp                runs_min_;       //< Values of runs_ are not older than this (protected by runs_resize_lock_)
+    uint64_t                     n_compactions_;  //< Number of run compactions (protected by runs_resize_lock_)
+    Subscriptions* const         subscriptions_;  //< Receivers of the new samples (can be null)
 
-    Sequencer(PageHeader const* page, aku_Config config);
+    Sequencer(PageHeader const* page, aku_Config config, LastValueTable* last_values = nullptr, Rollups* rollups = nullptr,
+              Subscriptions* subscriptions = nullptr);
 
     /** Add new sample to sequence.
-      * @brief Timestamp of the sample can be out of order.
+      * @brief Timestamp of the sample can be out of order. Accepted sample
+      * is recorded in the last value table and delivered to AKU_SUBSCRIBE_MAY_REORDER
+      * subscribers.
       * @returns error code and flag that indicates whether of not new checkpoint is createf
       */
     std::tuple<int, int> add(TimeSeriesValue const& value);
@@ -94,7 +123,8 @@ struct Sequencer {
     void merge(Caller& caller, InternalCursor* cur);
 
     /** Merge all values (ts, id, offset, length)
-      * and write it to target page.
+      * and write it to target page. Values of the completed chunk are added to rollups
+      * and delivered to AKU_SUBSCRIBE_ORDERED subscribers.
       * caller and cur parameters used for communication with storage (error reporting).
       */
     void merge_and_compress(Caller& caller, InternalCursor* cur, PageHeader* target);
@@ -105,19 +135,32 @@ struct Sequencer {
       */
     int reset();
 
+    /** Take snapshot of the sequencer data.
+      * Never blocks on merge, merge never waits for snapshot readers.
+      */
+    Snapshot get_snapshot() const;
+
     /** Search in sequencer data.
       * @param caller represents caller
       * @param cur search cursor
       * @param query represents search query
-      * @param sequence_number sequence number obtained with get_window function
-      * @note search method follows common pattern used by all methods except sequence_number
-      * parameter. This parameter is used to organize optimistic concurrency control. User must
-      * call get_window fn and get current window and seq-number. This seq-number then passed to
-      * search method. If seq-number is changed between calls to get_window and search - search
-      * will be aborted and AKU_EBUSY.error code will be returned If merge occures during search -
-      * search will be aborted and AKU_EBUSY error code will be returned.
+      * @param snapshot data to search, values that are being merged are included
+      * @note values of the snapshot that was merged to page can be found in page
+      * too, page search should be limited by `snapshot.page_limit`.
+      */
+    void search(Caller& caller, InternalCursor* cur, SearchQuery query, Snapshot const& snapshot) const;
+
+    //! Search in the current snapshot
+    void search(Caller& caller, InternalCursor* cur, SearchQuery query) const;
+
+    /** Create search cursor.
+      * Cursor merges views of the snapshot runs on demand, values that doesn't
+      * match the query are skipped during the merge.
       */
-    void search(Caller& caller, InternalCursor* cur, SearchQuery query, int sequence_number) const;
+    std::unique_ptr<ExternalCursor> search(SearchQuery const& query, Snapshot const& snapshot) const;
+
+    //! Create search cursor for the current snapshot
+    std::unique_ptr<ExternalCursor> search(SearchQuery const& query) const;
 
     std::tuple<aku_TimeStamp, int> get_window() const;
 
@@ -127,6 +170,9 @@ struct Sequencer {
      */
     uint32_t get_space_estimate() const;
 
+    //! Fill run count and run size distribution fields of the storage stats
+    void get_stats(aku_StorageStats* stats) const;
+
 private:
     //! Checkpoint id = ⌊timestamp/window_size⌋
     uint32_t get_checkpoint_(aku_TimeStamp ts) const;
@@ -142,6 +188,15 @@ private:
       */
     std::tuple<int, int> check_timestamp_(aku_TimeStamp ts);
 
-    void filter(PSortedRun run, SearchQuery const& q, std::vector<PSortedRun> *results) const;
+    //! Find parts of the snapshot runs inside the query time range
+    void filter_runs_(SearchQuery const& query, Snapshot const& snapshot, std::vector<RunView>* results) const;
+
+    //! Remove merged runs (values should be in page)
+    void clear_ready_();
+
+    /** Merge small adjacent runs until number of runs is AKU_SEQUENCER_MAX_RUNS/2.
+      * Called by writer when number of runs exceeds AKU_SEQUENCER_MAX_RUNS.
+      */
+    void compact_runs_();
 };
 }
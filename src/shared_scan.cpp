@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <algorithm>
+#include <limits>
+
+#include "shared_scan.h"
+
+namespace Akumuli {
+
+SharedScan::SharedScan(std::vector<SearchQuery const*> const& queries)
+    : queries_(queries)
+    , outputs_(queries.size())
+{
+    // Queries are sorted by direction and lowerbound, queries with
+    // overlapping time ranges are added to the same group.
+    std::vector<size_t> order;
+    for (size_t ix = 0; ix < queries_.size(); ix++) {
+        order.push_back(ix);
+    }
+    std::sort(order.begin(), order.end(), [this](size_t lhs, size_t rhs) {
+        auto const& l = *queries_[lhs];
+        auto const& r = *queries_[rhs];
+        return std::make_pair(l.direction, l.lowerbound) < std::make_pair(r.direction, r.lowerbound);
+    });
+    aku_TimeStamp upperbound = 0u;
+    for (auto ix: order) {
+        auto const& query = *queries_[ix];
+        if (groups_.empty() || queries_[groups_.back().members.front()]->direction != query.direction
+                            || query.lowerbound > upperbound)
+        {
+            groups_.emplace_back();
+            upperbound = query.upperbound;
+        }
+        groups_.back().members.push_back(ix);
+        upperbound = std::max(upperbound, query.upperbound);
+    }
+    for (auto& group: groups_) {
+        combine_(group);
+    }
+}
+
+size_t SharedScan::get_group_count() const {
+    return groups_.size();
+}
+
+void SharedScan::combine_(Group& group) const {
+    auto const& first = *queries_[group.members.front()];
+    aku_TimeStamp lowerbound = first.lowerbound;
+    aku_TimeStamp upperbound = first.upperbound;
+    uint32_t parallelism = first.parallelism;
+    bool listed = true;         // all series of the group are listed
+    bool bounded = true;        // all series of the group are in [min_id, max_id] range
+    aku_ParamId min_id = std::numeric_limits<aku_ParamId>::max();
+    aku_ParamId max_id = 0u;
+    std::vector<aku_ParamId> ids;
+    std::vector<SearchQuery::MatcherFn> preds;
+    for (auto ix: group.members) {
+        auto const& query = *queries_[ix];
+        lowerbound = std::min(lowerbound, query.lowerbound);
+        upperbound = std::max(upperbound, query.upperbound);
+        parallelism = std::max(parallelism, query.parallelism);
+        switch (query.kind) {
+        case SearchQuery::MATCH_SINGLE:
+            ids.push_back(query.param_id);
+            group.by_id[query.param_id].push_back(ix);
+            break;
+        case SearchQuery::MATCH_SET:
+            ids.insert(ids.end(), query.params.begin(), query.params.end());
+            for (auto id: query.params) {
+                group.by_id[id].push_back(ix);
+            }
+            break;
+        case SearchQuery::MATCH_FN:
+            bounded = false;
+            listed = false;
+            group.others.push_back(ix);
+            break;
+        default:
+            listed = false;
+            group.others.push_back(ix);
+            break;
+        };
+        if (query.kind != SearchQuery::MATCH_FN && (query.kind != SearchQuery::MATCH_SET || !query.params.empty())) {
+            min_id = std::min(min_id, query.min_id);
+            max_id = std::max(max_id, query.max_id);
+        }
+        preds.push_back(query.param_pred);
+    }
+    if (listed) {
+        group.query.reset(new SearchQuery(ids, lowerbound, upperbound, first.direction));
+    } else {
+        auto matcher = [preds, bounded, min_id, max_id](aku_ParamId id) {
+            if (bounded && id < min_id) {
+                return SearchQuery::LT_ALL;
+            }
+            if (bounded && id > max_id) {
+                return SearchQuery::GT_ALL;
+            }
+            for (auto const& pred: preds) {
+                if (pred(id) == SearchQuery::MATCH) {
+                    return SearchQuery::MATCH;
+                }
+            }
+            return SearchQuery::NO_MATCH;
+        };
+        group.query.reset(new SearchQuery(matcher, lowerbound, upperbound, first.direction));
+    }
+    group.query->parallelism = parallelism;
+}
+
+aku_Status SharedScan::run(SearchFn const& search, Callback const& callback) {
+    for (auto const& group: groups_) {
+        auto status = run_group_(group, search, callback);
+        if (status != AKU_SUCCESS) {
+            return status;
+        }
+    }
+    return AKU_SUCCESS;
+}
+
+aku_Status SharedScan::run_group_(Group const& group, SearchFn const& search, Callback const& callback) {
+    std::vector<aku_TimeStamp>  timestamps(BATCH_SIZE);
+    std::vector<aku_ParamId>    params(BATCH_SIZE);
+    std::vector<aku_PData>      pointers(BATCH_SIZE);
+    std::vector<uint32_t>       lengths(BATCH_SIZE);
+    CursorColumns columns = { timestamps.data(), params.data(), pointers.data(), lengths.data(), BATCH_SIZE };
+
+    auto route = [&](size_t ix, int row) {
+        auto const& query = *queries_[ix];
+        if (timestamps[row] < query.lowerbound || timestamps[row] > query.upperbound) {
+            return;
+        }
+        auto& out = outputs_[ix];
+        out.timestamps.push_back(timestamps[row]);
+        out.params.push_back(params[row]);
+        out.pointers.push_back(pointers[row]);
+        out.lengths.push_back(lengths[row]);
+    };
+
+    auto cursor = search(*group.query);
+    while (!cursor->is_done()) {
+        int nread = cursor->read_columns(columns);
+        for (int row = 0; row < nread; row++) {
+            auto it = group.by_id.find(params[row]);
+            if (it != group.by_id.end()) {
+                for (auto ix: it->second) {
+                    route(ix, row);
+                }
+            }
+            for (auto ix: group.others) {
+                if (queries_[ix]->param_pred(params[row]) == SearchQuery::MATCH) {
+                    route(ix, row);
+                }
+            }
+        }
+        // Results are delivered batch by batch, order of every query is preserved
+        for (auto ix: group.members) {
+            auto& out = outputs_[ix];
+            if (out.timestamps.empty()) {
+                continue;
+            }
+            CursorColumns batch = { out.timestamps.data(), out.params.data(), out.pointers.data(),
+                                    out.lengths.data(), out.timestamps.size() };
+            callback(ix, batch);
+            out.timestamps.clear();
+            out.params.clear();
+            out.pointers.clear();
+            out.lengths.clear();
+        }
+        int error_code = AKU_SUCCESS;
+        if (cursor->is_error(&error_code)) {
+            cursor->close();
+            return error_code;
+        }
+    }
+    cursor->close();
+    return AKU_SUCCESS;
+}
+
+}  // namespace
@@ -0,0 +1,93 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Shared scans - execution of many queries in a single pass.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "page.h"
+#include "cursor.h"
+
+namespace Akumuli {
+
+/** Shared scan.
+  * Queries with the same direction and overlapping time ranges are grouped,
+  * every group is executed as one search that matches all series of the
+  * group, so every chunk is decoded once per group. Results of the search
+  * are routed to the queries that matches them. Results of every query are
+  * ordered by time in query direction (result order of the query is ignored).
+  */
+class SharedScan {
+public:
+    enum {
+        BATCH_SIZE = 0x1000,    //< number of results read from group cursor at once
+    };
+
+    typedef std::function<std::unique_ptr<ExternalCursor>(SearchQuery const& query)> SearchFn;
+    typedef std::function<void(size_t query_ix, CursorColumns const& results)> Callback;
+
+    /** C-tor
+      * @param queries queries, should outlive the scan
+      */
+    SharedScan(std::vector<SearchQuery const*> const& queries);
+
+    //! Get number of searches that will be executed
+    size_t get_group_count() const;
+
+    /** Execute all queries.
+      * @param search function that creates storage cursor
+      * @param callback receiver of the results, `query_ix` is an index of
+      *        the query in the list passed to c-tor
+      * @return AKU_SUCCESS or error code of the first failed search
+      */
+    aku_Status run(SearchFn const& search, Callback const& callback);
+
+private:
+    //! Queries executed by one search
+    struct Group {
+        std::unique_ptr<SearchQuery>                            query;      //< combined query
+        std::vector<size_t>                                     members;
+        std::unordered_map<aku_ParamId, std::vector<size_t>>   by_id;      //< members that search listed ids
+        std::vector<size_t>                                     others;     //< members that should be checked using predicate
+    };
+
+    //! Output columns of the query
+    struct Output {
+        std::vector<aku_TimeStamp>  timestamps;
+        std::vector<aku_ParamId>    params;
+        std::vector<aku_PData>      pointers;
+        std::vector<uint32_t>       lengths;
+    };
+
+    //! Create combined query of the group
+    void combine_(Group& group) const;
+
+    //! Execute search of the group
+    aku_Status run_group_(Group const& group, SearchFn const& search, Callback const& callback);
+
+    std::vector<SearchQuery const*>     queries_;
+    std::vector<Group>                  groups_;
+    std::vector<Output>                 outputs_;
+};
+
+}  // namespace
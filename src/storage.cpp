@@ -22,6 +22,7 @@
 
 #include <cstdlib>
 #include <cstdarg>
+#include <cstdio>
 #include <stdexcept>
 #include <algorithm>
 #include <new>
@@ -29,6 +30,8 @@
 #include <sstream>
 #include <cassert>
 #include <functional>
+#include <fstream>
+#include <unordered_set>
 #include <sstream>
 
 #include <apr_general.h>
@@ -47,19 +50,30 @@ static apr_status_t create_page_file(const char* file_name, uint32_t page_index,
 //----------------------------------Volume----------------------------------------------
 
 // TODO: remove max_cache_size
-Volume::Volume(const char* file_name, aku_Config const& conf, int tag, aku_logger_cb_t logger)
+Volume::Volume(const char* file_name,
+               aku_Config const& conf,
+               std::shared_ptr<ChunkCache> chunk_cache,
+               std::shared_ptr<LastValueTable> last_values,
+               std::shared_ptr<Rollups> rollups,
+               std::shared_ptr<Subscriptions> subscriptions,
+               int tag,
+               aku_logger_cb_t logger)
     : mmap_(file_name, tag, logger)
     , window_(conf.window_size)
     , max_cache_size_(conf.max_cache_size)
     , file_path_(file_name)
     , config_(conf)
+    , chunk_cache_(chunk_cache)
+    , last_values_(last_values)
+    , rollups_(rollups)
+    , subscriptions_(subscriptions)
     , tag_(tag)
     , logger_(logger)
     , is_temporary_ {0}
 {
     mmap_.panic_if_bad();  // panic if can't mmap volume
     page_ = reinterpret_cast<PageHeader*>(mmap_.get_pointer());
-    cache_.reset(new Sequencer(page_, conf));
+    cache_.reset(new Sequencer(page_, conf, last_values_.get(), rollups_.get(), subscriptions_.get()));
 }
 
 Volume::~Volume() {
@@ -95,14 +109,14 @@ std::shared_ptr<Volume> Volume::safe_realloc() {
         AKU_PANIC("can't create new page file (out of space?)");
     }
 
-    newvol.reset(new Volume(file_path_.c_str(), config_, tag_, logger_));
+    newvol.reset(new Volume(file_path_.c_str(), config_, chunk_cache_, last_values_, rollups_, subscriptions_, tag_, logger_));
     newvol->page_->open_count = open_count;
     newvol->page_->close_count = close_count;
     return newvol;
 }
 
 void Volume::open() {
-    page_->reuse();
+    page_->reuse(config_.page_index);
     mmap_.flush();
 }
 
@@ -117,8 +131,8 @@ void Volume::flush() {
     mmap_.flush(0, sizeof(PageHeader));
 }
 
-void Volume::search(Caller& caller, InternalCursor* cursor, SearchQuery query) const {
-    page_->search(caller, cursor, query);
+std::unique_ptr<ExternalCursor> Volume::search(SearchQuery const& query, PageScanPosition const* resume) const {
+    return page_->search(query, chunk_cache_.get(), resume);
 }
 
 //----------------------------------Storage---------------------------------------------
@@ -209,6 +223,8 @@ Storage::Storage(const char* path, aku_FineTuneParams const& params)
     , logger_(params.logger)
 {
     ttl_= params.max_late_write;
+    // Saved series list ids shouldn't match ids of other instances (checkpoints can outlive storage)
+    next_series_list_ = (static_cast<uint64_t>(rand_()) << 32) | 1u;
 
     VolumeIterator v_iter(path, params.logger);
 
@@ -221,19 +237,129 @@ Storage::Storage(const char* path, aku_FineTuneParams const& params)
     // TODO: convert conf.max_cache_size from bytes
     config_.max_cache_size = v_iter.max_cache_size;
     config_.window_size = v_iter.window_size;
+    config_.page_index = params.page_index;
+
+    if (params.max_chunk_cache_size) {
+        chunk_cache_.reset(new ChunkCache(params.max_chunk_cache_size));
+    }
+
+    if (params.max_result_cache_size) {
+        result_cache_ = std::make_shared<ResultCache>(params.max_result_cache_size);
+    }
+
+    last_values_.reset(new LastValueTable());
+
+    std::vector<aku_Duration> resolutions;
+    for (int i = 0; i < AKU_MAX_ROLLUPS; i++) {
+        if (params.rollup_resolutions[i]) {
+            resolutions.push_back(params.rollup_resolutions[i]);
+        }
+    }
+    if (!resolutions.empty()) {
+        if (!AggregateCursor::is_valid_value_type(params.rollup_value_type)) {
+            open_error_code_ = AKU_EBAD_ARG;
+            return;
+        }
+        auto max_buckets = params.rollup_max_buckets ? params.rollup_max_buckets : AKU_DEFAULT_ROLLUP_MAX_BUCKETS;
+        auto max_size = params.rollup_max_size ? params.rollup_max_size : AKU_DEFAULT_ROLLUP_MAX_SIZE;
+        rollups_.reset(new Rollups(resolutions, params.rollup_value_type, max_buckets, max_size));
+        rollups_path_ = std::string(path) + ".rollups";
+    }
+
+    subscriptions_ = std::make_shared<Subscriptions>();
 
     // create volumes list
     for(auto path: v_iter.volume_names) {
         PVolume vol;
-        vol.reset(new Volume(path.c_str(), config_, tag_, logger_));
+        vol.reset(new Volume(path.c_str(), config_, chunk_cache_, last_values_, rollups_, subscriptions_, tag_, logger_));
         volumes_.push_back(vol);
     }
+    catalog_.reset(new VolumeCatalog(volumes_.size()));
 
     select_active_page();
 
+    auto active_ix = active_volume_index_ % volumes_.size();
+    for (size_t ix = 0; ix < volumes_.size(); ix++) {
+        catalog_->load(ix, volumes_[ix]->get_page()->bbox, ix == active_ix);
+    }
+
+    if (active_page_->count == 0 && active_page_->get_index_kind() != config_.page_index) {
+        // First page of the new storage is opened without configuration
+        active_page_->init_index(config_.page_index);
+    }
+
+    if (rollups_) {
+        // Should be done before prepopulate_cache, values merged by it are added by the sequencer
+        restore_rollups_();
+    }
+
+    // Last value table is filled by the writer and on first read of every series
+    // (select_last searches storage for missing and incomplete entries), so open
+    // doesn't scan the active volume.
     prepopulate_cache(params.max_cache_size);
 }
 
+Storage::~Storage() {
+    if (rollups_ && open_error_code_ == AKU_SUCCESS) {
+        save_rollups_();
+    }
+}
+
+void Storage::restore_rollups_() {
+    std::ifstream stream(rollups_path_, std::ios::binary);
+    if (!stream) {
+        // Rollups was never saved
+        return;
+    }
+    auto status = rollups_->load(stream);
+    if (status != AKU_SUCCESS) {
+        log_message("can't load rollups (configuration changed?), error", static_cast<uint64_t>(status));
+        return;
+    }
+    // Values older than or equal to the watermark are already in rollups,
+    // volumes are searched in time order.
+    auto watermark = rollups_->get_watermark();
+    aku_TimeStamp lowerbound = watermark == AKU_MIN_TIMESTAMP ? AKU_MIN_TIMESTAMP : watermark + 1;
+    std::vector<PVolume> sources;
+    for (auto const& vol: volumes_) {
+        auto const& bbox = vol->page_->bbox;
+        if (bbox.min_timestamp <= bbox.max_timestamp && bbox.max_timestamp >= lowerbound) {
+            sources.push_back(vol);
+        }
+    }
+    std::sort(sources.begin(), sources.end(), [](PVolume const& lhs, PVolume const& rhs) {
+        return lhs->page_->bbox.min_timestamp < rhs->page_->bbox.min_timestamp;
+    });
+    SearchQuery query(0u, AKU_LIMITS_MAX_ID, lowerbound, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    for (auto const& vol: sources) {
+        auto cursor = vol->search(query);
+        status = rollups_->fill(cursor.get());
+        cursor->close();
+        if (status != AKU_SUCCESS) {
+            log_message("can't restore rollups, error", static_cast<uint64_t>(status));
+        }
+    }
+}
+
+void Storage::save_rollups_() {
+    // File is replaced atomically, previous version is used if write fails
+    std::string tmp_path = rollups_path_ + ".tmp";
+    aku_Status status = AKU_EGENERAL;
+    rollups_->wait();
+    {
+        std::ofstream stream(tmp_path, std::ios::binary|std::ios::trunc);
+        if (stream) {
+            status = rollups_->save(stream);
+        }
+    }
+    if (status == AKU_SUCCESS && std::rename(tmp_path.c_str(), rollups_path_.c_str()) != 0) {
+        status = AKU_EGENERAL;
+    }
+    if (status != AKU_SUCCESS) {
+        log_message("can't save rollups, error", static_cast<uint64_t>(status));
+    }
+}
+
 void Storage::select_active_page() {
     // volume with max overwrites_count and max index must be active
     int max_index = -1;
@@ -244,7 +370,11 @@ void Storage::select_active_page() {
             max_overwrites = static_cast<int64_t>(page->open_count);
             max_index = i;
         }
-        prefetch_mem(page->histogram.entries, sizeof(page->histogram.entries));
+        if (page->get_index_kind() == AKU_PAGE_INDEX_LEARNED) {
+            prefetch_mem(page->learned.segments, sizeof(LearnedIndexSegment)*page->learned.size);
+        } else {
+            prefetch_mem(page->histogram.entries, sizeof(page->histogram.entries));
+        }
     }
 
     active_volume_index_ = max_index;
@@ -315,6 +445,14 @@ void Storage::advance_volume_(int local_rev) {
         active_volume_->close();
         log_message("page complete");
 
+        if (rollups_) {
+            // Values of the next volume are lost after it is reused
+            save_rollups_();
+        }
+
+        catalog_->close(active_volume_index_ % volumes_.size(), active_page_->bbox);
+        catalog_->open((active_volume_index_ + 1) % volumes_.size());
+
         // select next page in round robin order
         active_volume_index_++;
         auto last_volume = volumes_[active_volume_index_ % volumes_.size()];
@@ -322,6 +460,10 @@ void Storage::advance_volume_(int local_rev) {
         active_volume_ = volumes_[active_volume_index_ % volumes_.size()];
         active_volume_->open();
         active_page_ = active_volume_->page_;
+        if (result_cache_) {
+            // Results of the previous generation of the page will never be used
+            result_cache_->erase_page(active_page_->page_id);
+        }
 
         auto new_page_id = active_page_->page_id;
         assert(new_page_id != old_page_id);
@@ -348,56 +490,637 @@ void Storage::log_message(const char* message, uint64_t value) {
 
 // Reading
 
-void Storage::search(Caller &caller, InternalCursor *cur, const SearchQuery &query) const {
+//! Volume time range and its cursors
+struct VolumeSource {
+    aku_TimeStamp begin;    //< smallest timestamp that can be returned
+    aku_TimeStamp end;      //< largest timestamp that can be returned
+    size_t first;           //< index of the first cursor
+    size_t count;           //< number of cursors
+};
+
+StorageCursor::StorageCursor(int direction, int sequence_number)
+    : nskip(0u)
+{
+    last.flags = 0u;
+    last.sequence_number = sequence_number;
+    last.series = 0u;
+    last.series_list = 0u;
+    last.timestamp = AKU_MIN_TIMESTAMP;
+    last.nsame = 0u;
+    last.position = PageScanPosition();
+    last.direction = direction;
+}
+
+template<class Timestamp>
+int StorageCursor::skip_(Timestamp const& ts, int nread) {
+    // Results are ordered by timestamp, results with checkpoint timestamp
+    // can only be at the beginning of the first non-empty read.
+    int count = 0;
+    while (nskip && count < nread) {
+        if (ts(count) != last.timestamp) {
+            nskip = 0u;
+            break;
+        }
+        count++;
+        nskip--;
+    }
+    return count;
+}
+
+template<class Timestamp>
+void StorageCursor::track_(Timestamp const& ts, int nread) {
+    if (nread == 0) {
+        return;
+    }
+    aku_TimeStamp top = ts(nread - 1);
+    int nsame = 1;
+    while (nsame < nread && ts(nread - 1 - nsame) == top) {
+        nsame++;
+    }
+    if (nsame == nread && (last.flags & CursorCheckpoint::HAS_RESULTS) && last.timestamp == top) {
+        last.nsame += nsame;
+    } else {
+        last.nsame = nsame;
+    }
+    last.timestamp = top;
+    last.flags = CursorCheckpoint::HAS_RESULTS;
+    if (concat_cursor->get_position(&last.position)) {
+        last.flags |= CursorCheckpoint::HAS_POSITION;
+    }
+}
+
+int StorageCursor::read(CursorResult* buf, int buf_len) {
+    auto ts = [buf](int ix) { return buf[ix].timestamp; };
+    while (true) {
+        int nread = concat_cursor->read(buf, buf_len);
+        int nskipped = skip_(ts, nread);
+        if (nskipped) {
+            std::copy(buf + nskipped, buf + nread, buf);
+            nread -= nskipped;
+        }
+        if (nread == 0 && nskipped != 0 && !concat_cursor->is_done()) {
+            continue;
+        }
+        track_(ts, nread);
+        return nread;
+    }
+}
+
+//! Remove first `count` rows from column
+template<class T>
+static void erase_rows(T* column, int count, int size) {
+    if (column) {
+        std::copy(column + count, column + size, column);
+    }
+}
+
+int StorageCursor::read_columns(CursorColumns const& columns) {
+    CursorColumns cols = columns;
+    if (cols.timestamps == nullptr) {
+        timestamps.resize(cols.size);
+        cols.timestamps = timestamps.data();
+    }
+    auto ts = [&cols](int ix) { return cols.timestamps[ix]; };
+    while (true) {
+        int nread = concat_cursor->read_columns(cols);
+        int nskipped = skip_(ts, nread);
+        if (nskipped) {
+            erase_rows(cols.timestamps, nskipped, nread);
+            erase_rows(cols.params, nskipped, nread);
+            erase_rows(cols.pointers, nskipped, nread);
+            erase_rows(cols.lengths, nskipped, nread);
+            nread -= nskipped;
+        }
+        if (nread == 0 && nskipped != 0 && !concat_cursor->is_done()) {
+            continue;
+        }
+        track_(ts, nread);
+        return nread;
+    }
+}
+
+bool StorageCursor::is_done() const {
+    return concat_cursor->is_done();
+}
+
+bool StorageCursor::is_error(int* out_error_code_or_null) const {
+    return concat_cursor->is_error(out_error_code_or_null);
+}
+
+void StorageCursor::close() {
+    concat_cursor->close();
+}
+
+void StorageCursor::checkpoint(CursorCheckpoint* result) const {
+    *result = last;
+}
+
+SeriesCursor::SeriesCursor(Storage const& storage, SearchQuery const& query, PIdList ids, uint64_t series_list,
+                           CursorCheckpoint const* resume)
+    : StorageCursor(query.direction, 0)
+    , storage(storage)
+    , query(query)
+    , ids(std::move(ids))
+    , series_list(series_list)
+    , current(0u)
+    , has_resume(false)
+    , error_code(AKU_SUCCESS)
+{
+    if (resume && (resume->flags & CursorCheckpoint::HAS_RESULTS)) {
+        has_resume = true;
+        this->resume = *resume;
+        last = *resume;
+        // Series before the checkpointed one was already returned
+        current = std::lower_bound(this->ids->begin(), this->ids->end(), resume->series) - this->ids->begin();
+    }
+    last.series_list = series_list;
+}
+
+template<class Reader>
+int SeriesCursor::read_impl_(Reader const& read) {
+    while (error_code == AKU_SUCCESS && current < ids->size()) {
+        if (!series_cursor) {
+            aku_ParamId id = (*ids)[current];
+            series_query.reset(new SearchQuery(id, query.lowerbound, query.upperbound, query.direction));
+            series_query->parallelism = query.parallelism;
+            if (has_resume && resume.series == id) {
+                // Results before the last returned one are not needed
+                if (query.direction == AKU_CURSOR_DIR_FORWARD) {
+                    series_query->lowerbound = std::max(series_query->lowerbound, resume.timestamp);
+                } else {
+                    series_query->upperbound = std::min(series_query->upperbound, resume.timestamp);
+                }
+                series_cursor = storage.search(*series_query, &resume);
+            } else {
+                series_cursor = storage.search(*series_query);
+            }
+        }
+        int nread = read(series_cursor.get());
+        if (nread) {
+            series_cursor->checkpoint(&last);
+            last.series = (*ids)[current];
+            last.series_list = series_list;
+            return nread;
+        }
+        int series_error = AKU_SUCCESS;
+        if (series_cursor->is_error(&series_error)) {
+            error_code = series_error;
+            break;
+        }
+        if (series_cursor->is_done()) {
+            series_cursor->close();
+            series_cursor.reset();
+            series_query.reset();
+            current++;
+        }
+    }
+    return 0;
+}
+
+int SeriesCursor::read(CursorResult* buf, int buf_len) {
+    return read_impl_([buf, buf_len](StorageCursor* cursor) {
+        return cursor->read(buf, buf_len);
+    });
+}
+
+int SeriesCursor::read_columns(CursorColumns const& columns) {
+    return read_impl_([&columns](StorageCursor* cursor) {
+        return cursor->read_columns(columns);
+    });
+}
+
+bool SeriesCursor::is_done() const {
+    return error_code != AKU_SUCCESS || current == ids->size();
+}
+
+bool SeriesCursor::is_error(int* out_error_code_or_null) const {
+    if (error_code == AKU_SUCCESS) {
+        return false;
+    }
+    if (out_error_code_or_null) {
+        *out_error_code_or_null = error_code;
+    }
+    return true;
+}
+
+void SeriesCursor::close() {
+    if (series_cursor) {
+        series_cursor->close();
+    }
+}
+
+void SeriesCursor::checkpoint(CursorCheckpoint* result) const {
+    *result = last;
+}
+
+aku_Status Storage::get_series(SearchQuery const& query, std::vector<aku_ParamId>* ids) const {
+    ids->clear();
+    if (query.kind == SearchQuery::MATCH_SINGLE) {
+        ids->push_back(query.param_id);
+        return AKU_SUCCESS;
+    }
+    if (query.kind == SearchQuery::MATCH_SET) {
+        *ids = query.params;
+        return AKU_SUCCESS;
+    }
+    // Candidate id range can be much wider than the set of series that has values
+    // in the query range. Series are collected in one pass over the chunk directory
+    // of every volume that may contain them: chunks are filtered by param id bounds
+    // and only param id streams are decoded (timestamps only for the chunks that
+    // cross the query bounds). New values are read from the cache snapshot, it's
+    // taken before the pages are searched like in `search`.
+    std::unordered_set<aku_ParamId> present;
+    auto snapshot = active_volume_->cache_->get_snapshot();
+    if (snapshot.page_limit != static_cast<aku_TimeStamp>(AKU_MAX_TIMESTAMP) &&
+        query.upperbound >= snapshot.page_limit)
+    {
+        auto cursor = active_volume_->cache_->search(query, snapshot);
+        const size_t BUFFER_SIZE = 0x1000;
+        aku_ParamId params[BUFFER_SIZE];
+        CursorColumns columns = {};
+        columns.params = params;
+        columns.size = BUFFER_SIZE;
+        while (!cursor->is_done()) {
+            int nread = cursor->read_columns(columns);
+            present.insert(params, params + nread);
+        }
+        int error = AKU_SUCCESS;
+        bool failed = cursor->is_error(&error);
+        cursor->close();
+        if (failed) {
+            return error;
+        }
+    }
+    for(size_t ix = 0; ix < volumes_.size(); ix++) {
+        auto vol = volumes_[ix];
+        if (vol != this->active_volume_ && !catalog_->may_contain(ix, query)) {
+            // Volume doesn't contain data of interest
+            continue;
+        }
+        auto status = vol->page_->get_series(query, chunk_cache_.get(), &present);
+        if (status != AKU_SUCCESS) {
+            return status;
+        }
+        if (present.size() > AKU_MAX_SERIES_ORDER_IDS) {
+            return AKU_EBAD_ARG;
+        }
+    }
+    if (present.size() > AKU_MAX_SERIES_ORDER_IDS) {
+        return AKU_EBAD_ARG;
+    }
+    ids->assign(present.begin(), present.end());
+    std::sort(ids->begin(), ids->end());
+    return AKU_SUCCESS;
+}
+
+uint64_t Storage::save_series_list_(SeriesCursor::PIdList ids) const {
+    std::lock_guard<std::mutex> guard(series_lists_mutex_);
+    auto id = next_series_list_++;
+    series_lists_[id] = ids;
+    while (series_lists_.size() > AKU_MAX_SAVED_SERIES_LISTS) {
+        // Ids grow monotonically, the first one is the oldest
+        series_lists_.erase(series_lists_.begin());
+    }
+    return id;
+}
+
+SeriesCursor::PIdList Storage::find_series_list_(uint64_t id) const {
+    std::lock_guard<std::mutex> guard(series_lists_mutex_);
+    auto it = series_lists_.find(id);
+    if (it == series_lists_.end()) {
+        return SeriesCursor::PIdList();
+    }
+    return it->second;
+}
+
+std::unique_ptr<StorageCursor> Storage::search(SearchQuery const& query, CursorCheckpoint const* resume) const {
     using namespace std;
-    // Find pages
-    // at this stage of development - simply get all pages :)
-    vector<unique_ptr<ExternalCursor>> cursors;
-    for(auto vol: volumes_) {
-        // Search cache (optional, only for active page)
+    if (query.order == AKU_ORDER_BY_SERIES) {
+        // Cursor resumed from checkpoint uses series list of the previous cursor,
+        // list is searched again only if it was evicted.
+        aku_Status status = AKU_SUCCESS;
+        uint64_t list_id = 0u;
+        SeriesCursor::PIdList ids;
+        if (resume && resume->series_list) {
+            ids = find_series_list_(resume->series_list);
+            list_id = ids ? resume->series_list : 0u;
+        }
+        if (!ids) {
+            vector<aku_ParamId> found;
+            status = get_series(query, &found);
+            ids = make_shared<const vector<aku_ParamId>>(move(found));
+            if (status == AKU_SUCCESS && query.kind != SearchQuery::MATCH_SINGLE
+                                      && query.kind != SearchQuery::MATCH_SET)
+            {
+                // Lists of the single and set queries are taken from the query itself
+                list_id = save_series_list_(ids);
+            }
+        }
+        unique_ptr<SeriesCursor> cursor(new SeriesCursor(*this, query, ids, list_id, resume));
+        cursor->error_code = status;
+        return move(cursor);
+    }
+    int seq_id;
+    tie(ignore, seq_id) = active_volume_->cache_->get_window();
+    unique_ptr<StorageCursor> result(new StorageCursor(query.direction, seq_id));
+    if (resume && (resume->flags & CursorCheckpoint::HAS_RESULTS)) {
+        result->last = *resume;
+        result->last.flags = CursorCheckpoint::HAS_RESULTS;
+        result->last.sequence_number = seq_id;
+        result->nskip = resume->nsame;
+    }
+    auto& cursors = result->cursors;
+    vector<VolumeSource> sources;
+    ResultKey key;
+    for(size_t ix = 0; ix < volumes_.size(); ix++) {
+        auto vol = volumes_[ix];
+        if (vol != this->active_volume_ && !catalog_->may_contain(ix, query)) {
+            // Volume doesn't contain data of interest
+            continue;
+        }
+        auto const& bbox = vol->page_->bbox;
+        VolumeSource source = { bbox.min_timestamp, bbox.max_timestamp, cursors.size(), 0u };
+        SearchQuery const* page_query = &query;
+        // Search cache (only for active page). Values of the snapshot are returned
+        // by the cache cursor only, page search is limited to values merged before
+        // the snapshot, so every value is returned once no matter when the merge
+        // completes. Both cursors are merged in query direction.
         if (vol == this->active_volume_) {
-            aku_TimeStamp window;
-            int seq_id;
-            tie(window, seq_id) = active_volume_->cache_->get_window();
-            if (query.direction == AKU_CURSOR_DIR_BACKWARD &&              // Cache searched only if cursor
-               (query.lowerbound > window || query.upperbound > window))    // direction is backward.
+            auto snapshot = active_volume_->cache_->get_snapshot();
+            // New values can't be older than page_limit
+            source.begin = min(source.begin, snapshot.page_limit);
+            source.end = AKU_MAX_TIMESTAMP;
+            if (snapshot.page_limit != static_cast<aku_TimeStamp>(AKU_MAX_TIMESTAMP) &&
+                query.upperbound >= snapshot.page_limit)
             {
-                auto ccur = CoroCursor::make(&Sequencer::search,            // Cache has optimistic concurrency
-                                             active_volume_->cache_.get(),  // control and can easily return
-                                             query, seq_id);                // AKU_EBUSY, because of that it
-                cursors.push_back(move(ccur));                              // must be searched in a first place.
+                cursors.push_back(active_volume_->cache_->search(query, snapshot));
+                unique_ptr<SearchQuery> limited;
+                if (snapshot.page_limit > query.lowerbound) {
+                    limited.reset(new SearchQuery(query));
+                    limited->upperbound = snapshot.page_limit - 1;
+                }
+                page_query = limited.get();
+                if (limited) {
+                    result->queries.push_back(move(limited));
+                }
             }
         }
-        // Search pages
-        auto pcur = CoroCursor::make(&Volume::search, vol, query);
-        cursors.push_back(move(pcur));
+        // Search pages. Scan of the page is resumed from the checkpoint position
+        // if page wasn't reused and (for the active page) merged with cache.
+        if (page_query == nullptr) {
+            // Everything that page can return is in the cache snapshot
+        } else if (resume && (resume->flags & CursorCheckpoint::HAS_POSITION)
+                   && resume->position.page_id == vol->page_->page_id
+                   && resume->position.open_count == vol->page_->open_count
+                   && (vol != active_volume_ || resume->sequence_number == seq_id))
+        {
+            // Results with checkpoint timestamp that was returned before the
+            // position are filtered by the query bounds.
+            PageScanPosition pos = resume->position;
+            pos.nskip = static_cast<uint32_t>(min<uint64_t>(pos.nskip, resume->nsame));
+            cursors.push_back(vol->search(*page_query, &pos));
+            result->last.flags |= CursorCheckpoint::HAS_POSITION;
+            result->nskip = 0u;
+        } else if (result_cache_ && vol != active_volume_ && ResultCache::make_key(query, vol->page_, &key)) {
+            // Closed volume doesn't change until reuse, its results can be cached
+            cursors.push_back(result_cache_->search(key, vol->page_, [&vol, &query]() {
+                return vol->search(query);
+            }));
+        } else {
+            cursors.push_back(vol->search(*page_query));
+        }
+        result->volumes.push_back(vol);
+        source.begin = max(source.begin, query.lowerbound);
+        source.end = min(source.end, query.upperbound);
+        source.count = cursors.size() - source.first;
+        sources.push_back(source);
     }
 
-    vector<ExternalCursor*> pcursors;
-    transform( cursors.begin(), cursors.end()
-             , back_inserter(pcursors)
-             , [](unique_ptr<ExternalCursor>& v) { return v.get(); });
+    // Volumes are filled in time order and usually doesn't overlap. Cursors
+    // of the non-overlapping volumes are concatenated, cursors of the overlapping
+    // volumes are merged. Volumes with equal boundary timestamps are merged
+    // to preserve order of the values with the same timestamp.
+    sort(sources.begin(), sources.end(), [](VolumeSource const& lhs, VolumeSource const& rhs) {
+        return lhs.begin < rhs.begin;
+    });
+    vector<vector<ExternalCursor*>> groups;
+    for (size_t i = 0; i < sources.size();) {
+        vector<ExternalCursor*> group;
+        aku_TimeStamp group_end = sources[i].end;
+        for (; i < sources.size() && (group.empty() || sources[i].begin <= group_end); i++) {
+            group_end = max(group_end, sources[i].end);
+            for (size_t k = 0; k < sources[i].count; k++) {
+                group.push_back(cursors[sources[i].first + k].get());
+            }
+        }
+        groups.push_back(move(group));
+    }
+    if (query.direction == AKU_CURSOR_DIR_BACKWARD) {
+        reverse(groups.begin(), groups.end());
+    }
+
+    // Parallel execution, volumes are searched by worker threads ahead of the
+    // consumer. Cursors are started in order of consumption.
+    auto& async_cursors = result->async_cursors;
+    if (query.parallelism > 1) {
+        auto task_group = make_shared<TaskGroup>(WorkerPool::get_global(), query.parallelism);
+        for (auto& group: groups) {
+            for (auto& pcur: group) {
+                async_cursors.emplace_back(new AsyncCursor(pcur, task_group));
+                async_cursors.back()->start();
+                pcur = async_cursors.back().get();
+            }
+        }
+    }
+
+    auto& fan_in_cursors = result->fan_in_cursors;
+    auto& pcursors = result->pcursors;
+    for (auto& group: groups) {
+        if (group.size() == 1) {
+            pcursors.push_back(group.front());
+        } else {
+            fan_in_cursors.emplace_back(new FanInCursorCombinator(&group[0], group.size(), query.direction));
+            pcursors.push_back(fan_in_cursors.back().get());
+        }
+    }
+    result->concat_cursor.reset(new ConcatCursor(pcursors.data(), pcursors.size()));
+    return result;
+}
+
+std::unique_ptr<AggregateCursor> Storage::aggregate(SearchQuery const& query, aku_Duration bucket_width, int value_type) const {
+    using namespace std;
+    RollupTable const* rollup = nullptr;
+    if (rollups_ && bucket_width && value_type == rollups_->get_value_type() && query.order == AKU_ORDER_BY_TIME) {
+        rollup = rollups_->find(bucket_width);
+    }
+    aku_TimeStamp begin, end;
+    if (rollup == nullptr || !rollup->get_range(&begin, &end)) {
+        return unique_ptr<AggregateCursor>(new AggregateCursor(search(query), bucket_width, value_type));
+    }
+    // Buckets inside [begin, end) are read from rollup, rest of the query range
+    // is searched in volumes. Rollup buckets must be completely covered by the query.
+    auto align_up = [bucket_width](aku_TimeStamp ts) {
+        return ts % bucket_width ? ts + (bucket_width - ts % bucket_width) : ts;
+    };
+    begin = align_up(max(begin, query.lowerbound));
+    end = end - end % bucket_width;
+    if (query.upperbound != static_cast<aku_TimeStamp>(AKU_MAX_TIMESTAMP)) {
+        aku_TimeStamp upper = query.upperbound + 1;
+        end = min(end, upper - upper % bucket_width);
+    }
+    if (begin >= end) {
+        return unique_ptr<AggregateCursor>(new AggregateCursor(search(query), bucket_width, value_type));
+    }
+    auto search_range = [&](aku_TimeStamp lowerbound, aku_TimeStamp upperbound) {
+        unique_ptr<SearchQuery> part(new SearchQuery(query));
+        part->lowerbound = lowerbound;
+        part->upperbound = upperbound;
+        unique_ptr<AggregateCursor> cursor(new AggregateCursor(search(*part), bucket_width, value_type));
+        cursor->hold(move(part));
+        return cursor;
+    };
+    vector<unique_ptr<AggregateCursor>> parts;
+    if (query.lowerbound < begin) {
+        parts.push_back(search_range(query.lowerbound, begin - 1));
+    }
+    parts.emplace_back(new AggregateCursor(rollup->aggregate(query, begin, end, bucket_width)));
+    if (end <= query.upperbound) {
+        parts.push_back(search_range(end, query.upperbound));
+    }
+    if (query.direction == AKU_CURSOR_DIR_BACKWARD) {
+        reverse(parts.begin(), parts.end());
+    }
+    for (size_t i = 1; i < parts.size(); i++) {
+        parts.front()->append(move(parts[i]));
+    }
+    return move(parts.front());
+}
 
-    assert(pcursors.size());
-    FanInCursorCombinator fan_in_cursor(&pcursors[0], pcursors.size(), query.direction);
+//! Row of the series without values
+static void set_empty_row(size_t ix, aku_ParamId param, CursorColumns const& columns) {
+    if (columns.timestamps) {
+        columns.timestamps[ix] = AKU_MIN_TIMESTAMP;
+    }
+    if (columns.params) {
+        columns.params[ix] = param;
+    }
+    if (columns.pointers) {
+        columns.pointers[ix] = nullptr;
+    }
+    if (columns.lengths) {
+        columns.lengths[ix] = 0u;
+    }
+}
 
-    // TODO: remove excessive copying
-    // to do this I need to pass cur to fan_in_cursor somehow
-    const int results_len = 0x1000;
-    CursorResult results[results_len];
-    while(!fan_in_cursor.is_done()) {
-        int s = fan_in_cursor.read(results, results_len);
-        int err_code = 0;
-        if (fan_in_cursor.is_error(&err_code)) {
-            cur->set_error(caller, err_code);
+aku_Status Storage::select_last(aku_ParamId const* params, size_t n_params, CursorColumns const& columns) const {
+    using namespace std;
+    auto set_row = [&](size_t ix, aku_ParamId param, LastValue const& last) {
+        PageHeader const* page = volumes_.at(last.page_id % volumes_.size())->page_;
+        if (page->page_id != last.page_id || page->open_count != last.open_count) {
+            // Volume was reused, all values of the series was deleted
+            set_empty_row(ix, param, columns);
             return;
         }
-        for (int i = 0; i < s; i++) {
-            cur->put(caller, results[i]);
+        CursorResult result = { last.offset, last.length, last.timestamp, param, page };
+        columns.set(ix, result);
+    };
+    // Rows of the series that should be searched in storage, sorted by id
+    vector<pair<aku_ParamId, size_t>> missing;
+    // Values older than the incomplete entries doesn't need to be searched
+    aku_TimeStamp lowerbound = AKU_MAX_TIMESTAMP;
+    for (size_t ix = 0; ix < n_params; ix++) {
+        LastValue last;
+        switch (last_values_->get(params[ix], &last)) {
+        case LastValueTable::COMPLETE:
+            set_row(ix, params[ix], last);
+            continue;
+        case LastValueTable::EMPTY:
+            set_empty_row(ix, params[ix], columns);
+            continue;
+        case LastValueTable::INCOMPLETE:
+            lowerbound = min(lowerbound, last.timestamp);
+            break;
+        case LastValueTable::MISSING:
+            lowerbound = AKU_MIN_TIMESTAMP;
+            break;
+        };
+        missing.push_back(make_pair(params[ix], ix));
+    }
+    if (missing.empty()) {
+        return AKU_SUCCESS;
+    }
+
+    // Slow path, first value returned by backward search is the last one.
+    // Series outside of the id ranges of all volumes doesn't have any values.
+    // Result of the search is stored in the table so every series is searched once.
+    sort(missing.begin(), missing.end());
+    vector<aku_ParamId> ids;
+    vector<aku_ParamId> empty;
+    for (auto const& item: missing) {
+        if ((!ids.empty() && ids.back() == item.first) || (!empty.empty() && empty.back() == item.first)) {
+            continue;
+        }
+        bool in_range = false;
+        for (auto const& vol: volumes_) {
+            auto const& bbox = vol->page_->bbox;
+            if (bbox.min_id <= item.first && item.first <= bbox.max_id) {
+                in_range = true;
+                break;
+            }
+        }
+        if (in_range) {
+            ids.push_back(item.first);
+        } else {
+            empty.push_back(item.first);
+        }
+    }
+    for (auto id: empty) {
+        last_values_->set_searched(id, nullptr);
+    }
+    int error_code = AKU_SUCCESS;
+    bool error = false;
+    if (!ids.empty()) {
+        vector<bool> found(ids.size(), false);
+        size_t nfound = 0u;
+        SearchQuery query(ids, lowerbound, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_BACKWARD);
+        auto cursor = search(query);
+        const int BUFFER_SIZE = 0x100;
+        CursorResult results[BUFFER_SIZE];
+        while (nfound < ids.size() && !cursor->is_done()) {
+            int n = cursor->read(results, BUFFER_SIZE);
+            for (int i = 0; i < n; i++) {
+                auto const& res = results[i];
+                auto it = lower_bound(ids.begin(), ids.end(), res.param_id);
+                if (it == ids.end() || *it != res.param_id || found[it - ids.begin()]) {
+                    continue;
+                }
+                found[it - ids.begin()] = true;
+                nfound++;
+                LastValue last = { res.timestamp, res.data_offset, res.length, res.page->page_id, res.page->open_count };
+                last_values_->set_searched(res.param_id, &last);
+            }
+        }
+        error = cursor->is_error(&error_code);
+        cursor->close();
+        if (!error) {
+            // Storage doesn't contain values newer than the incomplete entries (or any values)
+            for (size_t i = 0; i < ids.size(); i++) {
+                if (!found[i]) {
+                    last_values_->set_searched(ids[i], nullptr);
+                }
+            }
+        }
+    }
+    for (auto const& item: missing) {
+        LastValue last;
+        auto state = last_values_->get(item.first, &last);
+        if (state == LastValueTable::COMPLETE || state == LastValueTable::INCOMPLETE) {
+            set_row(item.second, item.first, last);
+        } else {
+            set_empty_row(item.second, item.first, columns);
         }
     }
-    fan_in_cursor.close();
-    cur->complete(caller);
+    return error ? error_code : AKU_SUCCESS;
 }
 
 void Storage::get_stats(aku_StorageStats* rcv_stats) {
@@ -416,6 +1139,7 @@ void Storage::get_stats(aku_StorageStats* rcv_stats) {
     rcv_stats->free_space = free_space;
     rcv_stats->used_space = used_space;
     rcv_stats->n_entries = n_entries;
+    active_volume_->cache_->get_stats(rcv_stats);
 }
 
 // Writing
@@ -437,6 +1161,7 @@ aku_Status Storage::write(aku_ParamId param, aku_TimeStamp ts, aku_MemRange data
                         DirectPageSyncCursor cursor(rand_);
                         active_volume_->cache_->merge(caller, &cursor);
                         active_volume_->flush();
+                        catalog_->update(local_rev % volumes_.size(), active_page_->bbox);
                     }
                     return status;
                 }
@@ -460,12 +1185,18 @@ aku_Status Storage::write(aku_ParamId param, aku_TimeStamp ts, aku_MemRange data
                     TimeSeriesValue ts_value(ts, param, active_page_->last_offset, data.length);
                     int merge_lock = 0;
                     std::tie(status, merge_lock) = active_volume_->cache_->add(ts_value);
+                    if (status == AKU_SUCCESS) {
+                        // Bounding box should cover values that is not compressed yet
+                        // (rejected values are not stored and shouldn't extend it)
+                        active_page_->update_bounding_box(param, ts);
+                    }
                     if (merge_lock % 2 == 1) {
                         // Slow path
                         Caller caller;
                         DirectPageSyncCursor cursor(rand_);
                         active_volume_->cache_->merge_and_compress(caller, &cursor,
                                                                    active_volume_->get_page());
+                        catalog_->update(local_rev % volumes_.size(), active_page_->bbox);
                         switch(1) {
                         case 1:
                             // Max durability
@@ -35,6 +35,13 @@
 #include "util.h"
 #include "sequencer.h"
 #include "cursor.h"
+#include "chunk_cache.h"
+#include "result_cache.h"
+#include "last_value.h"
+#include "aggregation.h"
+#include "rollup.h"
+#include "subscription.h"
+#include "volume_catalog.h"
 #include "akumuli_def.h"
 
 namespace Akumuli {
@@ -52,12 +59,23 @@ struct Volume : std::enable_shared_from_this<Volume>
     std::unique_ptr<Sequencer> cache_;
     std::string file_path_;
     const aku_Config& config_;
+    std::shared_ptr<ChunkCache> chunk_cache_;  //< Decoded chunk cache shared by all volumes (can be null)
+    std::shared_ptr<LastValueTable> last_values_;  //< Last values table shared by all volumes (can be null)
+    std::shared_ptr<Rollups> rollups_;  //< Rollups shared by all volumes (can be null)
+    std::shared_ptr<Subscriptions> subscriptions_;  //< Subscriptions shared by all volumes
     const int tag_;
     aku_logger_cb_t logger_;
     std::atomic_bool is_temporary_;  //< True if this is temporary volume and underlying file should be deleted
 
     //! Create new volume stored in file
-    Volume(const char* file_path, const aku_Config &conf, int tag, aku_logger_cb_t logger);
+    Volume(const char* file_path,
+           const aku_Config &conf,
+           std::shared_ptr<ChunkCache> chunk_cache,
+           std::shared_ptr<LastValueTable> last_values,
+           std::shared_ptr<Rollups> rollups,
+           std::shared_ptr<Subscriptions> subscriptions,
+           int tag,
+           aku_logger_cb_t logger);
 
     ~Volume();
 
@@ -76,8 +94,109 @@ struct Volume : std::enable_shared_from_this<Volume>
     //! Flush page
     void flush();
 
-    //! Search volume page (not cache)
-    void search(Caller& caller, InternalCursor* cursor, SearchQuery query) const;
+    //! Create cursor that searches volume page (not cache), scan can be resumed from `resume` position
+    std::unique_ptr<ExternalCursor> search(SearchQuery const& query, PageScanPosition const* resume=nullptr) const;
+};
+
+
+/** Cursor checkpoint.
+  * Describes last result returned by the storage cursor and position of the
+  * page scan that produced it. Search can be resumed from this point.
+  */
+struct CursorCheckpoint {
+    enum {
+        HAS_RESULTS = 1,    //< cursor returned some results
+        HAS_POSITION = 2,   //< position of the page scan is known
+    };
+    uint32_t            flags;
+    int                 sequence_number;    //< sequence number of the active volume cache
+    aku_ParamId         series;             //< series of the last returned result (series order only)
+    uint64_t            series_list;        //< id of the saved series list (series order only, 0 - not saved)
+    aku_TimeStamp       timestamp;          //< timestamp of the last returned result
+    uint64_t            nsame;              //< number of returned results with the same timestamp
+    PageScanPosition    position;
+    int                 direction;
+};
+
+
+/** Storage search cursor.
+  * Owns cursors of all volumes that should be searched and reads
+  * them through fan-in and concatenating cursors.
+  */
+struct StorageCursor : ExternalCursor {
+    std::vector<std::shared_ptr<Volume>>            volumes;        //< Searched volumes (kept alive by cursor)
+    std::vector<std::unique_ptr<SearchQuery>>       queries;        //< Narrowed queries used by volume cursors
+    std::vector<std::unique_ptr<ExternalCursor>>    cursors;        //< Volume and cache cursors
+    std::vector<std::unique_ptr<AsyncCursor>>       async_cursors;
+    std::vector<std::unique_ptr<ExternalCursor>>    fan_in_cursors;
+    std::vector<ExternalCursor*>                    pcursors;       //< Cursors in output order
+    std::unique_ptr<ConcatCursor>                   concat_cursor;
+    CursorCheckpoint                                last;           //< Checkpoint after the last read
+    uint64_t                                        nskip;          //< Number of results with `last.timestamp` to skip
+    std::vector<aku_TimeStamp>                      timestamps;     //< Used if user doesn't read timestamps
+
+    StorageCursor(int direction, int sequence_number);
+
+    virtual int read(CursorResult* buf, int buf_len);
+    virtual int read_columns(CursorColumns const& columns);
+    virtual bool is_done() const;
+    virtual bool is_error(int* out_error_code_or_null) const;
+    virtual void close();
+
+    //! Get checkpoint after the last read
+    virtual void checkpoint(CursorCheckpoint* result) const;
+
+private:
+    //! Count leading results that was returned before the checkpoint (`ts(i)` returns timestamp of the result `i`)
+    template<class Timestamp>
+    int skip_(Timestamp const& ts, int nread);
+
+    //! Update checkpoint using returned results
+    template<class Timestamp>
+    void track_(Timestamp const& ts, int nread);
+};
+
+struct Storage;
+
+/** Series order cursor.
+  * Searches series one by one in ascending id order, every series
+  * is searched by its own storage cursor created on demand (page scan
+  * of the series skips chunks whose param id bounds exclude the series).
+  * Results of each series are ordered by time in query direction.
+  */
+struct SeriesCursor : StorageCursor {
+    typedef std::shared_ptr<const std::vector<aku_ParamId>> PIdList;
+
+    Storage const&                  storage;
+    SearchQuery const&              query;
+    PIdList                         ids;            //< Candidate series in output order
+    uint64_t                        series_list;    //< Id of the saved series list (0 if not saved)
+    size_t                          current;        //< Index of the current series
+    std::unique_ptr<SearchQuery>    series_query;   //< Query of the current series
+    std::unique_ptr<StorageCursor>  series_cursor;  //< Cursor of the current series
+    bool                            has_resume;
+    CursorCheckpoint                resume;         //< Checkpoint of the previous cursor
+    int                             error_code;
+
+    /** C-tor
+      * @param ids candidate series (sorted)
+      * @param series_list id of the saved series list, stored in checkpoint
+      * @param resume checkpoint of the previous cursor (optional)
+      */
+    SeriesCursor(Storage const& storage, SearchQuery const& query, PIdList ids, uint64_t series_list,
+                 CursorCheckpoint const* resume);
+
+    virtual int read(CursorResult* buf, int buf_len);
+    virtual int read_columns(CursorColumns const& columns);
+    virtual bool is_done() const;
+    virtual bool is_error(int* out_error_code_or_null) const;
+    virtual void close();
+    virtual void checkpoint(CursorCheckpoint* result) const;
+
+private:
+    //! Read current series using `read(cursor)`, open next series if current one is done
+    template<class Reader>
+    int read_impl_(Reader const& read);
 };
 
 /** Interface to page manager
@@ -97,6 +216,19 @@ struct Storage
     bool                      compression;                //< Compression enabled
     aku_Status                open_error_code_;           //< Open op-n error code
     std::vector<PVolume>      volumes_;                   //< List of all volumes
+    std::shared_ptr<ChunkCache> chunk_cache_;             //< Decoded chunk cache (can be null)
+    std::shared_ptr<ResultCache> result_cache_;           //< Search results of closed volumes (can be null)
+    std::unique_ptr<VolumeCatalog> catalog_;              //< Volume bounds
+    std::shared_ptr<LastValueTable> last_values_;         //< Last value of every series
+    std::shared_ptr<Rollups>  rollups_;                   //< Downsampled data (can be null)
+    std::string               rollups_path_;              //< File of the saved rollups
+    std::shared_ptr<Subscriptions> subscriptions_;        //< Receivers of the new samples
+
+    // Series lists of the series order cursors, cursor resumed from checkpoint
+    // reuses the list instead of searching series again
+    mutable std::mutex        series_lists_mutex_;
+    mutable std::map<uint64_t, SeriesCursor::PIdList> series_lists_;
+    mutable uint64_t          next_series_list_;          //< Id of the next saved list (random base, 0 is not used)
 
     LockType                  mutex_;                     //< Storage lock (used by worker thread)
 
@@ -110,12 +242,23 @@ struct Storage
       */
     Storage(const char *path, aku_FineTuneParams const& conf);
 
+    //! D-tor, saves rollups
+    ~Storage();
+
     //! Select page that was active last time
     void select_active_page();
 
     //! Prepopulate cache
     void prepopulate_cache(int64_t max_cache_size);
 
+    /** Load saved rollups and add values that was merged after the rollups
+      * was saved (e.g. if storage wasn't closed properly).
+      */
+    void restore_rollups_();
+
+    //! Save rollups, called before the oldest volume is overwritten and on close
+    void save_rollups_();
+
     void log_message(const char* message);
 
     void log_message(const char* message, uint64_t value);
@@ -132,8 +275,45 @@ struct Storage
 
     // Reading
 
-    //! Search storage using cursor
-    void search(Caller &caller, InternalCursor *cur, SearchQuery const& query) const;
+    /** Create cursor that searches storage, query should outlive the cursor.
+      * @param resume checkpoint of the previous cursor (optional), query bounds
+      *        should be already narrowed to the checkpoint timestamp (if results
+      *        are ordered by time)
+      */
+    std::unique_ptr<StorageCursor> search(SearchQuery const& query, CursorCheckpoint const* resume=nullptr) const;
+
+    /** Get ids of the series that match the query in ascending order (range and predicate
+      * queries return only series that have values in the query time range). Series are
+      * collected from param id streams of the chunks (see PageHeader::get_series) and from
+      * the cache snapshot, values are not decoded.
+      */
+    aku_Status get_series(SearchQuery const& query, std::vector<aku_ParamId>* ids) const;
+
+    //! Save series list of the series order cursor, returns id of the list
+    uint64_t save_series_list_(SeriesCursor::PIdList ids) const;
+
+    //! Find saved series list, returns empty pointer if list was evicted (or saved by other instance)
+    SeriesCursor::PIdList find_series_list_(uint64_t id) const;
+
+    /** Create cursor that aggregates values of the series inside time buckets,
+      * query should outlive the cursor. Buckets that are completely covered by
+      * the suitable rollup are read from rollup instead of volumes.
+      * @param bucket_width width of the time bucket
+      * @param value_type value type (one of the AKU_VALUE_* constants)
+      */
+    std::unique_ptr<AggregateCursor> aggregate(SearchQuery const& query, aku_Duration bucket_width, int value_type) const;
+
+    /** Read last values of the series.
+      * Values are taken from the last value table. Series that is not in the
+      * table or has incomplete entry (e.g. its last value was written before
+      * the storage was opened) is searched in storage once, result of the
+      * search (including absence of values) is stored in the table. Row of
+      * the series without values contains null pointer and zero timestamp and length.
+      * @param params series ids
+      * @param n_params number of series
+      * @param columns output columns, row `i` corresponds to `params[i]`
+      */
+    aku_Status select_last(aku_ParamId const* params, size_t n_params, CursorColumns const& columns) const;
 
     // Static interface
 
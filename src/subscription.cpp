@@ -0,0 +1,154 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "subscription.h"
+
+namespace Akumuli {
+
+Subscription::Subscription(std::unique_ptr<SearchQuery> query, int mode, size_t capacity)
+    : query_(std::move(query))
+    , mode_(mode)
+    , ring_(std::max(capacity, size_t(1u)))
+    , head_(0u)
+    , size_(0u)
+    , dropped_ {0u}
+{
+}
+
+int Subscription::get_mode() const {
+    return mode_;
+}
+
+bool Subscription::matches(aku_ParamId param_id, aku_TimeStamp timestamp) const {
+    return timestamp >= query_->lowerbound
+        && timestamp <= query_->upperbound
+        && query_->param_pred(param_id) == SearchQuery::MATCH;
+}
+
+void Subscription::push(aku_TimeStamp timestamp, aku_ParamId param_id, const void* data, uint32_t length) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (size_ == ring_.size()) {
+        dropped_++;
+        return;
+    }
+    auto& slot = ring_[(head_ + size_) % ring_.size()];
+    slot.timestamp = timestamp;
+    slot.param_id = param_id;
+    slot.value.assign(static_cast<const char*>(data), length);
+    size_++;
+}
+
+int Subscription::read(CursorColumns const& columns) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    size_t n = std::min(size_, columns.size);
+    if (out_.size() < n) {
+        out_.resize(n);
+    }
+    for (size_t i = 0; i < n; i++) {
+        auto& slot = ring_[head_];
+        // swap keeps allocated buffers in both vectors
+        std::swap(out_[i], slot);
+        if (columns.timestamps) {
+            columns.timestamps[i] = out_[i].timestamp;
+        }
+        if (columns.params) {
+            columns.params[i] = out_[i].param_id;
+        }
+        if (columns.pointers) {
+            columns.pointers[i] = out_[i].value.data();
+        }
+        if (columns.lengths) {
+            columns.lengths[i] = static_cast<uint32_t>(out_[i].value.size());
+        }
+        head_ = (head_ + 1) % ring_.size();
+    }
+    size_ -= n;
+    return static_cast<int>(n);
+}
+
+uint64_t Subscription::get_dropped() const {
+    return dropped_.load();
+}
+
+
+Subscriptions::Subscriptions()
+    : list_(std::make_shared<const List>())
+    , counts_ {{0}, {0}}
+{
+}
+
+Subscriptions::PList Subscriptions::get_list_() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return list_;
+}
+
+void Subscriptions::add(PSubscription subscription) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto list = std::make_shared<List>(*list_);
+    list->push_back(subscription);
+    list_ = list;
+    counts_[subscription->get_mode()]++;
+}
+
+void Subscriptions::remove(PSubscription subscription) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto list = std::make_shared<List>(*list_);
+    auto it = std::find(list->begin(), list->end(), subscription);
+    if (it == list->end()) {
+        return;
+    }
+    list->erase(it);
+    list_ = list;
+    counts_[subscription->get_mode()]--;
+}
+
+void Subscriptions::publish(PageHeader const* page, aku_TimeStamp timestamp, aku_ParamId param_id,
+                            aku_EntryOffset offset, uint32_t length)
+{
+    if (counts_[AKU_SUBSCRIBE_MAY_REORDER].load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    auto list = get_list_();
+    for (auto const& sub: *list) {
+        if (sub->get_mode() == AKU_SUBSCRIBE_MAY_REORDER && sub->matches(param_id, timestamp)) {
+            sub->push(timestamp, param_id, page->read_entry_data(offset), length);
+        }
+    }
+}
+
+void Subscriptions::publish(PageHeader const* page, ChunkHeader const& chunk) {
+    if (counts_[AKU_SUBSCRIBE_ORDERED].load(std::memory_order_relaxed) == 0) {
+        return;
+    }
+    auto list = get_list_();
+    for (auto const& sub: *list) {
+        if (sub->get_mode() != AKU_SUBSCRIBE_ORDERED) {
+            continue;
+        }
+        for (size_t i = 0; i < chunk.timestamps.size(); i++) {
+            if (sub->matches(chunk.paramids[i], chunk.timestamps[i])) {
+                sub->push(chunk.timestamps[i], chunk.paramids[i],
+                          page->read_entry_data(chunk.offsets[i]), chunk.lengths[i]);
+            }
+        }
+    }
+}
+
+}  // namespace
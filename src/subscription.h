@@ -0,0 +1,118 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Live subscriptions to the newly written samples.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "page.h"
+#include "cursor.h"
+
+namespace Akumuli {
+
+/** Subscription.
+  * Receives samples that matches the query (series and time range) and stores
+  * them in the bounded ring buffer until they are read. Samples are copied so
+  * they stay valid when the page is reused. Writer never blocks, new samples are
+  * dropped (and counted) if the ring buffer is full.
+  */
+class Subscription {
+public:
+    /** C-tor
+      * @param query series and time range of interest (direction and order are ignored)
+      * @param mode AKU_SUBSCRIBE_ORDERED or AKU_SUBSCRIBE_MAY_REORDER
+      * @param capacity max number of samples in ring buffer
+      */
+    Subscription(std::unique_ptr<SearchQuery> query, int mode, size_t capacity);
+
+    //! Get subscription mode
+    int get_mode() const;
+
+    //! Check if sample should be delivered
+    bool matches(aku_ParamId param_id, aku_TimeStamp timestamp) const;
+
+    //! Add sample to ring buffer (called by writer)
+    void push(aku_TimeStamp timestamp, aku_ParamId param_id, const void* data, uint32_t length);
+
+    /** Read samples in order of arrival.
+      * Pointers are valid until the next call.
+      * @return number of samples
+      */
+    int read(CursorColumns const& columns);
+
+    //! Number of samples that was dropped because of the ring buffer overflow
+    uint64_t get_dropped() const;
+
+private:
+    struct Slot {
+        aku_TimeStamp   timestamp;
+        aku_ParamId     param_id;
+        std::string     value;      //< reused between samples
+    };
+
+    std::unique_ptr<SearchQuery>    query_;
+    const int                       mode_;
+    std::mutex                      mutex_;
+    std::vector<Slot>               ring_;
+    size_t                          head_;      //< index of the oldest sample
+    size_t                          size_;      //< number of samples in ring buffer
+    std::vector<Slot>               out_;       //< samples returned by last read
+    std::atomic<uint64_t>           dropped_;
+};
+
+
+/** Subscriptions of the storage.
+  * Shared by all volumes. List of subscribers is replaced on every change
+  * so publishers doesn't hold the lock while samples are delivered.
+  */
+class Subscriptions {
+public:
+    typedef std::shared_ptr<Subscription> PSubscription;
+
+    Subscriptions();
+
+    void add(PSubscription subscription);
+
+    void remove(PSubscription subscription);
+
+    //! Deliver sample accepted by sequencer to AKU_SUBSCRIBE_MAY_REORDER subscribers
+    void publish(PageHeader const* page, aku_TimeStamp timestamp, aku_ParamId param_id,
+                 aku_EntryOffset offset, uint32_t length);
+
+    //! Deliver merged chunk to AKU_SUBSCRIBE_ORDERED subscribers
+    void publish(PageHeader const* page, ChunkHeader const& chunk);
+
+private:
+    typedef std::vector<PSubscription>          List;
+    typedef std::shared_ptr<const List>         PList;
+
+    //! Get current list of subscribers
+    PList get_list_() const;
+
+    mutable std::mutex      mutex_;
+    PList                   list_;
+    std::atomic<int>        counts_[2];     //< number of subscribers of every mode (checked without lock)
+};
+
+}  // namespace
@@ -0,0 +1,107 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <limits>
+
+#include "volume_catalog.h"
+
+namespace Akumuli {
+
+typedef std::lock_guard<std::mutex> Lock;
+
+VolumeCatalog::Entry::Entry()
+    : min_timestamp(AKU_MAX_TIMESTAMP)
+    , max_timestamp(AKU_MIN_TIMESTAMP)
+    , min_id(std::numeric_limits<aku_ParamId>::max())
+    , max_id(0u)
+    , ids_known(false)
+    , is_open(false)
+{
+}
+
+VolumeCatalog::VolumeCatalog(size_t nvolumes)
+    : entries_(nvolumes)
+{
+}
+
+void VolumeCatalog::load(int ix, PageBoundingBox const& bbox, bool is_open) {
+    Lock guard(mutex_);
+    auto& entry = entries_.at(ix);
+    entry.min_timestamp = bbox.min_timestamp;
+    entry.max_timestamp = bbox.max_timestamp;
+    entry.ids_known = false;
+    entry.is_open = is_open;
+}
+
+void VolumeCatalog::open(int ix) {
+    Lock guard(mutex_);
+    auto& entry = entries_.at(ix);
+    entry = Entry();
+    entry.ids_known = true;
+    entry.is_open = true;
+}
+
+void VolumeCatalog::update(int ix, PageBoundingBox const& bbox) {
+    Lock guard(mutex_);
+    auto& entry = entries_.at(ix);
+    entry.min_timestamp = bbox.min_timestamp;
+    entry.max_timestamp = bbox.max_timestamp;
+    entry.min_id = bbox.min_id;
+    entry.max_id = bbox.max_id;
+}
+
+void VolumeCatalog::close(int ix, PageBoundingBox const& bbox) {
+    Lock guard(mutex_);
+    auto& entry = entries_.at(ix);
+    entry.min_timestamp = bbox.min_timestamp;
+    entry.max_timestamp = bbox.max_timestamp;
+    entry.min_id = bbox.min_id;
+    entry.max_id = bbox.max_id;
+    entry.is_open = false;
+}
+
+bool VolumeCatalog::may_contain(int ix, SearchQuery const& query) const {
+    Entry entry = get(ix);
+    if (entry.is_open) {
+        return true;
+    }
+    if (entry.min_timestamp > entry.max_timestamp) {
+        // empty volume
+        return false;
+    }
+    if (query.upperbound < entry.min_timestamp || query.lowerbound > entry.max_timestamp) {
+        return false;
+    }
+    if (entry.ids_known && query.kind != SearchQuery::MATCH_FN) {
+        if (query.kind == SearchQuery::MATCH_SET && query.params.empty()) {
+            // empty set of parameters
+            return false;
+        }
+        if (query.max_id < entry.min_id || query.min_id > entry.max_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VolumeCatalog::Entry VolumeCatalog::get(int ix) const {
+    Lock guard(mutex_);
+    return entries_.at(ix);
+}
+
+}  // namespace
@@ -0,0 +1,82 @@
+/**
+ * PRIVATE HEADER
+ *
+ * In-memory catalog of volume bounds.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <mutex>
+#include <vector>
+
+#include "page.h"
+
+namespace Akumuli {
+
+/** Time and param id bounds of the storage volumes.
+  * Catalog is used to skip volumes that can't contain data of interest.
+  * Volume that is open for writing is always searched because part of
+  * its data can be stored in sequencer.
+  */
+class VolumeCatalog {
+public:
+    struct Entry {
+        aku_TimeStamp   min_timestamp;
+        aku_TimeStamp   max_timestamp;
+        aku_ParamId     min_id;
+        aku_ParamId     max_id;
+        bool            ids_known;  //< param id bounds are valid
+        bool            is_open;    //< volume is open for writing
+
+        Entry();
+    };
+
+    /** C-tor
+      * @param nvolumes number of volumes
+      */
+    VolumeCatalog(size_t nvolumes);
+
+    /** Set bounds of the existing volume.
+      * Param ids of the chunks are not stored in the page bounding box
+      * correctly by older versions so only time bounds are used.
+      * @param ix volume index
+      * @param bbox page bounding box
+      * @param is_open true if volume is open for writing
+      */
+    void load(int ix, PageBoundingBox const& bbox, bool is_open);
+
+    //! Mark volume as reopened for writing, all previous data is discarded
+    void open(int ix);
+
+    //! Update bounds of the volume (called on chunk completion)
+    void update(int ix, PageBoundingBox const& bbox);
+
+    //! Update bounds of the volume and mark it as read-only
+    void close(int ix, PageBoundingBox const& bbox);
+
+    //! Check if volume can contain data of interest
+    bool may_contain(int ix, SearchQuery const& query) const;
+
+    //! Get entry copy
+    Entry get(int ix) const;
+
+private:
+    mutable std::mutex  mutex_;
+    std::vector<Entry>  entries_;
+};
+
+}  // namespace
@@ -0,0 +1,115 @@
+/**
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+
+#include <algorithm>
+
+#include "worker_pool.h"
+
+namespace Akumuli {
+
+typedef std::unique_lock<std::mutex> Lock;
+
+WorkerPool::WorkerPool(size_t nthreads)
+    : stop_(false)
+{
+    for (size_t i = 0; i < nthreads; i++) {
+        threads_.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        Lock guard(mutex_);
+        stop_ = true;
+    }
+    cond_.notify_all();
+    for (auto& thread: threads_) {
+        thread.join();
+    }
+}
+
+void WorkerPool::submit(Task task) {
+    {
+        Lock guard(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+    cond_.notify_one();
+}
+
+size_t WorkerPool::size() const {
+    return threads_.size();
+}
+
+void WorkerPool::run() {
+    while (true) {
+        Task task;
+        {
+            Lock guard(mutex_);
+            cond_.wait(guard, [this]() { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                // stop_ is set and all tasks are done
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+WorkerPool& WorkerPool::get_global() {
+    static WorkerPool pool(std::max(2u, std::thread::hardware_concurrency()));
+    return pool;
+}
+
+// TaskGroup
+
+TaskGroup::TaskGroup(WorkerPool& pool, size_t max_parallelism)
+    : pool_(pool)
+    , max_parallelism_(std::max(max_parallelism, size_t(1)))
+    , running_(0u)
+{
+}
+
+void TaskGroup::submit(Task task) {
+    Lock guard(mutex_);
+    if (running_ == max_parallelism_) {
+        pending_.push_back(std::move(task));
+        return;
+    }
+    running_++;
+    guard.unlock();
+    auto self = shared_from_this();
+    pool_.submit([self, task]() { self->run(task); });
+}
+
+void TaskGroup::run(Task task) {
+    while (true) {
+        task();
+        // Execute next pending task in the same thread
+        Lock guard(mutex_);
+        if (pending_.empty()) {
+            running_--;
+            return;
+        }
+        task = std::move(pending_.front());
+        pending_.pop_front();
+    }
+}
+
+}  // namespace
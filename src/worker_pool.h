@@ -0,0 +1,96 @@
+/**
+ * PRIVATE HEADER
+ *
+ * Worker thread pool used to execute queries.
+ *
+ * Copyright (c) 2013 Eugene Lazin <4lazin@gmail.com>
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Akumuli {
+
+/** Fixed size thread pool.
+  * Tasks should never block waiting for other tasks.
+  */
+class WorkerPool {
+public:
+    typedef std::function<void()> Task;
+
+    /** C-tor
+      * @param nthreads number of worker threads
+      */
+    WorkerPool(size_t nthreads);
+
+    //! D-tor, waits for all threads to complete
+    ~WorkerPool();
+
+    //! Add task to queue
+    void submit(Task task);
+
+    //! Get number of threads
+    size_t size() const;
+
+    //! Library owned pool with one thread per core
+    static WorkerPool& get_global();
+
+private:
+    void run();
+
+    std::mutex                  mutex_;
+    std::condition_variable     cond_;
+    std::deque<Task>            tasks_;
+    std::vector<std::thread>    threads_;
+    bool                        stop_;
+};
+
+
+/** Group of tasks executed by the worker pool.
+  * Limits number of tasks of the group that can be executed
+  * concurrently, other tasks are waiting in the group's queue.
+  * Should be created using std::make_shared.
+  */
+class TaskGroup : public std::enable_shared_from_this<TaskGroup> {
+public:
+    typedef WorkerPool::Task Task;
+
+    /** C-tor
+      * @param pool worker pool
+      * @param max_parallelism max number of concurrently executed tasks
+      */
+    TaskGroup(WorkerPool& pool, size_t max_parallelism);
+
+    //! Add task to group
+    void submit(Task task);
+
+private:
+    void run(Task task);
+
+    WorkerPool&         pool_;
+    const size_t        max_parallelism_;
+    std::mutex          mutex_;
+    std::deque<Task>    pending_;       //< tasks waiting for execution
+    size_t              running_;       //< number of submitted tasks
+};
+
+}  // namespace
@@ -0,0 +1,170 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include <boost/timer.hpp>
+
+#include "akumuli.h"
+#include "page.h"
+#include "cursor.h"
+#include "selection.h"
+#include "matchers.h"
+
+using namespace Akumuli;
+
+const uint32_t NUM_ROWS = 1000*1000;
+const uint32_t NUM_PARAMS = 100;
+const int NUM_ITERATIONS = 20;
+
+static ChunkHeader make_chunk() {
+    ChunkHeader chunk;
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        chunk.timestamps.push_back(1000u + i / NUM_PARAMS);
+        chunk.paramids.push_back(i % NUM_PARAMS);
+        chunk.offsets.push_back(i);
+        chunk.lengths.push_back(8u);
+    }
+    return chunk;
+}
+
+//! Row at a time evaluation using std::function (reference)
+static size_t scan_rows(ChunkHeader const& chunk, SearchQuery const& query, RecordingCursor* cursor) {
+    Caller caller;
+    for (uint32_t i = 0; i < NUM_ROWS; i++) {
+        bool in_range = query.lowerbound <= chunk.timestamps[i] && query.upperbound >= chunk.timestamps[i];
+        if (in_range && query.param_pred(chunk.paramids[i]) == SearchQuery::MATCH) {
+            CursorResult result = {
+                chunk.offsets[i],
+                chunk.lengths[i],
+                chunk.timestamps[i],
+                chunk.paramids[i],
+                nullptr
+            };
+            cursor->put(caller, result);
+        }
+    }
+    return cursor->results.size();
+}
+
+//! Selection vector evaluation
+template<bool UseHints>
+struct SelectionScan {
+    ChunkHeader const& chunk;
+    SearchQuery const& query;
+    RecordingCursor* cursor;
+
+    template<class Matcher>
+    void operator () (Matcher const& matcher) {
+        Caller caller;
+        SelectionVector selection;
+        uint32_t first, last;
+        std::tie(first, last) = select_time_range(chunk.timestamps.data(), NUM_ROWS, query.lowerbound, query.upperbound);
+        if (UseHints) {
+            select_params_sorted(chunk.timestamps.data(), chunk.paramids.data(), first, last, matcher, &selection);
+        } else {
+            select_params(chunk.paramids.data(), first, last, matcher, &selection);
+        }
+        const size_t BATCH_SIZE = 0x100;
+        CursorResult batch[BATCH_SIZE];
+        size_t n = 0;
+        for (auto i: selection) {
+            batch[n++] = { chunk.offsets[i], chunk.lengths[i], chunk.timestamps[i], chunk.paramids[i], nullptr };
+            if (n == BATCH_SIZE) {
+                cursor->put_batch(caller, batch, n);
+                n = 0;
+            }
+        }
+        cursor->put_batch(caller, batch, n);
+    }
+};
+
+static size_t scan_selection(ChunkHeader const& chunk, SearchQuery const& query, RecordingCursor* cursor) {
+    SelectionScan<false> scan = { chunk, query, cursor };
+    dispatch_matcher(query, scan);
+    return cursor->results.size();
+}
+
+//! Selection vector evaluation that skips timestamp groups using matcher hints
+static size_t scan_hinted(ChunkHeader const& chunk, SearchQuery const& query, RecordingCursor* cursor) {
+    SelectionScan<true> scan = { chunk, query, cursor };
+    dispatch_matcher(query, scan);
+    return cursor->results.size();
+}
+
+template<class Fn>
+static void run(const char* name, Fn const& fn, ChunkHeader const& chunk, SearchQuery const& query) {
+    boost::timer timer;
+    size_t nresults = 0;
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        RecordingCursor cursor;
+        nresults = fn(chunk, query, &cursor);
+    }
+    std::cout << name << ": " << nresults << " results, "
+              << timer.elapsed()*1000.0/NUM_ITERATIONS << "ms per chunk" << std::endl;
+}
+
+//! End to end search of the page that contains one chunk
+static void run_page_search(ChunkHeader const& chunk, SearchQuery const& query) {
+    std::vector<char> page_mem(sizeof(PageHeader) + 64*1024*1024);
+    auto page = new (page_mem.data()) PageHeader(0, page_mem.size(), 0);
+    if (page->complete_chunk(chunk) != AKU_SUCCESS) {
+        std::cout << "can't write chunk" << std::endl;
+        return;
+    }
+    boost::timer timer;
+    size_t nresults = 0;
+    for (int i = 0; i < NUM_ITERATIONS; i++) {
+        Caller caller;
+        RecordingCursor cursor;
+        page->search(caller, &cursor, query);
+        nresults = cursor.results.size();
+    }
+    std::cout << "page search" << ": " << nresults << " results, "
+              << timer.elapsed()*1000.0/NUM_ITERATIONS << "ms per chunk (including decoding)" << std::endl;
+}
+
+int main(int cnt, const char** args)
+{
+    aku_initialize();
+
+    auto chunk = make_chunk();
+    aku_TimeStamp begin = chunk.timestamps.front() + 100;
+    aku_TimeStamp end = chunk.timestamps.back() - 100;
+
+    std::vector<aku_ParamId> params = { 1, 10, 42, 77 };
+    auto set_matcher = [params](aku_ParamId id) {
+        return std::binary_search(params.begin(), params.end(), id) ? SearchQuery::MATCH : SearchQuery::NO_MATCH;
+    };
+    std::vector<aku_ParamId> dense_params;
+    for (aku_ParamId id = 0; id < NUM_PARAMS; id += 3) {
+        dense_params.push_back(id);
+    }
+    std::vector<aku_ParamId> range_params = { 40, 41, 42, 43, 44 };
+    auto hinted_matcher = [](aku_ParamId id) {
+        return id < 2u ? SearchQuery::LT_ALL : id > 5u ? SearchQuery::GT_ALL : SearchQuery::MATCH;
+    };
+    std::vector<aku_ParamId> sparse_params;
+    for (aku_ParamId id = 1; id < 40; id += 4) {
+        sparse_params.push_back(id);
+    }
+
+    std::vector<std::pair<const char*, SearchQuery>> queries = {
+        { "Single parameter query", SearchQuery(42u, begin, end, AKU_CURSOR_DIR_FORWARD) },
+        { "Multiple parameters query (std::function)", SearchQuery(set_matcher, begin, end, AKU_CURSOR_DIR_FORWARD) },
+        { "Multiple parameters query (small set)", SearchQuery(params, begin, end, AKU_CURSOR_DIR_FORWARD) },
+        { "Multiple parameters query (bitmap)", SearchQuery(dense_params, begin, end, AKU_CURSOR_DIR_FORWARD) },
+        { "Multiple parameters query (range)", SearchQuery(range_params, begin, end, AKU_CURSOR_DIR_FORWARD) },
+        { "Multiple parameters query (sorted set)", SearchQuery(sparse_params, begin, end, AKU_CURSOR_DIR_FORWARD) },
+        { "Multiple parameters query (std::function with hints)", SearchQuery(hinted_matcher, begin, end, AKU_CURSOR_DIR_FORWARD) },
+        { "Parameter id range query", SearchQuery(10u, 19u, begin, end, AKU_CURSOR_DIR_FORWARD) },
+    };
+
+    for (auto const& q: queries) {
+        std::cout << q.first << std::endl;
+        run("row at a time", &scan_rows, chunk, q.second);
+        run("selection vector", &scan_selection, chunk, q.second);
+        run("selection vector with hints", &scan_hinted, chunk, q.second);
+        run_page_search(chunk, q.second);
+    }
+    return 0;
+}
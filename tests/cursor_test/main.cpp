@@ -0,0 +1,141 @@
+#include <iostream>
+#include <vector>
+#include <memory>
+
+#include <boost/timer.hpp>
+
+#include "akumuli.h"
+#include "page.h"
+#include "cursor.h"
+
+using namespace Akumuli;
+
+const int PAGE_SIZE = 64*1024*1024;
+const uint32_t NUM_PARAMS = 10;
+const int NUM_QUERIES = 10000;
+const int NUM_SCANS = 10;
+const int BUFFER_SIZE = 0x1000;
+
+static PageHeader* make_page(std::vector<char>* page_mem) {
+    page_mem->resize(sizeof(PageHeader) + PAGE_SIZE);
+    auto page = new (page_mem->data()) PageHeader(0, page_mem->size(), 0);
+    for (uint64_t i = 0; true; i++) {
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        if (page->add_entry(i % NUM_PARAMS, 1000u + i / NUM_PARAMS, range) == AKU_WRITE_STATUS_OVERFLOW) {
+            break;
+        }
+    }
+    page->_sort();
+    return page;
+}
+
+//! Cursor that runs page search in coroutine
+static std::unique_ptr<ExternalCursor> make_coro_cursor(PageHeader const* page, SearchQuery const& query) {
+    std::unique_ptr<CoroCursor> cursor(new CoroCursor());
+    auto pcursor = cursor.get();
+    cursor->start([page, pcursor, query](Caller& caller) {
+        page->search(caller, pcursor, query);
+    });
+    return std::move(cursor);
+}
+
+//! Pull cursor
+static std::unique_ptr<ExternalCursor> make_pull_cursor(PageHeader const* page, SearchQuery const& query) {
+    return page->search(query);
+}
+
+static size_t read_all(ExternalCursor* cursor, std::vector<CursorResult>* buffer) {
+    size_t nresults = 0;
+    while (!cursor->is_done()) {
+        nresults += cursor->read(buffer->data(), static_cast<int>(buffer->size()));
+    }
+    cursor->close();
+    return nresults;
+}
+
+//! Create many cursors that return few results
+template<class Fn>
+static void run_setup(const char* name, Fn const& make_cursor, PageHeader const* page) {
+    std::vector<CursorResult> buffer(BUFFER_SIZE);
+    aku_TimeStamp max_ts = page->bbox.max_timestamp;
+    boost::timer timer;
+    size_t nresults = 0;
+    for (int i = 0; i < NUM_QUERIES; i++) {
+        aku_TimeStamp ts = 1000u + (max_ts - 1000u)*i/NUM_QUERIES;
+        SearchQuery query(1u, ts, ts, i % 2 ? AKU_CURSOR_DIR_FORWARD : AKU_CURSOR_DIR_BACKWARD);
+        auto cursor = make_cursor(page, query);
+        nresults += read_all(cursor.get(), &buffer);
+    }
+    std::cout << name << ": " << nresults << " results, "
+              << timer.elapsed()*1000000.0/NUM_QUERIES << "us per query" << std::endl;
+}
+
+//! Read large number of results using small buffer
+template<class Fn>
+static void run_scan(const char* name, Fn const& make_cursor, PageHeader const* page, int buffer_size) {
+    std::vector<CursorResult> buffer(buffer_size);
+    boost::timer timer;
+    size_t nresults = 0;
+    for (int i = 0; i < NUM_SCANS; i++) {
+        SearchQuery query(0u, NUM_PARAMS, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP,
+                          i % 2 ? AKU_CURSOR_DIR_FORWARD : AKU_CURSOR_DIR_BACKWARD);
+        auto cursor = make_cursor(page, query);
+        nresults += read_all(cursor.get(), &buffer);
+    }
+    std::cout << name << " (buffer size " << buffer_size << "): " << nresults/NUM_SCANS << " results, "
+              << timer.elapsed()*1000000000.0/nresults << "ns per row" << std::endl;
+}
+
+//! Read results to the column arrays, rows are copied to temporary buffer first if `use_rows` is set
+static void run_columns(const char* name, PageHeader const* page, bool use_rows) {
+    std::vector<CursorResult> buffer(BUFFER_SIZE);
+    std::vector<aku_TimeStamp> timestamps(BUFFER_SIZE);
+    std::vector<aku_ParamId> params(BUFFER_SIZE);
+    std::vector<aku_PData> pointers(BUFFER_SIZE);
+    std::vector<uint32_t> lengths(BUFFER_SIZE);
+    CursorColumns columns = { timestamps.data(), params.data(), pointers.data(), lengths.data(), BUFFER_SIZE };
+    boost::timer timer;
+    size_t nresults = 0;
+    for (int i = 0; i < NUM_SCANS; i++) {
+        SearchQuery query(0u, NUM_PARAMS, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+        auto cursor = page->search(query);
+        while (!cursor->is_done()) {
+            if (use_rows) {
+                int n = cursor->read(buffer.data(), BUFFER_SIZE);
+                columns.set(0u, buffer.data(), n);
+                nresults += n;
+            } else {
+                nresults += cursor->read_columns(columns);
+            }
+        }
+        cursor->close();
+    }
+    std::cout << name << ": " << nresults/NUM_SCANS << " results, "
+              << timer.elapsed()*1000000000.0/nresults << "ns per row" << std::endl;
+}
+
+int main(int cnt, const char** args)
+{
+    aku_initialize();
+
+    std::vector<char> page_mem;
+    auto page = make_page(&page_mem);
+    std::cout << "Page contains " << page->count << " entries" << std::endl;
+    std::cout << "Coroutine stack size: " << AKU_STACK_SIZE << " bytes per cursor" << std::endl;
+
+    std::cout << "Query setup cost" << std::endl;
+    run_setup("coroutine cursor", &make_coro_cursor, page);
+    run_setup("pull cursor", &make_pull_cursor, page);
+
+    std::cout << "Per row overhead" << std::endl;
+    const int buffer_sizes[] = { 16, 0x100, BUFFER_SIZE };
+    for (auto buffer_size: buffer_sizes) {
+        run_scan("coroutine cursor", &make_coro_cursor, page, buffer_size);
+        run_scan("pull cursor", &make_pull_cursor, page, buffer_size);
+    }
+
+    std::cout << "Column output" << std::endl;
+    run_columns("rows copied to columns", page, true);
+    run_columns("columns written by cursor", page, false);
+    return 0;
+}
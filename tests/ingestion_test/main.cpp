@@ -6,6 +6,8 @@
 #include <vector>
 #include <algorithm>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
 
 #include <boost/timer.hpp>
 #include <boost/filesystem.hpp>
@@ -29,7 +31,11 @@ void delete_storage() {
     boost::filesystem::remove_all(DB_PATH);
 }
 
-bool query_database_forward(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp end, uint64_t& counter, boost::timer& timer, uint64_t mod) {
+/** Read all values of the series 42 and check them.
+  * If page_size is not zero, cursor is closed after every page_size values and search is
+  * resumed from the checkpoint.
+  */
+bool query_database_forward(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp end, uint64_t& counter, boost::timer& timer, uint64_t mod, uint64_t page_size=0) {
     const unsigned int NUM_ELEMENTS = 1000;
     aku_ParamId params[] = {42};
     aku_SelectQuery* query = aku_make_select_query( begin
@@ -39,6 +45,7 @@ bool query_database_forward(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp
     aku_Cursor* cursor = aku_select(db, query);
     aku_TimeStamp current_time = begin;
     size_t cursor_ix = 0;
+    uint64_t page_count = 0;
     while(!aku_cursor_is_done(cursor)) {
         int err = AKU_SUCCESS;
         if (aku_cursor_is_error(cursor, &err)) {
@@ -72,6 +79,14 @@ bool query_database_forward(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp
             }
             cursor_ix++;
         }
+        page_count += n_entries;
+        if (page_size && page_count >= page_size) {
+            aku_CursorToken token;
+            aku_cursor_checkpoint(cursor, &token);
+            aku_close_cursor(cursor);
+            cursor = aku_select_resume(db, query, &token);
+            page_count = 0;
+        }
     }
     aku_close_cursor(cursor);
     if (cursor_ix > 1000) {
@@ -80,11 +95,163 @@ bool query_database_forward(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp
     return true;
 }
 
+//! State of the asynchronous query
+struct AsyncContext {
+    aku_AsyncQuery*         query;
+    aku_TimeStamp           current_time;
+    uint64_t                counter;
+    bool                    failed;
+    bool                    done;
+    aku_Status              status;
+    std::mutex              mutex;
+    std::condition_variable cond;
+};
+
+void async_callback( void                 *user_data
+                   , aku_Status            status
+                   , bool                  done
+                   , aku_TimeStamp const  *timestamps
+                   , aku_ParamId const    *paramids
+                   , aku_PData const      *pointers
+                   , uint32_t const       *lengths
+                   , size_t                size )
+{
+    auto ctx = static_cast<AsyncContext*>(user_data);
+    if (done) {
+        std::lock_guard<std::mutex> guard(ctx->mutex);
+        ctx->done = true;
+        ctx->status = status;
+        ctx->cond.notify_all();
+        return;
+    }
+    for (size_t i = 0; i < size; i++) {
+        uint64_t const* pvalue = (uint64_t const*)pointers[i];
+        if (timestamps[i] != ctx->current_time || paramids[i] != 42 || *pvalue != ctx->current_time + 2) {
+            std::cout << "Error at " << ctx->counter << " expected ts " << ctx->current_time << " acutal ts " << timestamps[i]  << std::endl;
+            ctx->failed = true;
+            aku_async_cancel(ctx->query);
+            return;
+        }
+        ctx->current_time++;
+        ctx->counter++;
+    }
+    aku_async_request(ctx->query, 1);
+}
+
+//! Read all values of the series 42 using asynchronous query
+bool query_database_async(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp end, uint64_t& counter) {
+    aku_ParamId params[] = {42};
+    aku_SelectQuery* query = aku_make_select_query(begin, end, 1, params);
+    AsyncContext ctx;
+    ctx.current_time = begin;
+    ctx.counter = 0;
+    ctx.failed = false;
+    ctx.done = false;
+    ctx.status = AKU_SUCCESS;
+    ctx.query = aku_select_async(db, query, 1000, &async_callback, &ctx);
+    // Two batches can be delivered at once
+    aku_async_request(ctx.query, 2);
+    {
+        std::unique_lock<std::mutex> guard(ctx.mutex);
+        ctx.cond.wait(guard, [&ctx]() { return ctx.done; });
+    }
+    aku_async_close(ctx.query);
+    aku_destroy(query);
+    counter = ctx.counter;
+    if (ctx.status != AKU_SUCCESS) {
+        std::cout << aku_error_message(ctx.status) << std::endl;
+        return false;
+    }
+    return !ctx.failed;
+}
+
+//! Read series [40, 44] in series order (only series 42 has values), cursor is resumed every `page_size` results
+bool query_database_series(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp end, uint64_t page_size, uint64_t& counter) {
+    const unsigned int NUM_ELEMENTS = 1000;
+    aku_SelectQuery* query = aku_make_select_range_query(begin, end, 40, 44);
+    query->order = AKU_ORDER_BY_SERIES;
+    aku_Cursor* cursor = aku_select(db, query);
+    aku_TimeStamp current_time = begin;
+    uint64_t page_count = 0;
+    counter = 0;
+    while (!aku_cursor_is_done(cursor)) {
+        int err = AKU_SUCCESS;
+        if (aku_cursor_is_error(cursor, &err)) {
+            std::cout << aku_error_message(err) << std::endl;
+            return false;
+        }
+        aku_TimeStamp timestamps[NUM_ELEMENTS];
+        aku_ParamId paramids[NUM_ELEMENTS];
+        int n_entries = aku_cursor_read_columns(cursor, timestamps, paramids, nullptr, nullptr, NUM_ELEMENTS);
+        for (int i = 0; i < n_entries; i++) {
+            if (timestamps[i] != current_time || paramids[i] != 42) {
+                std::cout << "Error at " << counter << " expected ts " << current_time << " acutal ts " << timestamps[i]
+                          << " id " << paramids[i] << std::endl;
+                return false;
+            }
+            current_time++;
+            counter++;
+        }
+        page_count += n_entries;
+        if (page_count >= page_size) {
+            aku_CursorToken token;
+            aku_cursor_checkpoint(cursor, &token);
+            aku_close_cursor(cursor);
+            cursor = aku_select_resume(db, query, &token);
+            page_count = 0;
+        }
+    }
+    aku_close_cursor(cursor);
+    aku_destroy(query);
+    return true;
+}
+
+//! Compute aggregates of the series 42 and check them, `counter` receives total number of values
+bool query_database_aggregate(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp end, uint64_t width, uint64_t& counter) {
+    aku_ParamId params[] = {42};
+    aku_SelectQuery* query = aku_make_select_query(begin, end, 1, params);
+    aku_Cursor* cursor = aku_select_aggregate(db, query, width, AKU_VALUE_U64);
+    aku_TimeStamp next_bucket = begin;
+    counter = 0;
+    while (!aku_cursor_is_done(cursor)) {
+        int err = AKU_SUCCESS;
+        if (aku_cursor_is_error(cursor, &err)) {
+            std::cout << aku_error_message(err) << std::endl;
+            return false;
+        }
+        aku_AggregateRow rows[100];
+        int n = aku_cursor_read_aggregates(cursor, rows, 100);
+        for (int i = 0; i < n; i++) {
+            // Value with timestamp `ts` is equal to `ts + 2`
+            double min = static_cast<double>(rows[i].bucket + 2);
+            double max = static_cast<double>(rows[i].bucket + rows[i].count + 1);
+            if (rows[i].bucket != next_bucket || rows[i].param_id != 42 || rows[i].count > width ||
+                rows[i].min != min || rows[i].first != min || rows[i].max != max || rows[i].last != max)
+            {
+                std::cout << "Error at bucket " << rows[i].bucket << " expected bucket " << next_bucket << std::endl;
+                return false;
+            }
+            next_bucket += width;
+            counter += rows[i].count;
+        }
+    }
+    aku_close_cursor(cursor);
+    aku_destroy(query);
+    return true;
+}
+
 void print_storage_stats(aku_StorageStats& ss) {
     std::cout << ss.n_entries << " elenents in" << std::endl
               << ss.n_volumes << " volumes with" << std::endl
               << ss.used_space << " bytes used and" << std::endl
               << ss.free_space << " bytes free" << std::endl;
+    std::cout << ss.n_runs << " sequencer runs after "
+              << ss.n_compactions << " compactions" << std::endl;
+    for (int i = 0; i < AKU_RUN_SIZE_HISTOGRAM_SIZE; i++) {
+        if (ss.run_sizes[i]) {
+            std::cout << "runs with " << (1ul << i) << "+ values: " << ss.run_sizes[i] << std::endl;
+        }
+    }
 }
 
 void print_search_stats(aku_SearchStats& ss) {
@@ -108,6 +275,21 @@ void print_search_stats(aku_SearchStats& ss) {
     std::cout << "Scan" << std::endl;
     std::cout << ss.scan.bwd_bytes << " bytes read in backward direction" << std::endl
               << ss.scan.fwd_bytes << " bytes read in forward direction" << std::endl;
+
+    std::cout << "Result cache" << std::endl;
+    std::cout << ss.rcache.n_hits << " hits" << std::endl
+              << ss.rcache.n_misses << " misses" << std::endl;
+
+    std::cout << "Latency (total ns / times)" << std::endl;
+    auto print_latency = [](const char* name, aku_SearchStats::LatencyHistogram const& h) {
+        std::cout << name << ": " << h.total_ns << " / " << h.n_times << std::endl;
+    };
+    print_latency("histogram", ss.latency.histogram);
+    print_latency("learned index", ss.latency.learned_index);
+    print_latency("interpolation", ss.latency.interpolation);
+    print_latency("binary search", ss.latency.binary_search);
+    print_latency("chunk decode", ss.latency.chunk_decode);
+    print_latency("scan", ss.latency.scan);
 }
 
 enum Mode {
@@ -161,6 +343,17 @@ int main(int cnt, const char** args)
     aku_FineTuneParams params;
     params.debug_mode = 0;
     params.max_late_write = 10000;
+    params.max_chunk_cache_size = 0;
+    params.max_result_cache_size = 0x1000000;
+    params.page_index = AKU_PAGE_INDEX_HISTOGRAM;
+    // Aggregate query is partially answered using rollups
+    params.rollup_resolutions[0] = 1000;
+    params.rollup_resolutions[1] = 100000;
+    params.rollup_resolutions[2] = 0;
+    params.rollup_resolutions[3] = 0;
+    params.rollup_value_type = AKU_VALUE_U64;
+    params.rollup_max_buckets = 0;
+    params.rollup_max_size = 0;
     auto db = aku_open_database(DB_META_FILE, params);
     boost::timer timer;
 
@@ -213,6 +406,114 @@ int main(int cnt, const char** args)
         aku_global_search_stats(&search_stats, true);
         print_search_stats(search_stats);
 
+        // Paginated access
+        std::cout << "Paginated access" << std::endl;
+        uint64_t sequential_counter = counter;
+        counter = 0;
+        timer.restart();
+        if (!query_database_forward( db
+                           , std::numeric_limits<aku_TimeStamp>::min()
+                           , std::numeric_limits<aku_TimeStamp>::max()
+                           , counter
+                           , timer
+                           , 10000000
+                           , 10000))
+        {
+            return 7;
+        }
+        if (counter != sequential_counter) {
+            std::cout << "paginated access returned " << counter << " values, expected " << sequential_counter << std::endl;
+            return 8;
+        }
+        aku_global_search_stats(&search_stats, true);
+        print_search_stats(search_stats);
+
+        // Asynchronous access
+        std::cout << "Asynchronous access" << std::endl;
+        timer.restart();
+        if (!query_database_async( db
+                                 , std::numeric_limits<aku_TimeStamp>::min()
+                                 , std::numeric_limits<aku_TimeStamp>::max()
+                                 , counter))
+        {
+            return 9;
+        }
+        if (counter != sequential_counter) {
+            std::cout << "asynchronous access returned " << counter << " values, expected " << sequential_counter << std::endl;
+            return 10;
+        }
+        std::cout << "asynchronous access " << timer.elapsed() << "s" << std::endl;
+
+        // Aggregation
+        std::cout << "Aggregation" << std::endl;
+        timer.restart();
+        if (!query_database_aggregate( db
+                                     , std::numeric_limits<aku_TimeStamp>::min()
+                                     , std::numeric_limits<aku_TimeStamp>::max()
+                                     , 1000000
+                                     , counter))
+        {
+            return 11;
+        }
+        if (counter != sequential_counter) {
+            std::cout << "aggregation returned " << counter << " values, expected " << sequential_counter << std::endl;
+            return 12;
+        }
+        std::cout << "aggregation " << timer.elapsed() << "s" << std::endl;
+
+        // Series order
+        std::cout << "Series order" << std::endl;
+        timer.restart();
+        if (!query_database_series( db
+                                  , std::numeric_limits<aku_TimeStamp>::min()
+                                  , std::numeric_limits<aku_TimeStamp>::max()
+                                  , 1000000
+                                  , counter))
+        {
+            return 13;
+        }
+        if (counter != sequential_counter) {
+            std::cout << "series order returned " << counter << " values, expected " << sequential_counter << std::endl;
+            return 14;
+        }
+        std::cout << "series order " << timer.elapsed() << "s" << std::endl;
+
+        // Last values
+        std::cout << "Last values" << std::endl;
+        aku_ParamId last_params[] = {42, 43};
+        aku_TimeStamp last_timestamps[2];
+        aku_PData last_pointers[2];
+        uint32_t last_lengths[2];
+        timer.restart();
+        aku_Status status = aku_select_last(db, 2, last_params, last_timestamps, last_pointers, last_lengths);
+        std::cout << "select last " << timer.elapsed() << "s" << std::endl;
+        if (status != AKU_SUCCESS) {
+            std::cout << "select last error " << aku_error_message(status) << std::endl;
+            return 4;
+        }
+        // Last value should be the same as the first value returned by backward search
+        aku_SelectQuery* last_query = aku_make_select_query( std::numeric_limits<aku_TimeStamp>::max()
+                                                           , std::numeric_limits<aku_TimeStamp>::min()
+                                                           , 1, last_params);
+        aku_Cursor* last_cursor = aku_select(db, last_query);
+        aku_TimeStamp expected_timestamp = 0;
+        aku_PData expected_pointer = nullptr;
+        while (!aku_cursor_is_done(last_cursor) && expected_pointer == nullptr) {
+            aku_cursor_read_columns(last_cursor, &expected_timestamp, nullptr, &expected_pointer, nullptr, 1);
+        }
+        aku_close_cursor(last_cursor);
+        aku_destroy(last_query);
+        if (last_timestamps[0] != expected_timestamp || last_lengths[0] != sizeof(uint64_t)
+                || *(uint64_t*)last_pointers[0] != expected_timestamp + 2)
+        {
+            std::cout << "invalid last value " << last_timestamps[0] << ", expected " << expected_timestamp << std::endl;
+            return 5;
+        }
+        if (last_pointers[1] != nullptr) {
+            std::cout << "unexpected last value" << std::endl;
+            return 6;
+        }
+
         // Random access
         std::cout << "Prepare test data" << std::endl;
         std::vector<std::pair<aku_TimeStamp, aku_TimeStamp>> ranges;
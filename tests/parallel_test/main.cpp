@@ -7,6 +7,8 @@
 #include <algorithm>
 #include <memory>
 #include <thread>
+#include <atomic>
+#include <chrono>
 
 #include <boost/timer.hpp>
 #include <boost/filesystem.hpp>
@@ -27,6 +29,9 @@ const char* DB_META_FILE = "./test/test.akumuli";
 
 uint64_t reader_n_busy = 0ul;
 
+//! Largest timestamp written so far
+std::atomic<uint64_t> last_written {0ul};
+
 void delete_storage() {
     boost::filesystem::remove_all(DB_PATH);
 }
@@ -59,6 +64,17 @@ void print_search_stats(aku_SearchStats& ss) {
     std::cout << "Scan" << std::endl;
     std::cout << ss.scan.bwd_bytes << " bytes read in backward direction" << std::endl
               << ss.scan.fwd_bytes << " bytes read in forward direction" << std::endl;
+
+    std::cout << "Latency (total ns / times)" << std::endl;
+    auto print_latency = [](const char* name, aku_SearchStats::LatencyHistogram const& h) {
+        std::cout << name << ": " << h.total_ns << " / " << h.n_times << std::endl;
+    };
+    print_latency("histogram", ss.latency.histogram);
+    print_latency("learned index", ss.latency.learned_index);
+    print_latency("interpolation", ss.latency.interpolation);
+    print_latency("binary search", ss.latency.binary_search);
+    print_latency("chunk decode", ss.latency.chunk_decode);
+    print_latency("scan", ss.latency.scan);
 }
 
 aku_TimeStamp query_database_backward(aku_Database* db, aku_TimeStamp begin, aku_TimeStamp end, uint64_t& counter, boost::timer& timer, uint64_t mod) {
@@ -197,6 +213,63 @@ aku_TimeStamp query_database_forward(aku_Database* db, aku_TimeStamp begin, aku_
     return last;
 }
 
+//! Check if value with timestamp `ts` can be read using forward query
+bool is_visible_forward(aku_Database* db, aku_TimeStamp ts) {
+    aku_ParamId params[] = {42};
+    aku_SelectQuery* query = aku_make_select_query(ts, AKU_MAX_TIMESTAMP, 1, params);
+    aku_Cursor* cursor = aku_select(db, query);
+    bool found = false;
+    while(!found && !aku_cursor_is_done(cursor)) {
+        int err = AKU_SUCCESS;
+        if (aku_cursor_is_error(cursor, &err)) {
+            aku_close_cursor(cursor);
+            if (err == AKU_EBUSY) {
+                reader_n_busy++;
+                return false;
+            }
+            std::cout << aku_error_message(err) << std::endl;
+            throw std::runtime_error(aku_error_message(err));
+        }
+        aku_TimeStamp timestamp;
+        if (aku_cursor_read_columns(cursor, &timestamp, nullptr, nullptr, nullptr, 1) == 1) {
+            found = timestamp == ts;
+            break;
+        }
+    }
+    aku_close_cursor(cursor);
+    return found;
+}
+
+/** Freshness latency benchmark.
+  * Time between the moment when value is written and the moment when it
+  * can be read by forward query.
+  */
+void measure_freshness(aku_Database* db) {
+    using namespace std::chrono;
+    uint64_t n_samples = 0u;
+    uint64_t n_queries = 0u;
+    nanoseconds total(0), max_latency(0);
+    while (true) {
+        aku_TimeStamp target = last_written.load();
+        auto start = steady_clock::now();
+        while (!is_visible_forward(db, target)) {
+            n_queries++;
+            std::this_thread::yield();
+        }
+        n_queries++;
+        auto latency = duration_cast<nanoseconds>(steady_clock::now() - start);
+        total += latency;
+        max_latency = std::max(max_latency, latency);
+        n_samples++;
+        if (target == NUM_ITERATIONS - 1) {
+            break;
+        }
+    }
+    std::cout << "Freshness latency (fw): " << n_samples << " samples, "
+              << n_queries << " queries, avg " << (total.count() / n_samples) << "ns, "
+              << "max " << max_latency.count() << "ns" << std::endl;
+}
+
 int main(int cnt, const char** args)
 {
     aku_initialize();
@@ -214,6 +287,12 @@ int main(int cnt, const char** args)
     aku_FineTuneParams params;
     params.debug_mode = 0;
     params.max_late_write = 10000;
+    params.max_chunk_cache_size = 0;
+    params.max_result_cache_size = 0;
+    params.page_index = AKU_PAGE_INDEX_HISTOGRAM;
+    for (int i = 0; i < AKU_MAX_ROLLUPS; i++) {
+        params.rollup_resolutions[i] = 0;
+    }
     auto db = aku_open_database(DB_META_FILE, params);
     boost::timer timer;
 
@@ -242,7 +321,7 @@ int main(int cnt, const char** args)
         while (true) {
             top = query_database_forward(db, top, AKU_MAX_TIMESTAMP, counter, timer, 1000000);
             query_counter++;
-            if (top >= (NUM_ITERATIONS - 20001)) {
+            if (top == NUM_ITERATIONS - 1) {
                 std::cout << "query_counter=" << query_counter << std::endl;
                 break;
             }
@@ -251,6 +330,9 @@ int main(int cnt, const char** args)
 
     std::thread fw_reader_thread(reader_fn_fw);
     std::thread bw_reader_thread(reader_fn_bw);
+    std::thread freshness_thread([&db]() {
+        measure_freshness(db);
+    });
 
     int writer_n_busy = 0;
     for(uint64_t ts = 0; ts < NUM_ITERATIONS; ts++) {
@@ -273,11 +355,13 @@ int main(int cnt, const char** args)
             std::cout << "aku_add_sample error " << aku_error_message(status) << std::endl;
             break;
         }
+        last_written.store(ts);
     }
     std::cout << "Writer busy count = " << writer_n_busy << std::endl;
 
     fw_reader_thread.join();
     bw_reader_thread.join();
+    freshness_thread.join();
 
     std::cout << "Reader busy count = " << reader_n_busy << std::endl;
 
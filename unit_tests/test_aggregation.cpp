@@ -0,0 +1,124 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <map>
+#include <vector>
+
+#include "aggregation.h"
+
+using namespace Akumuli;
+
+static std::vector<aku_AggregateRow> read_all(AggregateCursor& cursor, size_t buf_size) {
+    std::vector<aku_AggregateRow> rows;
+    while (!cursor.is_done()) {
+        std::vector<aku_AggregateRow> buf(buf_size);
+        int n = cursor.read(buf.data(), buf_size);
+        rows.insert(rows.end(), buf.begin(), buf.begin() + n);
+    }
+    BOOST_REQUIRE(!cursor.is_error(nullptr));
+    return rows;
+}
+
+//! Aggregate results of the page search (values are 64-bit integers)
+static std::vector<aku_AggregateRow> aggregate_results(std::vector<CursorResult> const& results,
+                                                       aku_Duration width, int dir)
+{
+    std::map<std::pair<aku_TimeStamp, aku_ParamId>, AggregateState> states;
+    for (auto const& res: results) {
+        if (res.length != sizeof(uint64_t)) {
+            continue;
+        }
+        uint64_t value = *static_cast<uint64_t const*>(res.page->read_entry_data(res.data_offset));
+        aku_TimeStamp bucket = res.timestamp - res.timestamp % width;
+        states[std::make_pair(bucket, res.param_id)].add(res.timestamp, static_cast<double>(value));
+    }
+    std::vector<aku_AggregateRow> rows;
+    for (auto const& kv: states) {
+        aku_AggregateRow row;
+        kv.second.get(kv.first.first, kv.first.second, &row);
+        rows.push_back(row);
+    }
+    if (dir == AKU_CURSOR_DIR_BACKWARD) {
+        // Buckets are ordered backward, series inside bucket are ordered by id
+        std::stable_sort(rows.begin(), rows.end(), [](aku_AggregateRow const& a, aku_AggregateRow const& b) {
+            return a.bucket > b.bucket;
+        });
+    }
+    return rows;
+}
+
+void test_aggregate_cursor(int dir) {
+    const int                   buf_len = 1024*1024*4;
+    std::vector<char>           buffer(buf_len);
+    aku_TimeStamp               time_stamp = 0u;
+    PageHeader*                 page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+    page->init_index(AKU_PAGE_INDEX_HISTOGRAM);
+
+    for(uint64_t i = 0; true; i++)
+    {
+        aku_ParamId id = 1 + std::rand() % 10;
+        // Every 10th value has wrong size and should be ignored
+        aku_MemRange range = {(void*)&i, i % 10 ? static_cast<uint32_t>(sizeof(i)) : 4u};
+        if(page->add_entry(id, time_stamp, range) == AKU_WRITE_STATUS_OVERFLOW) {
+            break;
+        }
+        time_stamp += std::rand() % 3;
+    }
+    page->_sort();
+
+    const aku_Duration widths[] = { 1u, 7u, 100u, 1000000u };
+    for (auto width: widths) {
+        aku_TimeStamp max_ts = page->bbox.max_timestamp;
+        aku_TimeStamp start_time = std::rand() % (max_ts/2);
+        aku_TimeStamp stop_time  = start_time + std::rand() % (max_ts/2);
+        std::vector<aku_ParamId> params = { 2u, 3u, 7u };
+        SearchQuery query(params, start_time, stop_time, dir);
+
+        Caller caller;
+        RecordingCursor recorder;
+        page->search(caller, &recorder, query);
+        auto expected = aggregate_results(recorder.results, width, dir);
+
+        AggregateCursor cursor(page->search(query), width, AKU_VALUE_U64);
+        auto actual = read_all(cursor, 7);
+        cursor.close();
+
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        for (size_t i = 0; i < actual.size(); i++) {
+            BOOST_REQUIRE_EQUAL(actual[i].bucket, expected[i].bucket);
+            BOOST_REQUIRE_EQUAL(actual[i].param_id, expected[i].param_id);
+            BOOST_REQUIRE_EQUAL(actual[i].count, expected[i].count);
+            BOOST_REQUIRE_EQUAL(actual[i].min, expected[i].min);
+            BOOST_REQUIRE_EQUAL(actual[i].max, expected[i].max);
+            BOOST_REQUIRE_EQUAL(actual[i].sum, expected[i].sum);
+            BOOST_REQUIRE_EQUAL(actual[i].mean, expected[i].mean);
+            BOOST_REQUIRE_EQUAL(actual[i].first, expected[i].first);
+            BOOST_REQUIRE_EQUAL(actual[i].last, expected[i].last);
+        }
+    }
+
+    // Zero width is not allowed
+    SearchQuery query(1u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, dir);
+    AggregateCursor cursor(page->search(query), 0u, AKU_VALUE_U64);
+    int error_code = AKU_SUCCESS;
+    BOOST_REQUIRE(cursor.is_done());
+    BOOST_REQUIRE(cursor.is_error(&error_code));
+    BOOST_REQUIRE_EQUAL(error_code, AKU_EBAD_ARG);
+
+    // Unknown value type is not allowed
+    AggregateCursor bad_type(page->search(query), 1000u, 42);
+    error_code = AKU_SUCCESS;
+    BOOST_REQUIRE(bad_type.is_done());
+    BOOST_REQUIRE(bad_type.is_error(&error_code));
+    BOOST_REQUIRE_EQUAL(error_code, AKU_EBAD_ARG);
+}
+
+BOOST_AUTO_TEST_CASE(Test_aggregate_cursor_forward) {
+    test_aggregate_cursor(AKU_CURSOR_DIR_FORWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_aggregate_cursor_backward) {
+    test_aggregate_cursor(AKU_CURSOR_DIR_BACKWARD);
+}
@@ -0,0 +1,164 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+#include <future>
+
+#include "async_query.h"
+
+using namespace Akumuli;
+
+//! Cursor that returns `size` results with timestamps 0, 1, 2...
+struct CountingCursor : ExternalCursor {
+    size_t size;
+    size_t pos;
+    std::atomic<bool>* closed;
+
+    CountingCursor(size_t size, std::atomic<bool>* closed)
+        : size(size)
+        , pos(0u)
+        , closed(closed)
+    {
+    }
+
+    virtual int read(CursorResult* buf, int buf_len) {
+        int n = static_cast<int>(std::min(size - pos, static_cast<size_t>(buf_len)));
+        for (int i = 0; i < n; i++) {
+            buf[i] = { 0u, 0u, static_cast<aku_TimeStamp>(pos++), 42u, nullptr };
+        }
+        return n;
+    }
+
+    virtual int read_columns(CursorColumns const& columns) {
+        size_t n = std::min(size - pos, columns.size);
+        for (size_t i = 0; i < n; i++) {
+            columns.timestamps[i] = pos++;
+            columns.params[i] = 42u;
+            columns.pointers[i] = nullptr;
+            columns.lengths[i] = 0u;
+        }
+        return static_cast<int>(n);
+    }
+
+    virtual bool is_done() const {
+        return pos == size;
+    }
+
+    virtual bool is_error(int* out_error_code_or_null) const {
+        return false;
+    }
+
+    virtual void close() {
+        *closed = true;
+    }
+};
+
+//! Results receiver, requests next batch from callback
+struct Receiver {
+    std::vector<aku_TimeStamp>  timestamps;
+    size_t                      max_batch;
+    int                         ndone;
+    aku_Status                  status;
+    std::promise<void>          done;
+    std::shared_ptr<AsyncQuery> query;
+    bool                        request_more;
+    size_t                      nbatches;
+    size_t                      signal_after;   //< number of batches that sets `received` (0 - never)
+    std::promise<void>          received;
+
+    Receiver(bool request_more, size_t signal_after = 0u)
+        : max_batch(0u)
+        , ndone(0)
+        , status(AKU_SUCCESS)
+        , request_more(request_more)
+        , nbatches(0u)
+        , signal_after(signal_after)
+    {
+    }
+
+    void operator () (aku_Status st, bool is_done, CursorColumns const& batch) {
+        if (is_done) {
+            BOOST_REQUIRE_EQUAL(batch.size, 0u);
+            ndone++;
+            status = st;
+            done.set_value();
+            return;
+        }
+        BOOST_REQUIRE(batch.size != 0u);
+        max_batch = std::max(max_batch, batch.size);
+        timestamps.insert(timestamps.end(), batch.timestamps, batch.timestamps + batch.size);
+        if (++nbatches == signal_after) {
+            received.set_value();
+        }
+        if (request_more) {
+            query->request(1);
+        }
+    }
+};
+
+static std::shared_ptr<AsyncQuery> make_query(WorkerPool& pool, Receiver* receiver, size_t size,
+                                              size_t batch_size, std::atomic<bool>* closed)
+{
+    std::unique_ptr<ExternalCursor> cursor(new CountingCursor(size, closed));
+    auto fn = [receiver](aku_Status st, bool is_done, CursorColumns const& batch) {
+        (*receiver)(st, is_done, batch);
+    };
+    receiver->query = std::make_shared<AsyncQuery>(nullptr, std::move(cursor), batch_size, fn, pool);
+    return receiver->query;
+}
+
+static void test_async_query(size_t size, size_t batch_size) {
+    WorkerPool pool(2);
+    std::atomic<bool> closed = {false};
+    Receiver receiver(true);
+    auto query = make_query(pool, &receiver, size, batch_size, &closed);
+    auto done = receiver.done.get_future();
+    query->request(1);
+    done.wait();
+    query->close();
+
+    BOOST_REQUIRE_EQUAL(receiver.ndone, 1);
+    BOOST_REQUIRE_EQUAL(receiver.status, AKU_SUCCESS);
+    BOOST_REQUIRE(receiver.max_batch <= batch_size);
+    BOOST_REQUIRE(closed);
+    BOOST_REQUIRE_EQUAL(receiver.timestamps.size(), size);
+    for (size_t i = 0; i < size; i++) {
+        BOOST_REQUIRE_EQUAL(receiver.timestamps[i], i);
+    }
+    receiver.query.reset();
+}
+
+BOOST_AUTO_TEST_CASE(Test_async_query_delivers_all_results)
+{
+    test_async_query(0, 10);
+    test_async_query(1, 10);
+    test_async_query(1000, 10);
+    test_async_query(1000, 7);
+    test_async_query(1000, 5000);
+}
+
+BOOST_AUTO_TEST_CASE(Test_async_query_backpressure_and_cancel)
+{
+    WorkerPool pool(2);
+    std::atomic<bool> closed = {false};
+    Receiver receiver(false, 3u);
+    auto query = make_query(pool, &receiver, 1000, 10, &closed);
+    auto done = receiver.done.get_future();
+    auto received = receiver.received.get_future();
+    query->request(3);
+    // Only requested batches should be delivered
+    received.wait();
+    BOOST_REQUIRE(done.wait_for(std::chrono::seconds(0)) != std::future_status::ready);
+    query->cancel();
+    done.wait();
+    query->close();
+
+    BOOST_REQUIRE_EQUAL(receiver.timestamps.size(), 30u);
+    BOOST_REQUIRE_EQUAL(receiver.ndone, 1);
+    BOOST_REQUIRE_EQUAL(receiver.status, AKU_ECANCELED);
+    BOOST_REQUIRE(closed);
+    receiver.query.reset();
+}
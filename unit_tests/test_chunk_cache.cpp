@@ -0,0 +1,101 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "chunk_cache.h"
+#include "cursor.h"
+#include "page.h"
+
+using namespace Akumuli;
+
+static ChunkCache::PChunk make_chunk(size_t n_elements) {
+    std::shared_ptr<ChunkHeader> chunk(new ChunkHeader());
+    for (size_t i = 0; i < n_elements; i++) {
+        chunk->timestamps.push_back(i);
+        chunk->paramids.push_back(i);
+        chunk->offsets.push_back(i);
+        chunk->lengths.push_back(i);
+    }
+    return chunk;
+}
+
+BOOST_AUTO_TEST_CASE(Test_chunk_cache_put_get)
+{
+    ChunkCache cache(0x100000);
+    ChunkKey key = { 1u, 2u, 3u };
+    auto chunk = make_chunk(10);
+    BOOST_REQUIRE(!cache.get(key));
+    cache.put(key, chunk);
+    BOOST_REQUIRE(cache.get(key) == chunk);
+    BOOST_REQUIRE_EQUAL(cache.get_size(), ChunkCache::estimate_size(*chunk));
+
+    // page reused, chunk with the same offset must not match
+    ChunkKey new_key = { 1u, 3u, 3u };
+    BOOST_REQUIRE(!cache.get(new_key));
+}
+
+BOOST_AUTO_TEST_CASE(Test_chunk_cache_eviction)
+{
+    const size_t max_size = 0x100000;
+    ChunkCache cache(max_size);
+    auto chunk = make_chunk(100);
+    const uint32_t n_chunks = 10000;
+    for (uint32_t i = 0; i < n_chunks; i++) {
+        ChunkKey key = { 0u, 0u, i };
+        cache.put(key, chunk);
+        BOOST_REQUIRE_LE(cache.get_size(), max_size);
+    }
+    // the most recent chunk must be in cache, the first one - evicted
+    ChunkKey last = { 0u, 0u, n_chunks - 1 };
+    ChunkKey first = { 0u, 0u, 0u };
+    BOOST_REQUIRE(cache.get(last));
+    BOOST_REQUIRE(!cache.get(first));
+}
+
+BOOST_AUTO_TEST_CASE(Test_chunk_cache_page_search)
+{
+    std::vector<char> page_mem;
+    page_mem.resize(sizeof(PageHeader) + 0x10000);
+    auto page = new (page_mem.data()) PageHeader(0, page_mem.size(), 0);
+
+    ChunkHeader header;
+    for (uint32_t i = 0; i < 100; i++) {
+        char buffer[4];
+        aku_MemRange range = {buffer, 4};
+        BOOST_REQUIRE_EQUAL(page->add_chunk(range, 0x1000), AKU_SUCCESS);
+        header.timestamps.push_back(1000 + i);
+        header.paramids.push_back(1 + (i & 1));
+        header.offsets.push_back(page->last_offset);
+        header.lengths.push_back(4);
+    }
+    BOOST_REQUIRE_EQUAL(page->complete_chunk(header), AKU_SUCCESS);
+
+    ChunkCache cache(0x100000);
+    aku_SearchStats stats;
+    PageHeader::get_search_stats(&stats, true);
+
+    std::vector<CursorResult> expected;
+    for (int round = 0; round < 3; round++) {
+        SearchQuery query(1u, 1000u, 1099u, AKU_CURSOR_DIR_FORWARD);
+        Caller caller;
+        RecordingCursor cursor;
+        page->search(caller, &cursor, query, &cache);
+        BOOST_REQUIRE(cursor.completed);
+        BOOST_REQUIRE_EQUAL(cursor.results.size(), 50u);
+        if (round == 0) {
+            expected = cursor.results;
+        } else {
+            for (size_t i = 0; i < expected.size(); i++) {
+                BOOST_REQUIRE_EQUAL(expected[i].timestamp, cursor.results[i].timestamp);
+                BOOST_REQUIRE_EQUAL(expected[i].data_offset, cursor.results[i].data_offset);
+            }
+        }
+    }
+
+    PageHeader::get_search_stats(&stats, true);
+    BOOST_REQUIRE_EQUAL(stats.cache.n_misses, 1u);
+    BOOST_REQUIRE_EQUAL(stats.cache.n_hits, 2u);
+}
@@ -4,6 +4,7 @@
 #include <iostream>
 #include <boost/test/unit_test.hpp>
 #include <vector>
+#include <thread>
 
 #include "cursor.h"
 #include "page.h"
@@ -197,17 +198,16 @@ void test_fan_in_cursor(uint32_t dir, int n_cursors, int page_size) {
     auto match_all = [](aku_ParamId) { return SearchQuery::MATCH; };
     SearchQuery q(match_all, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, dir);
 
-    std::vector<CoroCursor> cursors(n_cursors);
+    std::vector<std::unique_ptr<ExternalCursor>> cursors;
     for (int i = 0; i < n_cursors; i++) {
         PageHeader* page = pages[i].page;
-        CoroCursor* cursor = &cursors[i];
-        cursor->start(std::bind(&PageHeader::search, page, std::placeholders::_1, cursor, q));
+        cursors.push_back(page->search(q));
     }
 
     std::vector<ExternalCursor*> ecur;
     std::transform(cursors.begin(), cursors.end(),
                    std::back_inserter(ecur),
-                   [](Cursor& c) { return &c; });
+                   [](std::unique_ptr<ExternalCursor>& c) { return c.get(); });
 
     FanInCursorCombinator cursor(&ecur[0], n_cursors, (int)dir);
 
@@ -276,3 +276,200 @@ BOOST_AUTO_TEST_CASE(Test_fan_in_cursor_4_b)
 {
     test_fan_in_cursor(AKU_CURSOR_DIR_BACKWARD, 10, 100000 + sizeof(PageHeader));
 }
+
+void test_concat_cursor(int n_cursors, int n_iter, int buf_size, bool set_error) {
+    std::vector<CoroCursor> cursors(n_cursors);
+    for (int i = 0; i < n_cursors; i++) {
+        CoroCursor* cursor = &cursors[i];
+        bool last = i == n_cursors - 1;
+        auto generator = [i, n_iter, cursor, last, set_error](Caller& caller) {
+            for (int k = 0; k < n_iter; k++) {
+                CursorResult r;
+                r.data_offset = i*n_iter + k;
+                r.page = nullptr;
+                cursor->put(caller, r);
+            }
+            if (last && set_error) {
+                cursor->set_error(caller, -1);
+            } else {
+                cursor->complete(caller);
+            }
+        };
+        cursor->start(generator);
+    }
+
+    std::vector<ExternalCursor*> ecur;
+    std::transform(cursors.begin(), cursors.end(),
+                   std::back_inserter(ecur),
+                   [](Cursor& c) { return &c; });
+
+    ConcatCursor cursor(&ecur[0], n_cursors);
+    std::vector<aku_EntryOffset> actual;
+    while(!cursor.is_done()) {
+        CursorResult results[buf_size];
+        int n_read = cursor.read(results, buf_size);
+        for (int i = 0; i < n_read; i++) {
+            actual.push_back(results[i].data_offset);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(cursor.is_error(nullptr), set_error);
+    cursor.close();
+
+    BOOST_REQUIRE_EQUAL(actual.size(), static_cast<size_t>(n_cursors*n_iter));
+    for (size_t i = 0; i < actual.size(); i++) {
+        BOOST_REQUIRE_EQUAL(actual[i], i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_concat_cursor)
+{
+    test_concat_cursor(1, 100, 7, false);
+    test_concat_cursor(10, 100, 7, false);
+    test_concat_cursor(10, 0, 7, false);
+    test_concat_cursor(3, 10, 100, false);
+}
+
+BOOST_AUTO_TEST_CASE(Test_concat_cursor_error)
+{
+    test_concat_cursor(1, 100, 7, true);
+    test_concat_cursor(10, 100, 7, true);
+}
+
+void test_queue_cursor(int n_iter, int buf_size, bool close_early) {
+    QueueCursor cursor;
+    bool rejected = false;
+    std::thread producer([&cursor, &rejected, n_iter]() {
+        Caller caller;
+        for (int i = 0; i < n_iter; i++) {
+            CursorResult r;
+            r.data_offset = i;
+            r.page = nullptr;
+            if (!cursor.put(caller, r)) {
+                rejected = true;
+                break;
+            }
+        }
+        cursor.complete(caller);
+    });
+
+    std::vector<aku_EntryOffset> actual;
+    while(!cursor.is_done()) {
+        CursorResult results[buf_size];
+        int n_read = cursor.read(results, buf_size);
+        for (int i = 0; i < n_read; i++) {
+            actual.push_back(results[i].data_offset);
+        }
+        if (close_early && actual.size() > 0) {
+            break;
+        }
+    }
+    cursor.close();
+    producer.join();
+
+    if (close_early) {
+        BOOST_REQUIRE(rejected);
+    } else {
+        BOOST_REQUIRE(!cursor.is_error(nullptr));
+        BOOST_REQUIRE_EQUAL(actual.size(), static_cast<size_t>(n_iter));
+    }
+    for (size_t i = 0; i < actual.size(); i++) {
+        BOOST_REQUIRE_EQUAL(actual[i], i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_queue_cursor)
+{
+    test_queue_cursor(0, 7, false);
+    test_queue_cursor(100, 7, false);
+    test_queue_cursor(100000, 1000, false);
+}
+
+BOOST_AUTO_TEST_CASE(Test_queue_cursor_close)
+{
+    test_queue_cursor(100000, 10, true);
+}
+
+//! Cursors of several pages combined by fan-in or concat cursor
+struct CombinedCursor {
+    std::vector<std::unique_ptr<ExternalCursor>> inputs;
+    std::vector<ExternalCursor*> pinputs;
+    std::unique_ptr<ExternalCursor> cursor;
+
+    CombinedCursor(std::vector<PageWrapper> const& pages, SearchQuery const& query, bool fan_in) {
+        for (auto const& wrapper: pages) {
+            inputs.push_back(wrapper.page->search(query));
+            pinputs.push_back(inputs.back().get());
+        }
+        if (fan_in) {
+            cursor.reset(new FanInCursorCombinator(&pinputs[0], (int)pinputs.size(), query.direction));
+        } else {
+            cursor.reset(new ConcatCursor(&pinputs[0], (int)pinputs.size()));
+        }
+    }
+};
+
+void test_read_columns(uint32_t dir, bool fan_in, size_t columns_size) {
+    std::vector<PageWrapper> pages;
+    pages.reserve(3);
+    for (int i = 0; i < 3; i++) {
+        pages.emplace_back(100000 + sizeof(PageHeader), (uint32_t)i);
+    }
+    auto match_all = [](aku_ParamId) { return SearchQuery::MATCH; };
+    SearchQuery query(match_all, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, dir);
+
+    std::vector<CursorResult> expected;
+    CombinedCursor rows(pages, query, fan_in);
+    while (!rows.cursor->is_done()) {
+        CursorResult buf[0x100];
+        int n = rows.cursor->read(buf, 0x100);
+        expected.insert(expected.end(), buf, buf + n);
+    }
+    rows.cursor->close();
+
+    std::vector<aku_TimeStamp> timestamps(columns_size);
+    std::vector<aku_ParamId> params(columns_size);
+    std::vector<aku_PData> pointers(columns_size);
+    std::vector<uint32_t> lengths(columns_size);
+    CursorColumns columns = { timestamps.data(), params.data(), pointers.data(), lengths.data(), columns_size };
+    CombinedCursor cols(pages, query, fan_in);
+    size_t ix = 0;
+    while (!cols.cursor->is_done()) {
+        int n = cols.cursor->read_columns(columns);
+        BOOST_REQUIRE(n >= 0 && (size_t)n <= columns_size);
+        BOOST_REQUIRE(ix + n <= expected.size());
+        for (int i = 0; i < n; i++, ix++) {
+            auto const& exp = expected[ix];
+            BOOST_REQUIRE_EQUAL(timestamps[i], exp.timestamp);
+            BOOST_REQUIRE_EQUAL(params[i], exp.param_id);
+            BOOST_REQUIRE_EQUAL(lengths[i], exp.length);
+            BOOST_REQUIRE(pointers[i] == exp.page->read_entry_data(exp.data_offset));
+        }
+    }
+    BOOST_REQUIRE(!cols.cursor->is_error(nullptr));
+    cols.cursor->close();
+    BOOST_REQUIRE_EQUAL(ix, expected.size());
+
+    // Null columns are not written
+    CursorColumns only_ts = { timestamps.data(), nullptr, nullptr, nullptr, columns_size };
+    CombinedCursor ts_cursor(pages, query, fan_in);
+    ix = 0;
+    while (!ts_cursor.cursor->is_done()) {
+        int n = ts_cursor.cursor->read_columns(only_ts);
+        for (int i = 0; i < n; i++, ix++) {
+            BOOST_REQUIRE_EQUAL(timestamps[i], expected[ix].timestamp);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(ix, expected.size());
+}
+
+BOOST_AUTO_TEST_CASE(Test_read_columns_concat)
+{
+    test_read_columns(AKU_CURSOR_DIR_FORWARD, false, 7);
+    test_read_columns(AKU_CURSOR_DIR_BACKWARD, false, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(Test_read_columns_fan_in)
+{
+    test_read_columns(AKU_CURSOR_DIR_FORWARD, true, 1000);
+    test_read_columns(AKU_CURSOR_DIR_BACKWARD, true, 7);
+}
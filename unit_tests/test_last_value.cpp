@@ -0,0 +1,101 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "last_value.h"
+#include "sequencer.h"
+
+using namespace Akumuli;
+
+BOOST_AUTO_TEST_CASE(Test_last_value_update)
+{
+    LastValueTable table;
+    LastValue value;
+    BOOST_REQUIRE_EQUAL(table.get(42u, &value), LastValueTable::MISSING);
+
+    // value added by the writer is incomplete until storage is searched
+    LastValue first = { 100u, 10u, 8u, 1u, 2u };
+    table.update(42u, first);
+    BOOST_REQUIRE_EQUAL(table.get(42u, &value), LastValueTable::INCOMPLETE);
+    BOOST_REQUIRE_EQUAL(value.timestamp, 100u);
+    BOOST_REQUIRE_EQUAL(value.offset, 10u);
+
+    // late value doesn't replace newer one
+    LastValue late = { 99u, 20u, 8u, 1u, 2u };
+    table.update(42u, late);
+    BOOST_REQUIRE_EQUAL(table.get(42u, &value), LastValueTable::INCOMPLETE);
+    BOOST_REQUIRE_EQUAL(value.offset, 10u);
+
+    // older search result doesn't replace newer value
+    table.set_searched(42u, &late);
+    BOOST_REQUIRE_EQUAL(table.get(42u, &value), LastValueTable::COMPLETE);
+    BOOST_REQUIRE_EQUAL(value.offset, 10u);
+
+    // value with the same timestamp replaces previous one
+    LastValue next = { 100u, 30u, 4u, 2u, 3u };
+    table.update(42u, next);
+    BOOST_REQUIRE_EQUAL(table.get(42u, &value), LastValueTable::COMPLETE);
+    BOOST_REQUIRE_EQUAL(value.offset, 30u);
+    BOOST_REQUIRE_EQUAL(value.length, 4u);
+    BOOST_REQUIRE_EQUAL(value.page_id, 2u);
+    BOOST_REQUIRE_EQUAL(value.open_count, 3u);
+
+    BOOST_REQUIRE_EQUAL(table.get(43u, &value), LastValueTable::MISSING);
+    BOOST_REQUIRE_EQUAL(table.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_last_value_backfill)
+{
+    LastValueTable table;
+    LastValue value;
+
+    // Backfilled value is older than the last value stored before the table was created
+    LastValue backfill = { 50u, 10u, 8u, 1u, 2u };
+    table.update(42u, backfill);
+    BOOST_REQUIRE_EQUAL(table.get(42u, &value), LastValueTable::INCOMPLETE);
+    LastValue stored = { 100u, 20u, 8u, 0u, 1u };
+    table.set_searched(42u, &stored);
+    BOOST_REQUIRE_EQUAL(table.get(42u, &value), LastValueTable::COMPLETE);
+    BOOST_REQUIRE_EQUAL(value.timestamp, 100u);
+    BOOST_REQUIRE_EQUAL(value.offset, 20u);
+
+    // Series without values
+    table.set_searched(43u, nullptr);
+    BOOST_REQUIRE_EQUAL(table.get(43u, &value), LastValueTable::EMPTY);
+    LastValue first = { 200u, 30u, 8u, 1u, 2u };
+    table.update(43u, first);
+    BOOST_REQUIRE_EQUAL(table.get(43u, &value), LastValueTable::COMPLETE);
+    BOOST_REQUIRE_EQUAL(value.offset, 30u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_last_value_sequencer)
+{
+    std::vector<char> page_mem;
+    page_mem.resize(sizeof(PageHeader) + 0x10000);
+    auto page = new (page_mem.data()) PageHeader(0, page_mem.size(), 3);
+    LastValueTable table;
+    Sequencer seq(page, {0u, 10000u, 0u}, &table);
+
+    const int NUM_PARAMS = 100;
+    for (int i = 0; i < 1000; i++) {
+        int status;
+        int lock = 0;
+        aku_ParamId param = i % NUM_PARAMS;
+        std::tie(status, lock) = seq.add(TimeSeriesValue(static_cast<aku_TimeStamp>(i), param, i, 8u));
+        BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+    }
+
+    BOOST_REQUIRE_EQUAL(table.size(), NUM_PARAMS);
+    for (int i = 0; i < NUM_PARAMS; i++) {
+        LastValue value;
+        BOOST_REQUIRE_EQUAL(table.get(i, &value), LastValueTable::INCOMPLETE);
+        BOOST_REQUIRE_EQUAL(value.timestamp, 900u + i);
+        BOOST_REQUIRE_EQUAL(value.offset, 900u + i);
+        BOOST_REQUIRE_EQUAL(value.length, 8u);
+        BOOST_REQUIRE_EQUAL(value.page_id, 3u);
+        BOOST_REQUIRE_EQUAL(value.open_count, page->open_count);
+    }
+}
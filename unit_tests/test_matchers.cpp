@@ -0,0 +1,133 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "matchers.h"
+#include "selection.h"
+
+using namespace Akumuli;
+
+//! Compare specialized matcher with query predicate
+struct MatcherChecker {
+    SearchQuery const& query;
+    aku_ParamId max_id;
+
+    template<class Matcher>
+    void operator () (Matcher const& matcher) {
+        std::vector<aku_ParamId> ids;
+        for (aku_ParamId id = 0; id < max_id; id++) {
+            bool expected = query.param_pred(id) == SearchQuery::MATCH;
+            BOOST_REQUIRE_EQUAL(matcher(id), expected);
+            BOOST_REQUIRE_EQUAL(matcher.match(id), query.param_pred(id));
+            ids.push_back(id);
+        }
+        // selection kernel
+        SelectionVector sel;
+        select_params(ids.data(), 0, ids.size(), matcher, &sel);
+        for (auto i: sel) {
+            BOOST_REQUIRE(query.param_pred(ids[i]) == SearchQuery::MATCH);
+        }
+        // hinted selection kernel, rows are sorted by (timestamp, param id)
+        std::vector<aku_TimeStamp> tcol;
+        std::vector<aku_ParamId> icol;
+        for (aku_TimeStamp ts = 0; ts < 10; ts++) {
+            for (aku_ParamId id = 0; id < max_id; id += 1 + ts) {
+                tcol.push_back(ts);
+                icol.push_back(id);
+            }
+        }
+        SelectionVector expected, actual;
+        select_params(icol.data(), 0, icol.size(), matcher, &expected);
+        select_params_sorted(tcol.data(), icol.data(), 0, icol.size(), matcher, &actual);
+        BOOST_REQUIRE_EQUAL_COLLECTIONS(actual.begin(), actual.end(), expected.begin(), expected.end());
+    }
+};
+
+//! Check that LT_ALL and GT_ALL hints are consistent with set of ids
+static void check_hints(SearchQuery const& query, std::vector<aku_ParamId> const& ids, aku_ParamId max_id) {
+    for (aku_ParamId id = 0; id < max_id; id++) {
+        switch (query.param_pred(id)) {
+        case SearchQuery::LT_ALL:
+            BOOST_REQUIRE(ids.empty() || id < ids.front());
+            break;
+        case SearchQuery::GT_ALL:
+            BOOST_REQUIRE(ids.empty() || id > ids.back());
+            break;
+        default:
+            break;
+        };
+    }
+}
+
+static void check_matcher(std::vector<aku_ParamId> ids, SearchQuery::MatcherKind kind) {
+    SearchQuery query(ids, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE_EQUAL(query.kind, kind);
+    for (auto id: ids) {
+        BOOST_REQUIRE(query.param_pred(id) == SearchQuery::MATCH);
+    }
+    std::sort(ids.begin(), ids.end());
+    check_hints(query, ids, 2000u);
+    MatcherChecker checker = { query, 2000u };
+    dispatch_matcher(query, checker);
+}
+
+BOOST_AUTO_TEST_CASE(Test_matcher_single)
+{
+    check_matcher({ 42 }, SearchQuery::MATCH_SINGLE);
+    check_matcher({ 42, 42 }, SearchQuery::MATCH_SINGLE);
+}
+
+BOOST_AUTO_TEST_CASE(Test_matcher_small_set)
+{
+    check_matcher({ 100, 3, 7 }, SearchQuery::MATCH_SET);
+    check_matcher({ 1, 3, 5, 7, 9, 11, 13, 15 }, SearchQuery::MATCH_SET);
+}
+
+BOOST_AUTO_TEST_CASE(Test_matcher_sorted_set)
+{
+    std::vector<aku_ParamId> ids;
+    for (aku_ParamId id = 0; id < 1000000; id += 100000) {
+        ids.push_back(id);
+    }
+    check_matcher(ids, SearchQuery::MATCH_SET);
+}
+
+BOOST_AUTO_TEST_CASE(Test_matcher_bitmap)
+{
+    std::vector<aku_ParamId> ids;
+    for (aku_ParamId id = 100; id < 1000; id += 7) {
+        ids.push_back(id);
+    }
+    check_matcher(ids, SearchQuery::MATCH_BITMAP);
+}
+
+BOOST_AUTO_TEST_CASE(Test_matcher_range)
+{
+    check_matcher({ 12, 10, 11, 13 }, SearchQuery::MATCH_RANGE);
+}
+
+BOOST_AUTO_TEST_CASE(Test_matcher_id_range_query)
+{
+    SearchQuery query(10u, 19u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE_EQUAL(query.kind, SearchQuery::MATCH_RANGE);
+    BOOST_REQUIRE(query.param_pred(9u) == SearchQuery::LT_ALL);
+    BOOST_REQUIRE(query.param_pred(10u) == SearchQuery::MATCH);
+    BOOST_REQUIRE(query.param_pred(19u) == SearchQuery::MATCH);
+    BOOST_REQUIRE(query.param_pred(20u) == SearchQuery::GT_ALL);
+    MatcherChecker checker = { query, 100u };
+    dispatch_matcher(query, checker);
+
+    SearchQuery single(7u, 7u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE_EQUAL(single.kind, SearchQuery::MATCH_SINGLE);
+    BOOST_REQUIRE_EQUAL(single.param_id, 7u);
+
+    SearchQuery empty(8u, 7u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    for (aku_ParamId id = 0; id < 100; id++) {
+        BOOST_REQUIRE(empty.param_pred(id) != SearchQuery::MATCH);
+    }
+    MatcherChecker empty_checker = { empty, 100u };
+    dispatch_matcher(empty, empty_checker);
+}
@@ -5,6 +5,7 @@
 #define BOOST_TEST_MODULE Main
 #include <boost/test/unit_test.hpp>
 #include <vector>
+#include <set>
 #include <iostream>
 
 #include "akumuli_def.h"
@@ -29,6 +30,19 @@ BOOST_AUTO_TEST_CASE(TestPaging1)
     BOOST_CHECK_EQUAL(0, page->get_entries_count());
 }
 
+BOOST_AUTO_TEST_CASE(Test_page_index_kind)
+{
+    std::vector<char> page_mem;
+    page_mem.resize(sizeof(PageHeader) + 4096);
+    auto page = new (page_mem.data()) PageHeader(0, page_mem.size(), 0);
+    BOOST_REQUIRE_EQUAL(page->get_index_kind(), AKU_PAGE_INDEX_HISTOGRAM);
+    page->init_index(AKU_PAGE_INDEX_LEARNED);
+    BOOST_REQUIRE_EQUAL(page->get_index_kind(), AKU_PAGE_INDEX_LEARNED);
+    page->reuse();
+    BOOST_REQUIRE_EQUAL(page->get_index_kind(), AKU_PAGE_INDEX_HISTOGRAM);
+    BOOST_REQUIRE_EQUAL(page->histogram.size, 0u);
+}
+
 BOOST_AUTO_TEST_CASE(TestPaging2)
 {
     std::vector<char> page_mem;
@@ -350,7 +364,7 @@ BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_backward_with_skew_0)
 }
 
 // TODO: test multi-part search calls
-BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_large)
+void generic_search_range_large_test(uint32_t index_kind, int min_step, int max_step)
 {
     const int                   buf_len = 1024*1024*8;
     std::vector<char>           buffer(buf_len);
@@ -360,6 +374,7 @@ BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_large)
     PageHeader*                 page = nullptr;
 
     page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+    page->init_index(index_kind);
 
     for(int i = 0; true; i++)
     {
@@ -372,8 +387,8 @@ BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_large)
         }
         timestamps.push_back(time_stamp);  // i-th timestamp
         paramids.push_back(id);
-        // timestamp grows always
-        time_stamp += 1 + rand_num % 100;
+        // timestamp never decreases
+        time_stamp += min_step + rand_num % max_step;
     }
 
     page->_sort();
@@ -439,6 +454,95 @@ BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_large)
     }
 }
 
+BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_large)
+{
+    generic_search_range_large_test(AKU_PAGE_INDEX_HISTOGRAM, 1, 100);
+}
+
+BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_large_learned)
+{
+    generic_search_range_large_test(AKU_PAGE_INDEX_LEARNED, 1, 100);
+}
+
+BOOST_AUTO_TEST_CASE(Test_SingleParamCursor_search_range_large_learned_duplicates)
+{
+    generic_search_range_large_test(AKU_PAGE_INDEX_LEARNED, 0, 3);
+}
+
+BOOST_AUTO_TEST_CASE(Test_LearnedIndex_error_bound)
+{
+    std::vector<char> page_mem(sizeof(PageHeader));
+    auto page = new (page_mem.data()) PageHeader(0, page_mem.size(), 0);
+    auto& index = page->learned;
+    index.reset();
+
+    std::vector<aku_TimeStamp> keys;
+    aku_TimeStamp ts = 1000u;
+    for (uint32_t i = 0; i < 100000; i++) {
+        // irregular intervals with long gaps
+        ts += (i % 1000 == 0) ? 100000u : 1u + std::rand() % 20;
+        keys.push_back(ts);
+        index.add(ts, i);
+        // out of order value must be ignored
+        index.add(ts - 1, i);
+    }
+
+    BOOST_REQUIRE(index.size > 0);
+    BOOST_REQUIRE(index.size < AKU_LEARNED_INDEX_SIZE);
+    size_t seg = 0;
+    for (uint32_t i = 0; i < keys.size(); i++) {
+        while (seg + 1 < index.size && index.segments[seg + 1].key <= keys[i]) {
+            seg++;
+        }
+        auto const& s = index.segments[seg];
+        double pred = s.index + s.slope*static_cast<double>(keys[i] - s.key);
+        BOOST_REQUIRE(std::abs(pred - i) <= AKU_LEARNED_INDEX_ERROR + 1);
+    }
+}
+
+//! Read all results from pull cursor
+static std::vector<CursorResult> read_all(ExternalCursor& cursor, int buf_size) {
+    std::vector<CursorResult> results;
+    std::vector<CursorResult> buffer(buf_size);
+    while (!cursor.is_done()) {
+        int n = cursor.read(buffer.data(), buf_size);
+        results.insert(results.end(), buffer.begin(), buffer.begin() + n);
+    }
+    BOOST_REQUIRE(!cursor.is_error(nullptr));
+    cursor.close();
+    return results;
+}
+
+//! Read all results, cursor is recreated from the scan position after every read
+static std::vector<CursorResult> read_resumed(PageHeader const* page, SearchQuery const& query, int buf_size) {
+    std::vector<CursorResult> results;
+    std::vector<CursorResult> buffer(buf_size);
+    auto cursor = page->search(query);
+    while (!cursor->is_done()) {
+        int n = cursor->read(buffer.data(), buf_size);
+        results.insert(results.end(), buffer.begin(), buffer.begin() + n);
+        PageScanPosition position;
+        if (cursor->get_position(&position)) {
+            BOOST_REQUIRE_EQUAL(position.page_id, page->page_id);
+            BOOST_REQUIRE_EQUAL(position.open_count, page->open_count);
+            cursor->close();
+            cursor = page->search(query, nullptr, &position);
+        }
+    }
+    BOOST_REQUIRE(!cursor->is_error(nullptr));
+    return results;
+}
+
+static void compare_results(std::vector<CursorResult> const& actual, std::vector<CursorResult> const& expected) {
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        BOOST_REQUIRE_EQUAL(actual[i].timestamp, expected[i].timestamp);
+        BOOST_REQUIRE_EQUAL(actual[i].param_id, expected[i].param_id);
+        BOOST_REQUIRE_EQUAL(actual[i].data_offset, expected[i].data_offset);
+        BOOST_REQUIRE_EQUAL(actual[i].length, expected[i].length);
+    }
+}
+
 void generic_compression_test
     ( aku_ParamId param_id
     , aku_TimeStamp begin
@@ -491,6 +595,9 @@ void generic_compression_test
         page->search(caller, &cur, query);
 
         BOOST_REQUIRE_EQUAL(cur.results.size(), exp_chunk.timestamps.size());
+        auto cursor = page->search(query);
+        compare_results(read_all(*cursor, 7), cur.results);
+        compare_results(read_resumed(page, query, 7), cur.results);
 
         if (dir == AKU_CURSOR_DIR_FORWARD) {
             auto act_it = cur.results.begin();
@@ -549,3 +656,191 @@ BOOST_AUTO_TEST_CASE(Test_Compression_backward_0) {
 BOOST_AUTO_TEST_CASE(Test_Compression_backward_1) {
     generic_compression_test(1u, 0ul, AKU_CURSOR_DIR_BACKWARD, 100);
 }
+
+BOOST_AUTO_TEST_CASE(Test_chunk_id_bounds_and_series) {
+    std::vector<char> page_mem;
+    page_mem.resize(sizeof(PageHeader) + 0x10000);
+    auto page = new (page_mem.data()) PageHeader(0, page_mem.size(), 0);
+
+    // Every chunk contains its own range of param ids
+    std::vector<ChunkHeader> chunks;
+    aku_TimeStamp ts = 0u;
+    for (aku_ParamId chunk = 0u; chunk < 40u; chunk++) {
+        ChunkHeader header;
+        for (uint32_t i = 0u; i < 20u; i++) {
+            ts += 1 + std::rand() % 10;
+            header.timestamps.push_back(ts);
+            header.paramids.push_back(chunk*10 + std::rand() % 5);
+            header.lengths.push_back(1u);
+            header.offsets.push_back(i);
+        }
+        BOOST_REQUIRE_EQUAL(page->complete_chunk(header), AKU_SUCCESS);
+        chunks.push_back(header);
+    }
+    page->_sort();
+
+    // Time range starts and ends inside the chunks
+    aku_TimeStamp lo = chunks[10].timestamps[5];
+    aku_TimeStamp hi = chunks[30].timestamps[7];
+    auto count = [&](aku_ParamId min, aku_ParamId max, std::set<aku_ParamId>* ids) {
+        size_t n = 0u;
+        for (auto const& chunk: chunks) {
+            for (size_t i = 0u; i < chunk.timestamps.size(); i++) {
+                auto id = chunk.paramids[i];
+                if (chunk.timestamps[i] >= lo && chunk.timestamps[i] <= hi && id >= min && id <= max) {
+                    if (ids) {
+                        ids->insert(id);
+                    }
+                    n++;
+                }
+            }
+        }
+        return n;
+    };
+
+    // Series of the page
+    std::set<aku_ParamId> expected;
+    count(100u, 250u, &expected);
+    BOOST_REQUIRE(!expected.empty());
+    SearchQuery query(100u, 250u, lo, hi, AKU_CURSOR_DIR_BACKWARD);
+    std::unordered_set<aku_ParamId> ids;
+    BOOST_REQUIRE_EQUAL(page->get_series(query, nullptr, &ids), AKU_SUCCESS);
+    BOOST_REQUIRE(std::set<aku_ParamId>(ids.begin(), ids.end()) == expected);
+
+    // Chunks that doesn't contain the series are skipped
+    for (auto dir: { AKU_CURSOR_DIR_FORWARD, AKU_CURSOR_DIR_BACKWARD }) {
+        for (aku_ParamId id = 95u; id < 315u; id++) {
+            SearchQuery series_query(id, lo, hi, dir);
+            Caller caller;
+            RecordingCursor cur;
+            page->search(caller, &cur, series_query);
+            BOOST_REQUIRE(cur.completed);
+            BOOST_REQUIRE_EQUAL(cur.results.size(), count(id, id, nullptr));
+            auto cursor = page->search(series_query);
+            compare_results(read_all(*cursor, 7), cur.results);
+        }
+    }
+}
+
+void generic_parallel_scan_test(int dir)
+{
+    const int                   buf_len = 1024*1024*8;
+    std::vector<char>           buffer(buf_len);
+    int64_t                     time_stamp = 0L;
+    PageHeader*                 page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+
+    for(int i = 0; true; i++)
+    {
+        aku_ParamId id = 1 + std::rand() % 3;
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        if(page->add_entry(id, time_stamp, range) == AKU_WRITE_STATUS_OVERFLOW) {
+            break;
+        }
+        // timestamps are duplicated to test partition boundaries
+        time_stamp += std::rand() % 3;
+    }
+    page->_sort();
+    BOOST_REQUIRE(page->sync_count > 4*AKU_MIN_SCAN_PARTITION_SIZE);
+
+    for (int round = 0; round < 10; round++) {
+        aku_TimeStamp max_ts = page->bbox.max_timestamp;
+        aku_TimeStamp start_time = round == 0 ? 0u : std::rand() % (max_ts/4);
+        aku_TimeStamp stop_time  = round == 0 ? max_ts : max_ts - std::rand() % (max_ts/4);
+        aku_ParamId id2search = 1 + std::rand() % 3;
+
+        SearchQuery query(id2search, start_time, stop_time, dir);
+        Caller caller;
+        RecordingCursor expected;
+        page->search(caller, &expected, query);
+
+        query.parallelism = 4;
+        RecordingCursor actual;
+        page->search(caller, &actual, query);
+
+        BOOST_REQUIRE(expected.completed);
+        BOOST_REQUIRE(actual.completed);
+        BOOST_REQUIRE(!expected.results.empty());
+        compare_results(actual.results, expected.results);
+
+        // Pull cursor
+        auto cursor = page->search(query);
+        compare_results(read_all(*cursor, 1000), expected.results);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_parallel_scan_forward) {
+    generic_parallel_scan_test(AKU_CURSOR_DIR_FORWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_parallel_scan_backward) {
+    generic_parallel_scan_test(AKU_CURSOR_DIR_BACKWARD);
+}
+
+void generic_page_cursor_test(uint32_t index_kind, int dir)
+{
+    const int                   buf_len = 1024*1024*4;
+    std::vector<char>           buffer(buf_len);
+    int64_t                     time_stamp = 0L;
+    PageHeader*                 page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+    page->init_index(index_kind);
+
+    for(int i = 0; true; i++)
+    {
+        aku_ParamId id = 1 + std::rand() % 10;
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        if(page->add_entry(id, time_stamp, range) == AKU_WRITE_STATUS_OVERFLOW) {
+            break;
+        }
+        time_stamp += std::rand() % 3;
+    }
+    page->_sort();
+
+    const int buf_sizes[] = { 1, 7, 0x100, 0x1000 };
+    for (int round = 0; round < 10; round++) {
+        aku_TimeStamp max_ts = page->bbox.max_timestamp;
+        aku_TimeStamp start_time = std::rand() % (max_ts/2);
+        aku_TimeStamp stop_time  = start_time + std::rand() % (max_ts/2);
+        std::vector<aku_ParamId> params = { 2u, 3u, 7u };
+        SearchQuery query = round % 2 ? SearchQuery(params, start_time, stop_time, dir)
+                                      : SearchQuery(2u, 5u, start_time, stop_time, dir);
+        Caller caller;
+        RecordingCursor expected;
+        page->search(caller, &expected, query);
+        BOOST_REQUIRE(expected.completed);
+
+        for (auto buf_size: buf_sizes) {
+            auto cursor = page->search(query);
+            compare_results(read_all(*cursor, buf_size), expected.results);
+        }
+        compare_results(read_resumed(page, query, 0x100), expected.results);
+    }
+
+    // Empty result
+    SearchQuery query(1u, page->bbox.max_timestamp + 1, AKU_MAX_TIMESTAMP, dir);
+    auto cursor = page->search(query);
+    BOOST_REQUIRE(read_all(*cursor, 10).empty());
+
+    // Cursor can be closed before all results are read
+    SearchQuery all(1u, 10u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, dir);
+    cursor = page->search(all);
+    CursorResult result;
+    BOOST_REQUIRE_EQUAL(cursor->read(&result, 1), 1);
+    cursor->close();
+    BOOST_REQUIRE(cursor->is_done());
+}
+
+BOOST_AUTO_TEST_CASE(Test_page_cursor_forward) {
+    generic_page_cursor_test(AKU_PAGE_INDEX_HISTOGRAM, AKU_CURSOR_DIR_FORWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_page_cursor_backward) {
+    generic_page_cursor_test(AKU_PAGE_INDEX_HISTOGRAM, AKU_CURSOR_DIR_BACKWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_page_cursor_learned_forward) {
+    generic_page_cursor_test(AKU_PAGE_INDEX_LEARNED, AKU_CURSOR_DIR_FORWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_page_cursor_learned_backward) {
+    generic_page_cursor_test(AKU_PAGE_INDEX_LEARNED, AKU_CURSOR_DIR_BACKWARD);
+}
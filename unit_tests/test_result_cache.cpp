@@ -0,0 +1,185 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "result_cache.h"
+
+using namespace Akumuli;
+
+//! Read all results of the cursor
+static std::vector<CursorResult> read_all(ExternalCursor* cursor) {
+    std::vector<CursorResult> results;
+    CursorResult buf[0x100];
+    while (!cursor->is_done()) {
+        int n = cursor->read(buf, 0x100);
+        results.insert(results.end(), buf, buf + n);
+    }
+    BOOST_REQUIRE(!cursor->is_error(nullptr));
+    cursor->close();
+    return results;
+}
+
+//! Fill page with random data and close it
+static PageHeader* make_page(std::vector<char>& buffer, uint32_t page_id) {
+    PageHeader* page = new (&buffer[0]) PageHeader(0, buffer.size(), page_id);
+    page->reuse();
+    for(uint64_t i = 0; true; i++)
+    {
+        aku_ParamId id = 1 + std::rand() % 100;
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        if(page->add_entry(id, 1000u + i, range) == AKU_WRITE_STATUS_OVERFLOW) {
+            break;
+        }
+    }
+    page->_sort();
+    return page;
+}
+
+BOOST_AUTO_TEST_CASE(Test_result_cache_key)
+{
+    std::vector<char> buffer(1024*1024);
+    PageHeader* page = make_page(buffer, 0);
+    ResultKey first, second;
+
+    // Page is open for writing
+    SearchQuery query(10u, 0u, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE(!ResultCache::make_key(query, page, &first));
+    page->close();
+    BOOST_REQUIRE(ResultCache::make_key(query, page, &first));
+
+    // Bounds outside of the page are ignored
+    SearchQuery other(10u, 100u, page->bbox.max_timestamp + 100u, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE(ResultCache::make_key(other, page, &second));
+    BOOST_REQUIRE(first == second);
+
+    other.upperbound = page->bbox.max_timestamp - 1u;
+    BOOST_REQUIRE(ResultCache::make_key(other, page, &second));
+    BOOST_REQUIRE(!(first == second));
+
+    SearchQuery backward(10u, 0u, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_BACKWARD);
+    BOOST_REQUIRE(ResultCache::make_key(backward, page, &second));
+    BOOST_REQUIRE(!(first == second));
+
+    // Predicates can't be compared
+    SearchQuery pred([](aku_ParamId id) { return id == 10u ? SearchQuery::MATCH : SearchQuery::NO_MATCH; },
+                     0u, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE(!ResultCache::make_key(pred, page, &second));
+
+    // Reused page doesn't match old key
+    page->reuse();
+    page->close();
+    BOOST_REQUIRE(ResultCache::make_key(query, page, &second));
+    BOOST_REQUIRE(!(first == second));
+}
+
+BOOST_AUTO_TEST_CASE(Test_result_cache_search)
+{
+    std::vector<char> buffer(1024*1024);
+    PageHeader* page = make_page(buffer, 0);
+    page->close();
+
+    auto cache = std::make_shared<ResultCache>(1024*1024);
+    SearchQuery query(std::vector<aku_ParamId>({5u, 6u, 50u}), 0u, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_BACKWARD);
+    ResultKey key;
+    BOOST_REQUIRE(ResultCache::make_key(query, page, &key));
+    auto expected = read_all(page->search(query).get());
+    BOOST_REQUIRE(!expected.empty());
+
+    aku_SearchStats stats;
+    PageHeader::get_search_stats(&stats, true);
+    int nsearches = 0;
+    auto search = [&]() {
+        nsearches++;
+        return page->search(query);
+    };
+    for (int i = 0; i < 3; i++) {
+        auto actual = read_all(cache->search(key, page, search).get());
+        BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+        for (size_t j = 0; j < expected.size(); j++) {
+            BOOST_REQUIRE_EQUAL(actual[j].timestamp, expected[j].timestamp);
+            BOOST_REQUIRE_EQUAL(actual[j].param_id, expected[j].param_id);
+            BOOST_REQUIRE_EQUAL(actual[j].data_offset, expected[j].data_offset);
+            BOOST_REQUIRE(actual[j].page == page);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(nsearches, 1);
+    PageHeader::get_search_stats(&stats);
+    BOOST_REQUIRE_EQUAL(stats.rcache.n_misses, 1u);
+    BOOST_REQUIRE_EQUAL(stats.rcache.n_hits, 2u);
+
+    // Incomplete search isn't cached
+    SearchQuery other(5u, 0u, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE(ResultCache::make_key(other, page, &key));
+    auto cursor = cache->search(key, page, [&]() { return page->search(other); });
+    CursorResult buf[1];
+    BOOST_REQUIRE_EQUAL(cursor->read(buf, 1), 1);
+    cursor->close();
+    BOOST_REQUIRE(!cache->get(key));
+}
+
+BOOST_AUTO_TEST_CASE(Test_result_cache_read_columns)
+{
+    std::vector<char> buffer(1024*1024);
+    PageHeader* page = make_page(buffer, 0);
+    page->close();
+
+    auto cache = std::make_shared<ResultCache>(1024*1024);
+    SearchQuery query(std::vector<aku_ParamId>({5u, 6u, 50u}), 0u, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    ResultKey key;
+    BOOST_REQUIRE(ResultCache::make_key(query, page, &key));
+    auto expected = read_all(page->search(query).get());
+
+    // Results read by columns are recorded even if some columns are not requested
+    auto cursor = cache->search(key, page, [&]() { return page->search(query); });
+    std::vector<aku_ParamId> params;
+    aku_ParamId buf[0x100];
+    CursorColumns columns = {};
+    columns.params = buf;
+    columns.size = 0x100;
+    while (!cursor->is_done()) {
+        int n = cursor->read_columns(columns);
+        params.insert(params.end(), buf, buf + n);
+    }
+    BOOST_REQUIRE(!cursor->is_error(nullptr));
+    BOOST_REQUIRE_EQUAL(params.size(), expected.size());
+    BOOST_REQUIRE(cache->get(key));
+
+    auto actual = read_all(cache->search(key, page, [&]() { return page->search(query); }).get());
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        BOOST_REQUIRE_EQUAL(params[i], expected[i].param_id);
+        BOOST_REQUIRE_EQUAL(actual[i].timestamp, expected[i].timestamp);
+        BOOST_REQUIRE_EQUAL(actual[i].param_id, expected[i].param_id);
+        BOOST_REQUIRE_EQUAL(actual[i].data_offset, expected[i].data_offset);
+        BOOST_REQUIRE_EQUAL(actual[i].length, expected[i].length);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_result_cache_eviction)
+{
+    const size_t max_size = 0x10000;
+    ResultCache cache(max_size);
+    auto make_results = [](size_t n) {
+        return std::make_shared<const ResultCache::Results>(n, CursorResult());
+    };
+    for (uint32_t i = 0; i < 100u; i++) {
+        ResultKey key = { "query", i % 4, i };
+        cache.put(key, make_results(100u));
+        BOOST_REQUIRE(cache.get_size() <= max_size);
+        BOOST_REQUIRE(cache.get(key));
+    }
+
+    // Too large entry isn't added
+    ResultKey large = { "large", 0u, 0u };
+    cache.put(large, make_results(max_size / sizeof(CursorResult)));
+    BOOST_REQUIRE(!cache.get(large));
+
+    // Entries of the reused page are removed
+    ResultKey last = { "query", 3u, 99u };
+    BOOST_REQUIRE(cache.get(last));
+    cache.erase_page(3u);
+    BOOST_REQUIRE(!cache.get(last));
+}
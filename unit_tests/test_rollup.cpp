@@ -0,0 +1,235 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <map>
+#include <sstream>
+#include <vector>
+
+#include "rollup.h"
+
+using namespace Akumuli;
+
+BOOST_AUTO_TEST_CASE(Test_rollup_table_range)
+{
+    RollupTable table(10u, 3u, 0x100000u);
+    aku_TimeStamp begin, end;
+    BOOST_REQUIRE(!table.get_range(&begin, &end));
+
+    // First bucket is incomplete
+    table.add(15u, 1u, 1.0);
+    table.set_watermark(30u);
+    BOOST_REQUIRE(table.get_range(&begin, &end));
+    BOOST_REQUIRE_EQUAL(begin, 20u);
+    BOOST_REQUIRE_EQUAL(end, 30u);
+
+    // Watermark never moves back
+    table.set_watermark(25u);
+    BOOST_REQUIRE(table.get_range(&begin, &end));
+    BOOST_REQUIRE_EQUAL(end, 30u);
+
+    // Oldest buckets are discarded
+    table.add(25u, 1u, 2.0);
+    table.add(35u, 1u, 3.0);
+    table.add(45u, 1u, 4.0);
+    table.add(55u, 1u, 5.0);
+    table.set_watermark(60u);
+    BOOST_REQUIRE(table.get_range(&begin, &end));
+    BOOST_REQUIRE_EQUAL(begin, 30u);
+    BOOST_REQUIRE_EQUAL(end, 60u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_rollup_table_max_size)
+{
+    const size_t max_size = 0x10000u;
+    RollupTable table(10u, 0x1000u, max_size);
+    // Many series in every bucket, size limit is reached before bucket limit
+    for (aku_TimeStamp ts = 0u; ts < 1000u; ts += 10u) {
+        for (aku_ParamId id = 0u; id < 100u; id++) {
+            table.add(ts, id, 1.0);
+        }
+        BOOST_REQUIRE(table.get_size() <= max_size);
+    }
+    table.set_watermark(1000u);
+    aku_TimeStamp begin, end;
+    BOOST_REQUIRE(table.get_range(&begin, &end));
+    BOOST_REQUIRE(begin > 10u);
+    BOOST_REQUIRE_EQUAL(end, 1000u);
+
+    SearchQuery query(0u, 100u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    auto rows = table.aggregate(query, begin, end, 10u);
+    BOOST_REQUIRE_EQUAL(rows.size(), (end - begin) / 10u * 100u);
+}
+
+void test_rollup_table_aggregate(int dir) {
+    RollupTable table(10u, 0x1000u, 0x1000000u);
+    std::map<std::pair<aku_TimeStamp, aku_ParamId>, AggregateState> expected;
+    const aku_Duration width = 30u;
+    for (aku_TimeStamp ts = 0u; ts < 1000u; ts++) {
+        aku_ParamId id = 1 + std::rand() % 10;
+        double value = std::rand() % 100;
+        table.add(ts, id, value);
+        if (ts >= 30u && ts < 900u && id % 2) {
+            expected[std::make_pair(ts - ts % width, id)].add(ts, value);
+        }
+    }
+    table.set_watermark(1000u);
+
+    std::vector<aku_ParamId> params = { 1u, 3u, 5u, 7u, 9u };
+    SearchQuery query(params, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, dir);
+    auto rows = table.aggregate(query, 30u, 900u, width);
+    BOOST_REQUIRE_EQUAL(rows.size(), expected.size());
+
+    std::vector<aku_AggregateRow> expected_rows;
+    for (auto const& kv: expected) {
+        aku_AggregateRow row;
+        kv.second.get(kv.first.first, kv.first.second, &row);
+        expected_rows.push_back(row);
+    }
+    if (dir == AKU_CURSOR_DIR_BACKWARD) {
+        std::stable_sort(expected_rows.begin(), expected_rows.end(), [](aku_AggregateRow const& a, aku_AggregateRow const& b) {
+            return a.bucket > b.bucket;
+        });
+    }
+    for (size_t i = 0; i < rows.size(); i++) {
+        BOOST_REQUIRE_EQUAL(rows[i].bucket, expected_rows[i].bucket);
+        BOOST_REQUIRE_EQUAL(rows[i].param_id, expected_rows[i].param_id);
+        BOOST_REQUIRE_EQUAL(rows[i].count, expected_rows[i].count);
+        BOOST_REQUIRE_EQUAL(rows[i].min, expected_rows[i].min);
+        BOOST_REQUIRE_EQUAL(rows[i].max, expected_rows[i].max);
+        BOOST_REQUIRE_EQUAL(rows[i].sum, expected_rows[i].sum);
+        BOOST_REQUIRE_EQUAL(rows[i].first, expected_rows[i].first);
+        BOOST_REQUIRE_EQUAL(rows[i].last, expected_rows[i].last);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_rollup_table_aggregate_forward)
+{
+    test_rollup_table_aggregate(AKU_CURSOR_DIR_FORWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_rollup_table_aggregate_backward)
+{
+    test_rollup_table_aggregate(AKU_CURSOR_DIR_BACKWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_rollups_add_chunk)
+{
+    const int           buf_len = 1024*1024;
+    std::vector<char>   buffer(buf_len);
+    PageHeader*         page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+    page->init_index(AKU_PAGE_INDEX_HISTOGRAM);
+
+    for (uint64_t i = 0; i < 1000u; i++) {
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        page->add_entry(1 + i % 3, i, range);
+    }
+    page->_sort();
+
+    // Chunk is built from the page search results
+    SearchQuery query(1u, 3u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    Caller caller;
+    RecordingCursor recorder;
+    page->search(caller, &recorder, query);
+    ChunkHeader chunk;
+    for (auto const& res: recorder.results) {
+        chunk.timestamps.push_back(res.timestamp);
+        chunk.paramids.push_back(res.param_id);
+        chunk.offsets.push_back(res.data_offset);
+        chunk.lengths.push_back(res.length);
+    }
+
+    Rollups rollups({100u, 10u, 0u}, AKU_VALUE_U64, 0x100u, 0x1000000u);
+    BOOST_REQUIRE(rollups.find(7u) == nullptr);
+    BOOST_REQUIRE_EQUAL(rollups.find(30u)->get_resolution(), 10u);
+    BOOST_REQUIRE_EQUAL(rollups.find(200u)->get_resolution(), 100u);
+
+    rollups.add_chunk(page, chunk, 1000u);
+    rollups.wait();
+
+    auto rollup = rollups.find(100u);
+    aku_TimeStamp begin, end;
+    BOOST_REQUIRE(rollup->get_range(&begin, &end));
+    BOOST_REQUIRE_EQUAL(begin, 100u);
+    BOOST_REQUIRE_EQUAL(end, 1000u);
+    auto rows = rollup->aggregate(query, begin, end, 100u);
+    BOOST_REQUIRE_EQUAL(rows.size(), 27u);
+    for (auto const& row: rows) {
+        BOOST_REQUIRE(row.count == 33u || row.count == 34u);
+        BOOST_REQUIRE_EQUAL(row.first, row.min);
+        BOOST_REQUIRE_EQUAL(row.last, row.max);
+        BOOST_REQUIRE_EQUAL(static_cast<aku_ParamId>(row.min) % 3, row.param_id - 1);
+        BOOST_REQUIRE(row.min - row.bucket < 3.0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_rollups_save_load)
+{
+    const int           buf_len = 1024*1024;
+    std::vector<char>   buffer(buf_len);
+    PageHeader*         page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+    page->init_index(AKU_PAGE_INDEX_HISTOGRAM);
+
+    for (uint64_t i = 0; i < 1000u; i++) {
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        page->add_entry(1 + i % 3, i, range);
+    }
+    page->_sort();
+
+    // Only values older than 500 are added to rollups before save
+    SearchQuery saved_query(1u, 3u, AKU_MIN_TIMESTAMP, 499u, AKU_CURSOR_DIR_FORWARD);
+    Caller caller;
+    RecordingCursor recorder;
+    page->search(caller, &recorder, saved_query);
+    ChunkHeader chunk;
+    for (auto const& res: recorder.results) {
+        chunk.timestamps.push_back(res.timestamp);
+        chunk.paramids.push_back(res.param_id);
+        chunk.offsets.push_back(res.data_offset);
+        chunk.lengths.push_back(res.length);
+    }
+    Rollups rollups({100u}, AKU_VALUE_U64, 0x100u, 0x1000000u);
+    rollups.add_chunk(page, chunk, 499u);
+    rollups.wait();
+    std::stringstream stream;
+    BOOST_REQUIRE_EQUAL(rollups.save(stream), AKU_SUCCESS);
+    auto data = stream.str();
+
+    // Rollups with other configuration can't be loaded
+    Rollups other({10u}, AKU_VALUE_U64, 0x100u, 0x1000000u);
+    std::stringstream other_stream(data);
+    BOOST_REQUIRE_EQUAL(other.load(other_stream), AKU_EBAD_DATA);
+    BOOST_REQUIRE(!other.find(10u)->get_range(nullptr, nullptr));
+
+    Rollups loaded({100u}, AKU_VALUE_U64, 0x100u, 0x1000000u);
+    std::stringstream loaded_stream(data);
+    BOOST_REQUIRE_EQUAL(loaded.load(loaded_stream), AKU_SUCCESS);
+    BOOST_REQUIRE_EQUAL(loaded.get_watermark(), 499u);
+    aku_TimeStamp begin, end;
+    BOOST_REQUIRE(loaded.find(100u)->get_range(&begin, &end));
+    BOOST_REQUIRE_EQUAL(begin, 100u);
+    BOOST_REQUIRE_EQUAL(end, 499u);
+
+    SearchQuery query(1u, 3u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    auto expected = rollups.find(100u)->aggregate(query, 100u, 400u, 100u);
+    auto actual = loaded.find(100u)->aggregate(query, 100u, 400u, 100u);
+    BOOST_REQUIRE_EQUAL(actual.size(), expected.size());
+    for (size_t i = 0; i < actual.size(); i++) {
+        BOOST_REQUIRE_EQUAL(actual[i].bucket, expected[i].bucket);
+        BOOST_REQUIRE_EQUAL(actual[i].param_id, expected[i].param_id);
+        BOOST_REQUIRE_EQUAL(actual[i].count, expected[i].count);
+        BOOST_REQUIRE_EQUAL(actual[i].sum, expected[i].sum);
+    }
+
+    // Values newer than the watermark are added from the page, watermark isn't changed
+    SearchQuery newer(1u, 3u, 500u, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    auto cursor = page->search(newer);
+    BOOST_REQUIRE_EQUAL(loaded.fill(cursor.get()), AKU_SUCCESS);
+    BOOST_REQUIRE_EQUAL(loaded.get_watermark(), 499u);
+    auto rows = loaded.find(100u)->aggregate(query, 500u, 1000u, 100u);
+    BOOST_REQUIRE_EQUAL(rows.size(), 15u);
+    for (auto const& row: rows) {
+        BOOST_REQUIRE(row.count == 33u || row.count == 34u);
+    }
+}
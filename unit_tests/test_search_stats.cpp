@@ -0,0 +1,65 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <thread>
+#include <vector>
+
+#include "search_stats.h"
+
+using namespace Akumuli;
+
+BOOST_AUTO_TEST_CASE(Test_search_stats_threads_aggregation)
+{
+    const int NUM_THREADS = 8;
+    const uint64_t NUM_ITERATIONS = 10000;
+
+    aku_SearchStats stats;
+    get_search_stats(&stats, true);
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < NUM_THREADS; i++) {
+        threads.emplace_back([=]() {
+            for (uint64_t j = 0; j < NUM_ITERATIONS; j++) {
+                stats_add(get_thread_search_stats().bstats.n_times, 1u);
+            }
+        });
+    }
+    // counters of live threads
+    stats_add(get_thread_search_stats().bstats.n_steps, 42u);
+    for (auto& t: threads) {
+        t.join();
+    }
+
+    // counters of finished threads must be preserved
+    get_search_stats(&stats, true);
+    BOOST_REQUIRE_EQUAL(stats.bstats.n_times, NUM_THREADS*NUM_ITERATIONS);
+    BOOST_REQUIRE_EQUAL(stats.bstats.n_steps, 42u);
+
+    get_search_stats(&stats, false);
+    BOOST_REQUIRE_EQUAL(stats.bstats.n_times, 0u);
+    BOOST_REQUIRE_EQUAL(stats.bstats.n_steps, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_search_stats_latency_histogram)
+{
+    aku_SearchStats stats;
+    get_search_stats(&stats, true);
+
+    auto& hist = get_thread_search_stats().latency.scan;
+    stats_add_latency(hist, 0u);
+    stats_add_latency(hist, 1u);
+    stats_add_latency(hist, 1000u);  // 2^9 <= 1000 < 2^10
+    stats_add_latency(hist, ~0ul);   // last bucket
+    {
+        LatencyTimer timer(&aku_SearchStats::Latency::binary_search);
+    }
+
+    get_search_stats(&stats, true);
+    BOOST_REQUIRE_EQUAL(stats.latency.scan.n_times, 4u);
+    BOOST_REQUIRE_EQUAL(stats.latency.scan.buckets[0], 2u);
+    BOOST_REQUIRE_EQUAL(stats.latency.scan.buckets[9], 1u);
+    BOOST_REQUIRE_EQUAL(stats.latency.scan.buckets[AKU_LATENCY_HISTOGRAM_SIZE - 1], 1u);
+    BOOST_REQUIRE_EQUAL(stats.latency.binary_search.n_times, 1u);
+}
@@ -0,0 +1,68 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+#include "selection.h"
+
+using namespace Akumuli;
+
+BOOST_AUTO_TEST_CASE(Test_select_time_range)
+{
+    std::vector<aku_TimeStamp> ts = { 1, 2, 2, 3, 5, 5, 5, 8 };
+    uint32_t first, last;
+    std::tie(first, last) = select_time_range(ts.data(), ts.size(), 2, 5);
+    BOOST_REQUIRE_EQUAL(first, 1u);
+    BOOST_REQUIRE_EQUAL(last, 7u);
+    std::tie(first, last) = select_time_range(ts.data(), ts.size(), 6, 7);
+    BOOST_REQUIRE_EQUAL(first, last);
+    std::tie(first, last) = select_time_range(ts.data(), ts.size(), 0, 100);
+    BOOST_REQUIRE_EQUAL(first, 0u);
+    BOOST_REQUIRE_EQUAL(last, ts.size());
+}
+
+BOOST_AUTO_TEST_CASE(Test_select_param_eq_and_fn)
+{
+    std::vector<aku_ParamId> ids;
+    for (int i = 0; i < 1003; i++) {
+        ids.push_back(std::rand() % 5);
+    }
+    auto matcher = [](aku_ParamId id) {
+        return id == 3 ? SearchQuery::MATCH : SearchQuery::NO_MATCH;
+    };
+    // unaligned ranges
+    for (uint32_t begin = 0; begin < 5; begin++) {
+        for (uint32_t end = ids.size() - 5; end <= ids.size(); end++) {
+            SelectionVector expected;
+            for (uint32_t i = begin; i < end; i++) {
+                if (ids[i] == 3) {
+                    expected.push_back(i);
+                }
+            }
+            SelectionVector actual;
+            select_param_eq(ids.data(), begin, end, 3u, &actual);
+            BOOST_REQUIRE_EQUAL_COLLECTIONS(actual.begin(), actual.end(), expected.begin(), expected.end());
+
+            select_param_fn(ids.data(), begin, end, matcher, &actual);
+            BOOST_REQUIRE_EQUAL_COLLECTIONS(actual.begin(), actual.end(), expected.begin(), expected.end());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_skip_timestamp_group)
+{
+    std::vector<aku_TimeStamp> ts;
+    for (aku_TimeStamp t = 0; t < 20; t++) {
+        for (aku_TimeStamp k = 0; k < t; k++) {
+            ts.push_back(t);
+        }
+    }
+    for (uint32_t i = 0; i < ts.size(); i++) {
+        auto expected = std::upper_bound(ts.begin(), ts.end(), ts[i]) - ts.begin();
+        BOOST_REQUIRE_EQUAL(skip_timestamp_group(ts.data(), i, ts.size()), expected);
+        // group truncated by the end of the range
+        BOOST_REQUIRE_EQUAL(skip_timestamp_group(ts.data(), i, i + 1), i + 1);
+    }
+}
@@ -170,10 +170,7 @@ void test_sequencer_searching(int dir) {
     Caller caller;
     RecordingCursor cursor;
     SearchQuery query(42u, begin, end, dir);
-    aku_TimeStamp window;
-    int seq_id;
-    std::tie(window, seq_id) = seq.get_window();
-    seq.search(caller, &cursor, query, seq_id);
+    seq.search(caller, &cursor, query);
 
     // Check that everything is there
     BOOST_REQUIRE_EQUAL(cursor.results.size(), offsets.size());
@@ -181,6 +178,19 @@ void test_sequencer_searching(int dir) {
         auto offset = cursor.results[i].data_offset;
         BOOST_REQUIRE_EQUAL(offset, offsets[i]);
     }
+
+    // Same results should be returned by pull cursor
+    auto pcursor = seq.search(query);
+    std::vector<aku_EntryOffset> actual;
+    while (!pcursor->is_done()) {
+        CursorResult results[7];
+        int n = pcursor->read(results, 7);
+        for (int i = 0; i < n; i++) {
+            actual.push_back(results[i].data_offset);
+        }
+    }
+    BOOST_REQUIRE(!pcursor->is_error(nullptr));
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(actual.begin(), actual.end(), offsets.begin(), offsets.end());
 }
 
 BOOST_AUTO_TEST_CASE(Test_sequencer_search_backward) {
@@ -190,3 +200,226 @@ BOOST_AUTO_TEST_CASE(Test_sequencer_search_backward) {
 BOOST_AUTO_TEST_CASE(Test_sequencer_search_forward) {
     test_sequencer_searching(AKU_CURSOR_DIR_FORWARD);
 }
+
+void test_sequencer_id_range_search(int dir) {
+    const int NUM_TIMESTAMPS = 100;
+    const int NUM_PARAMS = 50;
+    const int WINDOW = 10000;
+
+    Sequencer seq(nullptr, {0u, WINDOW, 0u});
+    std::vector<aku_EntryOffset> offsets;
+
+    aku_EntryOffset offset = 0u;
+    for (int i = 0; i < NUM_TIMESTAMPS; i++) {
+        for (int j = 0; j < NUM_PARAMS; j++) {
+            int status;
+            int lock = 0;
+            tie(status, lock) = seq.add(TimeSeriesValue(static_cast<aku_TimeStamp>(42u + i), j, offset, 0u));
+            BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+            if (i >= 10 && i <= 20 && j >= 5 && j <= 9) {
+                offsets.push_back(offset);
+            }
+            offset++;
+        }
+    }
+
+    if (dir == AKU_CURSOR_DIR_BACKWARD) {
+        std::reverse(offsets.begin(), offsets.end());
+    }
+
+    Caller caller;
+    RecordingCursor cursor;
+    SearchQuery query(5u, 9u, 52u, 62u, dir);
+    seq.search(caller, &cursor, query);
+
+    BOOST_REQUIRE_EQUAL(cursor.results.size(), offsets.size());
+    for (auto i = 0u; i < cursor.results.size(); i++) {
+        BOOST_REQUIRE_EQUAL(cursor.results[i].data_offset, offsets[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_sequencer_id_range_search_backward) {
+    test_sequencer_id_range_search(AKU_CURSOR_DIR_BACKWARD);
+}
+
+BOOST_AUTO_TEST_CASE(Test_sequencer_id_range_search_forward) {
+    test_sequencer_id_range_search(AKU_CURSOR_DIR_FORWARD);
+}
+
+//! Read offsets of all values returned by sequencer cursor
+static std::vector<aku_EntryOffset> read_offsets(ExternalCursor* cursor) {
+    std::vector<aku_EntryOffset> result;
+    while (!cursor->is_done()) {
+        CursorResult results[7];
+        int n = cursor->read(results, 7);
+        for (int i = 0; i < n; i++) {
+            result.push_back(results[i].data_offset);
+        }
+    }
+    BOOST_REQUIRE(!cursor->is_error(nullptr));
+    return result;
+}
+
+BOOST_AUTO_TEST_CASE(Test_sequencer_snapshot_during_merge)
+{
+    const int SZLOOP = 1000;
+    const int WINDOW = 10000;
+
+    Sequencer seq(nullptr, {0u, WINDOW, 0u});
+    SearchQuery query(42u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+
+    for (int i = 0; i < SZLOOP; i++) {
+        int status;
+        int lock = 0;
+        tie(status, lock) = seq.add(TimeSeriesValue(static_cast<aku_TimeStamp>(100u + i), 42u, i, 0u));
+        BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+    }
+    // Values of the active runs can be merged after the snapshot
+    BOOST_REQUIRE_EQUAL(seq.get_snapshot().page_limit, 100u);
+
+    // Values that wait for merge are visible, page values with the same timestamps should be ignored
+    int lock = seq.reset();
+    BOOST_REQUIRE(lock % 2 == 1);
+    auto snapshot = seq.get_snapshot();
+    BOOST_REQUIRE_EQUAL(snapshot.page_limit, 100u);
+    auto before = read_offsets(seq.search(query, snapshot).get());
+    BOOST_REQUIRE_EQUAL(before.size(), static_cast<size_t>(SZLOOP));
+    for (int i = 0; i < SZLOOP; i++) {
+        BOOST_REQUIRE_EQUAL(before[i], static_cast<aku_EntryOffset>(i));
+    }
+
+    Caller caller;
+    RecordingCursor merged;
+    seq.merge(caller, &merged);
+    BOOST_REQUIRE_EQUAL(merged.results.size(), static_cast<size_t>(SZLOOP));
+
+    // Old snapshot isn't affected by merge
+    auto after = read_offsets(seq.search(query, snapshot).get());
+    BOOST_REQUIRE_EQUAL_COLLECTIONS(after.begin(), after.end(), before.begin(), before.end());
+
+    // Merged values are not in the new snapshot
+    auto current = seq.get_snapshot();
+    BOOST_REQUIRE_EQUAL(current.page_limit, static_cast<aku_TimeStamp>(AKU_MAX_TIMESTAMP));
+    BOOST_REQUIRE(read_offsets(seq.search(query, current).get()).empty());
+}
+
+BOOST_AUTO_TEST_CASE(Test_sequencer_snapshot_skips_late_values)
+{
+    const int WINDOW = 10000;
+
+    Sequencer seq(nullptr, {0u, WINDOW, 0u});
+    SearchQuery query(42u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+
+    for (int i = 0; i < 100; i++) {
+        int status, lock;
+        tie(status, lock) = seq.add(TimeSeriesValue(static_cast<aku_TimeStamp>(100u + i), 42u, i, 0u));
+        BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+    }
+    auto snapshot = seq.get_snapshot();
+    BOOST_REQUIRE_EQUAL(snapshot.page_limit, 100u);
+
+    // Late value is older than page_limit, it can be merged to page before the page search
+    int status, lock;
+    tie(status, lock) = seq.add(TimeSeriesValue(50u, 42u, 1000u, 0u));
+    BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+    // New value is returned once by the snapshot search or by the page search
+    tie(status, lock) = seq.add(TimeSeriesValue(300u, 42u, 1001u, 0u));
+    BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+
+    auto offsets = read_offsets(seq.search(query, snapshot).get());
+    BOOST_REQUIRE(std::find(offsets.begin(), offsets.end(), 1000u) == offsets.end());
+    for (int i = 0; i < 100; i++) {
+        BOOST_REQUIRE_EQUAL(offsets.at(i), static_cast<aku_EntryOffset>(i));
+    }
+
+    auto current = seq.get_snapshot();
+    BOOST_REQUIRE_EQUAL(current.page_limit, 50u);
+    offsets = read_offsets(seq.search(query, current).get());
+    BOOST_REQUIRE_EQUAL(offsets.size(), 102u);
+    BOOST_REQUIRE_EQUAL(offsets.front(), 1000u);
+    BOOST_REQUIRE_EQUAL(offsets.back(), 1001u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_sequencer_snapshot_shares_runs)
+{
+    const int WINDOW = 10000;
+
+    Sequencer seq(nullptr, {0u, WINDOW, 0u});
+    SearchQuery query(std::vector<aku_ParamId>({1u, 3u}), AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_BACKWARD);
+
+    for (int i = 0; i < 100; i++) {
+        int status, lock;
+        tie(status, lock) = seq.add(TimeSeriesValue(static_cast<aku_TimeStamp>(100u + i/4), i % 4, i, 0u));
+        BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+    }
+    auto snapshot = seq.get_snapshot();
+    auto cursor = seq.search(query, snapshot);
+
+    // Run grows after the snapshot, snapshot values are not moved
+    auto run = snapshot.runs.front();
+    auto data = run->data();
+    for (int i = 100; i < 10000; i++) {
+        int status, lock;
+        tie(status, lock) = seq.add(TimeSeriesValue(static_cast<aku_TimeStamp>(100u + i/4), i % 4, i, 0u));
+        BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+    }
+    BOOST_REQUIRE(run->data() == data);
+
+    auto offsets = read_offsets(cursor.get());
+    BOOST_REQUIRE_EQUAL(offsets.size(), 50u);
+    for (size_t i = 0; i < offsets.size(); i++) {
+        // backward direction, ids 3 and 1 of every timestamp
+        aku_EntryOffset expected = 99u - 4*(i/2) - (i % 2 ? 2u : 0u);
+        BOOST_REQUIRE_EQUAL(offsets[i], expected);
+    }
+    BOOST_REQUIRE_EQUAL(read_offsets(seq.search(query).get()).size(), 5000u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_sequencer_run_compaction)
+{
+    const int SZLOOP = 1000;
+    const int WINDOW = 10000;
+
+    Sequencer seq(nullptr, {0u, WINDOW, 0u});
+    SearchQuery query(42u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD);
+    auto snapshot = seq.get_snapshot();
+
+    // Every value is older than tails of all runs and creates new run
+    for (int i = 0; i < SZLOOP; i++) {
+        int status, lock;
+        tie(status, lock) = seq.add(TimeSeriesValue(static_cast<aku_TimeStamp>(5000u - i), 42u, i, 0u));
+        BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+        BOOST_REQUIRE(seq.runs_.size() <= AKU_SEQUENCER_MAX_RUNS);
+        if (i == SZLOOP/2) {
+            snapshot = seq.get_snapshot();
+        }
+    }
+
+    aku_StorageStats stats;
+    seq.get_stats(&stats);
+    BOOST_REQUIRE_EQUAL(stats.n_runs, seq.runs_.size());
+    BOOST_REQUIRE(stats.n_compactions > 0u);
+    uint64_t nruns = 0u;
+    for (int i = 0; i < AKU_RUN_SIZE_HISTOGRAM_SIZE; i++) {
+        nruns += stats.run_sizes[i];
+    }
+    BOOST_REQUIRE_EQUAL(nruns, stats.n_runs);
+
+    // Runs are still sorted by tail
+    for (size_t i = 1; i < seq.runs_.size(); i++) {
+        BOOST_REQUIRE(!(seq.runs_[i - 1]->back() < seq.runs_[i]->back()));
+    }
+
+    auto offsets = read_offsets(seq.search(query).get());
+    BOOST_REQUIRE_EQUAL(offsets.size(), static_cast<size_t>(SZLOOP));
+    for (int i = 0; i < SZLOOP; i++) {
+        BOOST_REQUIRE_EQUAL(offsets[i], static_cast<aku_EntryOffset>(SZLOOP - 1 - i));
+    }
+
+    // Snapshot isn't affected by compaction
+    offsets = read_offsets(seq.search(query, snapshot).get());
+    BOOST_REQUIRE_EQUAL(offsets.size(), static_cast<size_t>(SZLOOP/2 + 1));
+    for (size_t i = 0; i < offsets.size(); i++) {
+        BOOST_REQUIRE_EQUAL(offsets[i], static_cast<aku_EntryOffset>(SZLOOP/2 - i));
+    }
+}
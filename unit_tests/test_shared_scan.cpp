@@ -0,0 +1,91 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <tuple>
+#include <vector>
+
+#include "shared_scan.h"
+
+using namespace Akumuli;
+
+//! Read all results of the cursor
+static std::vector<CursorResult> read_all(ExternalCursor* cursor) {
+    std::vector<CursorResult> results;
+    CursorResult buf[0x100];
+    while (!cursor->is_done()) {
+        int n = cursor->read(buf, 0x100);
+        results.insert(results.end(), buf, buf + n);
+    }
+    BOOST_REQUIRE(!cursor->is_error(nullptr));
+    cursor->close();
+    return results;
+}
+
+BOOST_AUTO_TEST_CASE(Test_shared_scan)
+{
+    const int               buf_len = 1024*1024*4;
+    std::vector<char>       buffer(buf_len);
+    aku_TimeStamp           time_stamp = 0u;
+    PageHeader*             page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+    page->init_index(AKU_PAGE_INDEX_HISTOGRAM);
+
+    for(uint64_t i = 0; true; i++)
+    {
+        aku_ParamId id = 1 + std::rand() % 100;
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        if(page->add_entry(id, time_stamp, range) == AKU_WRITE_STATUS_OVERFLOW) {
+            break;
+        }
+        time_stamp += std::rand() % 3;
+    }
+    page->_sort();
+    aku_TimeStamp max_ts = page->bbox.max_timestamp;
+
+    std::vector<std::unique_ptr<SearchQuery>> queries;
+    // overlapping forward queries
+    queries.emplace_back(new SearchQuery(10u, 0u, max_ts/2, AKU_CURSOR_DIR_FORWARD));
+    queries.emplace_back(new SearchQuery(std::vector<aku_ParamId>({10u, 20u, 30u}), max_ts/4, max_ts/3, AKU_CURSOR_DIR_FORWARD));
+    queries.emplace_back(new SearchQuery(15u, 45u, max_ts/3, max_ts/2 + 10u, AKU_CURSOR_DIR_FORWARD));
+    // separate forward query
+    queries.emplace_back(new SearchQuery(
+        [](aku_ParamId id) { return id % 7 == 0 ? SearchQuery::MATCH : SearchQuery::NO_MATCH; },
+        max_ts/2 + 100u, max_ts, AKU_CURSOR_DIR_FORWARD));
+    // backward queries
+    queries.emplace_back(new SearchQuery(std::vector<aku_ParamId>({5u, 6u, 50u}), 0u, max_ts, AKU_CURSOR_DIR_BACKWARD));
+    queries.emplace_back(new SearchQuery(6u, max_ts/2, max_ts, AKU_CURSOR_DIR_BACKWARD));
+
+    std::vector<SearchQuery const*> pqueries;
+    for (auto const& query: queries) {
+        pqueries.push_back(query.get());
+    }
+    SharedScan scan(pqueries);
+    BOOST_REQUIRE_EQUAL(scan.get_group_count(), 3u);
+
+    int nsearches = 0;
+    auto search = [&](SearchQuery const& query) {
+        nsearches++;
+        return page->search(query);
+    };
+    std::vector<std::vector<std::tuple<aku_TimeStamp, aku_ParamId, aku_PData>>> actual(queries.size());
+    auto callback = [&](size_t ix, CursorColumns const& batch) {
+        for (size_t i = 0; i < batch.size; i++) {
+            actual[ix].push_back(std::make_tuple(batch.timestamps[i], batch.params[i], batch.pointers[i]));
+        }
+    };
+    BOOST_REQUIRE_EQUAL(scan.run(search, callback), AKU_SUCCESS);
+    BOOST_REQUIRE_EQUAL(nsearches, 3);
+
+    for (size_t ix = 0; ix < queries.size(); ix++) {
+        auto cursor = page->search(*queries[ix]);
+        auto expected = read_all(cursor.get());
+        BOOST_REQUIRE(!expected.empty());
+        BOOST_REQUIRE_EQUAL(actual[ix].size(), expected.size());
+        for (size_t i = 0; i < expected.size(); i++) {
+            BOOST_REQUIRE_EQUAL(std::get<0>(actual[ix][i]), expected[i].timestamp);
+            BOOST_REQUIRE_EQUAL(std::get<1>(actual[ix][i]), expected[i].param_id);
+            BOOST_REQUIRE(std::get<2>(actual[ix][i]) == page->read_entry_data(expected[i].data_offset));
+        }
+    }
+}
@@ -0,0 +1,143 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <cstring>
+#include <vector>
+
+#include "subscription.h"
+#include "sequencer.h"
+
+using namespace Akumuli;
+
+//! Read all samples of the subscription
+static std::vector<std::pair<aku_TimeStamp, uint64_t>> read_all(Subscription& sub, aku_ParamId expected_id) {
+    std::vector<std::pair<aku_TimeStamp, uint64_t>> results;
+    const size_t SIZE = 7;
+    aku_TimeStamp timestamps[SIZE];
+    aku_ParamId params[SIZE];
+    aku_PData pointers[SIZE];
+    uint32_t lengths[SIZE];
+    CursorColumns columns = { timestamps, params, pointers, lengths, SIZE };
+    while (true) {
+        int n = sub.read(columns);
+        if (n == 0) {
+            break;
+        }
+        for (int i = 0; i < n; i++) {
+            BOOST_REQUIRE_EQUAL(params[i], expected_id);
+            BOOST_REQUIRE_EQUAL(lengths[i], sizeof(uint64_t));
+            uint64_t value;
+            memcpy(&value, pointers[i], sizeof(value));
+            results.push_back(std::make_pair(timestamps[i], value));
+        }
+    }
+    return results;
+}
+
+BOOST_AUTO_TEST_CASE(Test_subscription_ring_buffer)
+{
+    std::unique_ptr<SearchQuery> query(new SearchQuery(1u, 100u, 200u, AKU_CURSOR_DIR_FORWARD));
+    Subscription sub(std::move(query), AKU_SUBSCRIBE_MAY_REORDER, 10u);
+    BOOST_REQUIRE(sub.matches(1u, 100u));
+    BOOST_REQUIRE(!sub.matches(2u, 100u));
+    BOOST_REQUIRE(!sub.matches(1u, 201u));
+
+    for (uint64_t i = 0; i < 15u; i++) {
+        sub.push(100u + i, 1u, &i, sizeof(i));
+    }
+    BOOST_REQUIRE_EQUAL(sub.get_dropped(), 5u);
+    auto results = read_all(sub, 1u);
+    BOOST_REQUIRE_EQUAL(results.size(), 10u);
+    for (uint64_t i = 0; i < 10u; i++) {
+        BOOST_REQUIRE_EQUAL(results[i].first, 100u + i);
+        BOOST_REQUIRE_EQUAL(results[i].second, i);
+    }
+
+    // Ring buffer wraps around
+    for (uint64_t i = 0; i < 8u; i++) {
+        sub.push(150u + i, 1u, &i, sizeof(i));
+    }
+    results = read_all(sub, 1u);
+    BOOST_REQUIRE_EQUAL(results.size(), 8u);
+    BOOST_REQUIRE_EQUAL(results.back().first, 157u);
+    BOOST_REQUIRE_EQUAL(sub.get_dropped(), 5u);
+}
+
+BOOST_AUTO_TEST_CASE(Test_subscription_sequencer)
+{
+    const int           buf_len = 1024*1024;
+    std::vector<char>   buffer(buf_len);
+    PageHeader*         page = new (&buffer[0]) PageHeader(0, buf_len, 0);
+    const aku_Duration  WINDOW = 10u;
+
+    auto ordered = std::make_shared<Subscription>(
+                std::unique_ptr<SearchQuery>(new SearchQuery(1u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD)),
+                AKU_SUBSCRIBE_ORDERED, 0x1000u);
+    auto live = std::make_shared<Subscription>(
+                std::unique_ptr<SearchQuery>(new SearchQuery(2u, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD)),
+                AKU_SUBSCRIBE_MAY_REORDER, 0x1000u);
+    Subscriptions subscriptions;
+    subscriptions.add(ordered);
+    subscriptions.add(live);
+
+    Sequencer seq(page, {0u, WINDOW, 0u, AKU_PAGE_INDEX_HISTOGRAM}, nullptr, nullptr, &subscriptions);
+    std::vector<aku_TimeStamp> written;
+    aku_TimeStamp merged_top = 0u;
+    for (uint64_t i = 0; i < 1000u; i++) {
+        // every tenth value is late
+        aku_TimeStamp ts = i % 10 == 9 ? i - 5 : i;
+        aku_ParamId id = 1 + i % 2;
+        aku_MemRange range = {(void*)&i, sizeof(i)};
+        BOOST_REQUIRE_EQUAL(page->add_chunk(range, seq.get_space_estimate()), AKU_SUCCESS);
+        TimeSeriesValue value(ts, id, page->last_offset, sizeof(i));
+        int status, lock;
+        std::tie(status, lock) = seq.add(value);
+        BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+        if (id == 2u) {
+            written.push_back(ts);
+        }
+        if (lock % 2 == 1) {
+            merged_top = seq.ready_top_;
+            RecordingCursor cursor;
+            Caller caller;
+            seq.merge_and_compress(caller, &cursor, page);
+        }
+    }
+
+    // Live subscriber receives all values in write order
+    auto live_results = read_all(*live, 2u);
+    BOOST_REQUIRE_EQUAL(live_results.size(), written.size());
+    for (size_t i = 0; i < written.size(); i++) {
+        BOOST_REQUIRE_EQUAL(live_results[i].first, written[i]);
+    }
+
+    // Ordered subscriber receives merged values in time order
+    auto ordered_results = read_all(*ordered, 1u);
+    BOOST_REQUIRE(!ordered_results.empty());
+    for (size_t i = 0; i < ordered_results.size(); i++) {
+        BOOST_REQUIRE(ordered_results[i].first < merged_top);
+        if (i) {
+            BOOST_REQUIRE(ordered_results[i - 1].first <= ordered_results[i].first);
+        }
+    }
+    size_t expected = 0u;
+    for (uint64_t i = 0; i < 1000u; i++) {
+        aku_TimeStamp ts = i % 10 == 9 ? i - 5 : i;
+        if (i % 2 == 0 && ts < merged_top) {
+            expected++;
+        }
+    }
+    BOOST_REQUIRE_EQUAL(ordered_results.size(), expected);
+
+    // Removed subscriber doesn't receive new values
+    subscriptions.remove(live);
+    uint64_t x = 42u;
+    aku_MemRange range = {(void*)&x, sizeof(x)};
+    BOOST_REQUIRE_EQUAL(page->add_chunk(range, seq.get_space_estimate()), AKU_SUCCESS);
+    int status, lock;
+    std::tie(status, lock) = seq.add(TimeSeriesValue(1000u, 2u, page->last_offset, sizeof(x)));
+    BOOST_REQUIRE_EQUAL(status, AKU_SUCCESS);
+    BOOST_REQUIRE(read_all(*live, 2u).empty());
+}
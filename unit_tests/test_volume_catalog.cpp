@@ -0,0 +1,66 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+
+#include "volume_catalog.h"
+
+using namespace Akumuli;
+
+static PageBoundingBox make_bbox(aku_TimeStamp min_ts, aku_TimeStamp max_ts, aku_ParamId min_id, aku_ParamId max_id) {
+    PageBoundingBox bbox;
+    bbox.min_timestamp = min_ts;
+    bbox.max_timestamp = max_ts;
+    bbox.min_id = min_id;
+    bbox.max_id = max_id;
+    return bbox;
+}
+
+BOOST_AUTO_TEST_CASE(Test_volume_catalog_time_pruning)
+{
+    VolumeCatalog catalog(3);
+    catalog.load(0, make_bbox(100, 199, 0, 10), false);
+    catalog.load(1, make_bbox(200, 299, 0, 10), false);
+    catalog.load(2, make_bbox(300, 399, 0, 10), true);
+
+    SearchQuery query(1u, 150u, 180u, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE(catalog.may_contain(0, query));
+    BOOST_REQUIRE(!catalog.may_contain(1, query));
+    BOOST_REQUIRE(catalog.may_contain(2, query));  // open volume is always searched
+
+    SearchQuery border(1u, 199u, 200u, AKU_CURSOR_DIR_BACKWARD);
+    BOOST_REQUIRE(catalog.may_contain(0, border));
+    BOOST_REQUIRE(catalog.may_contain(1, border));
+
+    // param ids of the loaded volumes are unknown
+    SearchQuery other_id(42u, 150u, 180u, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE(catalog.may_contain(0, other_id));
+}
+
+BOOST_AUTO_TEST_CASE(Test_volume_catalog_id_pruning)
+{
+    VolumeCatalog catalog(2);
+    catalog.open(0);
+    catalog.update(0, make_bbox(100, 199, 10, 20));
+    SearchQuery query(42u, 150u, 180u, AKU_CURSOR_DIR_FORWARD);
+    BOOST_REQUIRE(catalog.may_contain(0, query));
+
+    catalog.close(0, make_bbox(100, 199, 10, 20));
+    BOOST_REQUIRE(!catalog.may_contain(0, query));
+    BOOST_REQUIRE(catalog.may_contain(0, SearchQuery(15u, 150u, 180u, AKU_CURSOR_DIR_FORWARD)));
+    BOOST_REQUIRE(catalog.may_contain(0, SearchQuery(20u, 30u, 150u, 180u, AKU_CURSOR_DIR_FORWARD)));
+    BOOST_REQUIRE(!catalog.may_contain(0, SearchQuery(21u, 30u, 150u, 180u, AKU_CURSOR_DIR_FORWARD)));
+    BOOST_REQUIRE(catalog.may_contain(0, SearchQuery(std::vector<aku_ParamId>({ 1, 15, 40 }), 150u, 180u, AKU_CURSOR_DIR_FORWARD)));
+
+    // predicate can't be checked
+    auto match_all = [](aku_ParamId) { return SearchQuery::MATCH; };
+    BOOST_REQUIRE(catalog.may_contain(0, SearchQuery(match_all, 150u, 180u, AKU_CURSOR_DIR_FORWARD)));
+
+    // empty volume
+    BOOST_REQUIRE(!catalog.may_contain(1, SearchQuery(match_all, AKU_MIN_TIMESTAMP, AKU_MAX_TIMESTAMP, AKU_CURSOR_DIR_FORWARD)));
+
+    // reopened volume
+    catalog.open(0);
+    BOOST_REQUIRE(catalog.may_contain(0, query));
+}
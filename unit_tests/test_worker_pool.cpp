@@ -0,0 +1,110 @@
+#include <iostream>
+
+#define BOOST_TEST_DYN_LINK
+#include <iostream>
+#include <boost/test/unit_test.hpp>
+#include <atomic>
+#include <chrono>
+
+#include "worker_pool.h"
+#include "cursor.h"
+
+using namespace Akumuli;
+
+BOOST_AUTO_TEST_CASE(Test_worker_pool_executes_all_tasks)
+{
+    std::atomic<int> counter = {0};
+    {
+        WorkerPool pool(4);
+        for (int i = 0; i < 1000; i++) {
+            pool.submit([&counter]() { counter++; });
+        }
+    }  // d-tor waits for all tasks
+    BOOST_REQUIRE_EQUAL(counter.load(), 1000);
+}
+
+BOOST_AUTO_TEST_CASE(Test_task_group_parallelism_limit)
+{
+    std::atomic<int> running = {0};
+    std::atomic<int> max_running = {0};
+    std::atomic<int> counter = {0};
+    {
+        WorkerPool pool(8);
+        auto group = std::make_shared<TaskGroup>(pool, 2);
+        for (int i = 0; i < 100; i++) {
+            group->submit([&]() {
+                int n = ++running;
+                int prev = max_running.load();
+                while (n > prev && !max_running.compare_exchange_weak(prev, n)) {}
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                running--;
+                counter++;
+            });
+        }
+    }
+    BOOST_REQUIRE_EQUAL(counter.load(), 100);
+    BOOST_REQUIRE(max_running.load() <= 2);
+}
+
+static void test_async_cursor(int n_cursors, int n_iter, int buf_size, size_t parallelism, bool close_early) {
+    WorkerPool pool(4);
+    auto group = std::make_shared<TaskGroup>(pool, parallelism);
+    std::vector<CoroCursor> cursors(n_cursors);
+    std::vector<std::unique_ptr<AsyncCursor>> async_cursors;
+    for (int i = 0; i < n_cursors; i++) {
+        CoroCursor* cursor = &cursors[i];
+        auto generator = [i, n_iter, cursor](Caller& caller) {
+            for (int k = 0; k < n_iter; k++) {
+                CursorResult r;
+                r.data_offset = i*n_iter + k;
+                r.page = nullptr;
+                if (!cursor->put(caller, r)) {
+                    break;
+                }
+            }
+            cursor->complete(caller);
+        };
+        cursor->start(generator);
+        async_cursors.emplace_back(new AsyncCursor(cursor, group));
+        async_cursors.back()->start();
+    }
+
+    std::vector<ExternalCursor*> ecur;
+    for (auto& c: async_cursors) {
+        ecur.push_back(c.get());
+    }
+    ConcatCursor cursor(&ecur[0], n_cursors);
+    std::vector<aku_EntryOffset> actual;
+    while(!cursor.is_done()) {
+        CursorResult results[buf_size];
+        int n_read = cursor.read(results, buf_size);
+        for (int i = 0; i < n_read; i++) {
+            actual.push_back(results[i].data_offset);
+        }
+        if (close_early && actual.size() > static_cast<size_t>(n_iter)) {
+            break;
+        }
+    }
+    BOOST_REQUIRE(!cursor.is_error(nullptr));
+    cursor.close();
+
+    if (!close_early) {
+        BOOST_REQUIRE_EQUAL(actual.size(), static_cast<size_t>(n_cursors*n_iter));
+    }
+    for (size_t i = 0; i < actual.size(); i++) {
+        BOOST_REQUIRE_EQUAL(actual[i], i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(Test_async_cursor)
+{
+    test_async_cursor(1, 100, 7, 1, false);
+    test_async_cursor(10, 10000, 100, 2, false);
+    test_async_cursor(10, 10000, 5000, 16, false);
+    test_async_cursor(10, 0, 10, 4, false);
+}
+
+BOOST_AUTO_TEST_CASE(Test_async_cursor_close)
+{
+    test_async_cursor(10, 100000, 100, 4, true);
+}